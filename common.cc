@@ -18,6 +18,52 @@ bool have_required_privilege(void *opaque_thd)
   return false;
 }
 
+// Used by the check functions of the system variables, report the error when
+// the user is not allowed to change the variable
+bool check_variable_privilege(MYSQL_THD thd, const char* variable_name)
+{
+  if (have_required_privilege(thd)) return true;
+
+  Security_context_handle ctx = nullptr;
+  mysql_service_mysql_thd_security_context->get(thd, &ctx);
+  // get the user and host to display in error log
+  MYSQL_LEX_CSTRING user;
+  mysql_service_mysql_security_context_options->get(ctx, "priv_user",
+                                                      &user);
+  MYSQL_LEX_CSTRING host;
+  mysql_service_mysql_security_context_options->get(ctx, "priv_host",
+                                                      &host);
+  char buf[1024];
+  snprintf(buf, sizeof(buf), "user (%s@%s) has no access to "
+    "set %s variable "
+    "(privilege %s required).", user.str, host.str, variable_name, PRIVILEGE_NAME);
+
+  LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG, buf);
+  my_error(ER_SPECIFIC_ACCESS_DENIED_ERROR, MYF(0), PRIVILEGE_NAME);
+  return false;
+}
+
+// Check of the unsigned variables, unit is only used in the error message
+int check_unsigned_value(MYSQL_THD thd, const char *variable,
+                         const char *unit, void *save,
+                         struct st_mysql_value *value) {
+  if (!check_variable_privilege(thd, variable))
+    return (ER_SPECIFIC_ACCESS_DENIED_ERROR);
+
+  long long new_value = 0;
+  if (value->val_int(value, &new_value) || new_value < 0) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "wrong value it must be a positive number of %s.",
+                                    unit);
+    return true;
+  }
+
+  *static_cast<unsigned long long *>(save) = new_value;
+
+  return (0);
+}
+
 bool isExecutable(const std::string& path) {
     // Check if the file has executable permissions for others
     auto perms = std::filesystem::status(path).permissions();
@@ -156,4 +202,14 @@ std::string limit_lines(const std::string& input, size_t max_lines) {
     }
 
     return limited_stream.str();
-}
\ No newline at end of file
+}
+// Resident set size of mysqld in bytes, 0 if it can't be read
+uint64_t read_rss() {
+  FILE *f = fopen("/proc/self/statm", "r");
+  if (f == nullptr) return 0;
+  unsigned long long size = 0, resident = 0;
+  int read = fscanf(f, "%llu %llu", &size, &resident);
+  fclose(f);
+  if (read != 2) return 0;
+  return resident * sysconf(_SC_PAGESIZE);
+}
@@ -33,6 +33,7 @@
 #include <mysql/components/services/udf_registration.h>
 #include <mysqld_error.h> /* Errors */
 
+#include <cstdint>
 #include <list>
 #include <sstream>
 #include <string>
@@ -69,6 +70,10 @@ extern SERVICE_TYPE(log_builtins_string) * log_bs;
 #define PRIVILEGE_NAME "SENSITIVE_VARIABLES_OBSERVER"
 
 extern bool have_required_privilege(void *opaque_thd);
+extern bool check_variable_privilege(MYSQL_THD thd, const char* variable_name);
+extern int check_unsigned_value(MYSQL_THD thd, const char *variable,
+                                const char *unit, void *save,
+                                struct st_mysql_value *value);
 extern bool isExecutable(const std::string& path);
 extern bool canExecute(const std::string& path);
 extern bool fileExists(const std::string& path);
@@ -78,3 +83,4 @@ extern std::string exec_pprof(const char* cmd);
 extern bool get_profiler_variable(const char* variable_name, std::string* output);
 extern bool get_mysqld(std::string* output); 
 extern std::string limit_lines(const std::string& input, size_t max_lines);
+extern uint64_t read_rss();
@@ -24,6 +24,18 @@
 #define SIGNATURE_CHANGE 1
 
 #include "cpu.h"
+#include "cpu_triggers.h"
+#include "schedule.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <mutex>
+
+#if MYSQL_VERSION_ID >= 80100
+#include <mysql/components/services/mysql_status_variable_reader.h>
+#include <mysql/components/services/mysql_string.h>
+#endif
 
 REQUIRES_SERVICE_PLACEHOLDER(log_builtins);
 REQUIRES_SERVICE_PLACEHOLDER(log_builtins_string);
@@ -40,8 +52,14 @@ REQUIRES_SERVICE_PLACEHOLDER(status_variable_registration);
 #if MYSQL_VERSION_ID >= 90000
 REQUIRES_SERVICE_PLACEHOLDER(mysql_system_variable_reader);
 #endif
+#if MYSQL_VERSION_ID >= 80100
+REQUIRES_SERVICE_PLACEHOLDER(mysql_status_variable_string);
+REQUIRES_SERVICE_PLACEHOLDER(mysql_string_converter);
+REQUIRES_SERVICE_PLACEHOLDER(mysql_string_factory);
+#endif
 REQUIRES_SERVICE_PLACEHOLDER(profiler_var);
 REQUIRES_SERVICE_PLACEHOLDER(profiler_pfs);
+REQUIRES_SERVICE_PLACEHOLDER(profiler_dump_store);
 
 SERVICE_TYPE(log_builtins) * log_bi;
 SERVICE_TYPE(log_builtins_string) * log_bs;
@@ -51,6 +69,11 @@ static char cpuprof_status[] = "STOPPED";
 // Buffer for the value of the profiler.dump_path global variable
 std::string cpuprof_dump_path;
 
+// The profiler is also started and stopped by the trigger thread
+static std::mutex cpuprof_mutex;
+// Profile written while the status is RUNNING
+static std::string cpuprof_running_file;
+
 static SHOW_VAR cpuprof_status_variables[] = {
   {"profiler.cpu_status", (char *)&cpuprof_status, SHOW_CHAR,
     SHOW_SCOPE_GLOBAL},{nullptr, nullptr, SHOW_UNDEF,
@@ -119,6 +142,96 @@ int unregister_status_variables() {
   return 0;
 }
 
+bool next_cpu_profile_name(const char *kind, std::string *filePath) {
+  char variable_value[1024];
+  size_t value_length = sizeof(variable_value) - 1;
+  if (mysql_service_profiler_var->get("dump_path", variable_value, &value_length))
+    return false;
+  variable_value[value_length] = '\0';
+  static std::atomic<int> profile_count{1};
+  do {
+    std::ostringstream filename;
+    filename << variable_value << "." << kind << "." << std::setw(4)
+             << std::setfill('0') << profile_count++ << ".prof";
+    *filePath = filename.str();
+  } while (dump_file_exists(*filePath));
+  return true;
+}
+
+bool start_cpu_profile(const std::string& filePath, const char *reason) {
+  std::lock_guard<std::mutex> guard(cpuprof_mutex);
+  if (strcmp(cpuprof_status, "RUNNING") == 0) return false;
+  // The profile may be kept in memory (profiler.dump_store)
+  Dump_location location;
+  dump_write_location(filePath, &location);
+  if (!ProfilerStart(location.path().c_str())) return false;
+  strcpy(cpuprof_status, "RUNNING");
+  cpuprof_running_file = filePath;
+  mysql_service_profiler_pfs->add("cpu", "profiler", "started", filePath.c_str(), reason);
+  return true;
+}
+
+bool stop_cpu_profile(const std::string& filePath, const char *reason) {
+  std::lock_guard<std::mutex> guard(cpuprof_mutex);
+  if (strcmp(cpuprof_status, "STOPPED") == 0 ||
+      (!filePath.empty() && filePath != cpuprof_running_file))
+    return false;
+  ProfilerStop();
+  strcpy(cpuprof_status, "STOPPED");
+  mysql_service_profiler_pfs->add("cpu", "profiler", "stopped", cpuprof_running_file.c_str(), reason);
+  cpuprof_running_file.clear();
+  return true;
+}
+
+static bool read_profile_schedule(std::string *spec) {
+  char variable_value[1024];
+  size_t value_length = sizeof(variable_value) - 1;
+  if (mysql_service_profiler_var->get("schedule", variable_value, &value_length) ||
+      value_length >= sizeof(variable_value))
+    return false;
+  variable_value[value_length] = '\0';
+  *spec = variable_value;
+  return true;
+}
+
+// The profile of a run of profiler.schedule: <dump_path>.<run name>.prof
+static bool start_scheduled_profile(Scheduled_run *run) {
+  char variable_value[1024];
+  size_t value_length = sizeof(variable_value) - 1;
+  if (mysql_service_profiler_var->get("dump_path", variable_value, &value_length))
+    return false;
+  variable_value[value_length] = '\0';
+  run->prefix = std::string(variable_value) + "." + run->name;
+  std::string filePath = run->prefix + ".prof";
+
+  const char *skipped = nullptr;
+  // The component was reloaded during the minute of the run
+  if (dump_file_exists(filePath))
+    skipped = "the profile already exists";
+  else if (!start_cpu_profile(filePath, run->extra.c_str()))
+    skipped = "the cpu profiler is already running";
+  if (skipped != nullptr) {
+    LogComponentErr(WARNING_LEVEL, ER_LOG_PRINTF_MSG,
+                    (run->extra + ", run skipped: " + skipped + ".").c_str());
+    mysql_service_profiler_pfs->add("cpu", "profiler", "skipped", "", run->extra.c_str());
+    return false;
+  }
+  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                  (run->extra + ", cpu profile written to " + filePath).c_str());
+  return true;
+}
+
+static void stop_scheduled_profile(const Scheduled_run& run,
+                                   const char *reason) {
+  // Stopped by cpuprof_stop() otherwise
+  stop_cpu_profile(run.prefix + ".prof", reason);
+}
+
+static bool cpu_profile_running(const std::string& filePath) {
+  std::lock_guard<std::mutex> guard(cpuprof_mutex);
+  return strcmp(cpuprof_status, "RUNNING") == 0 &&
+         cpuprof_running_file == filePath;
+}
 
 namespace udf_impl {
 
@@ -189,12 +302,10 @@ const char *cpuprof_start_udf(UDF_INIT *, UDF_ARGS *, char *outp,
     *is_null = 1;
     return 0;
   }
-  cpuprof_dump_path = variable_value;
-
-  std::string filePath = cpuprof_dump_path + ".prof";
+  std::string filePath = std::string(variable_value) + ".prof";
 
-  // Check if there is something already existing
-  if (fileExists(filePath)) {
+  // Check if there is something already existing, maybe compressed
+  if (dump_file_exists(filePath)) {
     mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
                                     ER_UDF_ERROR, 0, "profiler",
                                     "There is already a cpu prof file, change the 'profiler.dump_path' value first.");
@@ -203,10 +314,16 @@ const char *cpuprof_start_udf(UDF_INIT *, UDF_ARGS *, char *outp,
     return 0;
   }
 
-  ProfilerStart(filePath.c_str());
-
-  strcpy(cpuprof_status, "RUNNING");
-  mysql_service_profiler_pfs->add("cpu", "profiler", "started", filePath.c_str(), ""); 
+  // A capture started by a trigger may be running
+  if (!start_cpu_profile(filePath, "")) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "cpu profiler is already running.");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+  cpuprof_dump_path = variable_value;
 
   strcpy(outp, "cpu profiling started");
   *length = strlen(outp);
@@ -259,7 +376,7 @@ const char *cpuprof_stop_udf(UDF_INIT *, UDF_ARGS *, char *outp,
     return 0;
   }
   
-  if (strcmp(cpuprof_status, "STOPPED") == 0) {
+  if (!stop_cpu_profile("", "")) {
     mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
                                     ER_UDF_ERROR, 0, "profiler",
                                     "cpu profiler is not running.");
@@ -268,12 +385,6 @@ const char *cpuprof_stop_udf(UDF_INIT *, UDF_ARGS *, char *outp,
     return 0;
   }  
 
-  ProfilerStop();
-
-  strcpy(cpuprof_status, "STOPPED");
-  std::string filePath = cpuprof_dump_path + ".prof";
-  mysql_service_profiler_pfs->add("cpu", "profiler", "stopped", filePath.c_str(), ""); 
-
   strcpy(outp, "cpu profiling stopped");
   *length = strlen(outp);
 
@@ -286,7 +397,7 @@ static bool pprof_cpu_udf_init(UDF_INIT *initid, UDF_ARGS *args, char *) {
   if (args->arg_count > 2) {
     mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
                                     ER_UDF_ERROR, 0, "profiler",
-                                    "this function requires none , 1 or 2 parameters: <limit>, <'text' or 'dot'>");
+                                    "this function requires none , 1 or 2 parameters: <limit>, <'text', 'dot' or 'pb'>");
     return true;
   }
 
@@ -348,17 +459,19 @@ const char *pprof_cpu_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
                   report_type = "text";
           } else if (strcasecmp(report_type.c_str(), "DOT") == 0) {
                   report_type = "dot";
+          } else if (strcasecmp(report_type.c_str(), "PB") == 0) {
+                  report_type = "pb";
           } else {
                 mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
                                     ER_UDF_ERROR, 0, "profiler",
-                                    "wrong parameter it must be 'TEXT' or 'DOT'.");
+                                    "wrong parameter it must be 'TEXT', 'DOT' or 'PB'.");
                 *error = 1;
                 *is_null = 1;
                 return 0;
           }
   }
 
-  if (strcmp(cpuprof_status, "RUNNING") == 0) {
+  if (cpu_profile_running(cpuprof_dump_path + ".prof")) {
     mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
                                     ER_UDF_ERROR, 0, "profiler",
                                     "cpu profiler is still running, you need to stop it first.");
@@ -367,6 +480,31 @@ const char *pprof_cpu_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
     return 0;
   }
 
+  if (report_type == "pb") {
+    // profile.proto is written directly, neither pprof nor mysqld are needed
+    std::string filePath = cpuprof_dump_path + ".prof";
+    std::string buf;
+    if (!export_pprof(filePath, filePath + ".pb.gz", &buf)) {
+      mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "%s", buf.c_str());
+      *error = 1;
+      *is_null = 1;
+      return 0;
+    }
+    outp = (char *)malloc(buf.length() + 1);
+    if (outp == nullptr) {
+        *error = 1;
+        *is_null = 1;
+        return nullptr;
+    }
+    mysql_service_profiler_pfs->add("cpu", "profiler", "report", (filePath + ".pb.gz").c_str(), report_type.c_str());
+    strcpy(outp, buf.c_str());
+    *length = strlen(outp);
+
+    return const_cast<char *>(outp);
+  }
+
   std::string mysqld_binary;
   if (get_mysqld(&mysqld_binary)) {
     mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
@@ -392,9 +530,21 @@ const char *pprof_cpu_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
     return 0;
   }
 
+  // pprof can't read the compressed profiles
+  Plain_dump_file dump_file;
+  if (!dump_file.open(cpuprof_dump_path + ".prof")) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "could not read the cpu profile %s.prof",
+                                    cpuprof_dump_path.c_str());
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
   std::string buf;
   buf = exec_pprof((std::string(p_variable_value) + " --" +  report_type + " "
-                 + mysqld_binary + " " + cpuprof_dump_path + ".prof").c_str());
+                 + mysqld_binary + " " + dump_file.path()).c_str());
   
   if (limit > 0 && report_type == "text") {
     buf = limit_lines(buf, limit);
@@ -422,6 +572,8 @@ static mysql_service_status_t profiler_cpu_service_init() {
   log_bi = mysql_service_log_builtins;
   log_bs = mysql_service_log_builtins_string;
 
+  init_dump_store_client();
+
   //Todo check is thre is a value already if not set the default
 
 
@@ -462,6 +614,132 @@ static mysql_service_status_t profiler_cpu_service_init() {
 
   register_status_variables();
 
+  INTEGRAL_CHECK_ARG(uint) cpu_trigger_cpu_percent_arg;
+  cpu_trigger_cpu_percent_arg.def_val = 0;
+  cpu_trigger_cpu_percent_arg.min_val = 0;
+  cpu_trigger_cpu_percent_arg.max_val = 100000;
+  cpu_trigger_cpu_percent_arg.blk_sz = 0;
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "cpu_trigger_cpu_percent",
+          PLUGIN_VAR_INT | PLUGIN_VAR_UNSIGNED | PLUGIN_VAR_RQCMDARG,
+          "Process CPU usage (100 = one CPU) starting a cpu profile when reached for profiler.cpu_trigger_seconds, 0 disables it",
+          cpu_trigger_cpu_percent_check, cpu_trigger_update,
+          (void *)&cpu_trigger_cpu_percent_arg, (void *)&cpu_trigger_cpu_percent)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.cpu_trigger_cpu_percent'.");
+    result = 1;
+  } else {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.cpu_trigger_cpu_percent' has been registered successfully.");
+  }
+
+  INTEGRAL_CHECK_ARG(uint) cpu_trigger_threads_running_arg;
+  cpu_trigger_threads_running_arg.def_val = 0;
+  cpu_trigger_threads_running_arg.min_val = 0;
+  cpu_trigger_threads_running_arg.max_val = 100000;
+  cpu_trigger_threads_running_arg.blk_sz = 0;
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "cpu_trigger_threads_running",
+          PLUGIN_VAR_INT | PLUGIN_VAR_UNSIGNED | PLUGIN_VAR_RQCMDARG,
+          "Threads_running status variable starting a cpu profile when reached for profiler.cpu_trigger_seconds, 0 disables it",
+          cpu_trigger_threads_running_check, cpu_trigger_update,
+          (void *)&cpu_trigger_threads_running_arg, (void *)&cpu_trigger_threads_running)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.cpu_trigger_threads_running'.");
+    result = 1;
+  } else {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.cpu_trigger_threads_running' has been registered successfully.");
+  }
+
+  INTEGRAL_CHECK_ARG(uint) cpu_trigger_qps_drop_percent_arg;
+  cpu_trigger_qps_drop_percent_arg.def_val = 0;
+  cpu_trigger_qps_drop_percent_arg.min_val = 0;
+  cpu_trigger_qps_drop_percent_arg.max_val = 100;
+  cpu_trigger_qps_drop_percent_arg.blk_sz = 0;
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "cpu_trigger_qps_drop_percent",
+          PLUGIN_VAR_INT | PLUGIN_VAR_UNSIGNED | PLUGIN_VAR_RQCMDARG,
+          "Drop of the queries per second (Queries status variable) starting a cpu profile when it lasts profiler.cpu_trigger_seconds, 0 disables it",
+          cpu_trigger_qps_drop_percent_check, cpu_trigger_update,
+          (void *)&cpu_trigger_qps_drop_percent_arg, (void *)&cpu_trigger_qps_drop_percent)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.cpu_trigger_qps_drop_percent'.");
+    result = 1;
+  } else {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.cpu_trigger_qps_drop_percent' has been registered successfully.");
+  }
+
+  INTEGRAL_CHECK_ARG(uint) cpu_trigger_seconds_arg;
+  cpu_trigger_seconds_arg.def_val = DEFAULT_CPU_TRIGGER_SECONDS;
+  cpu_trigger_seconds_arg.min_val = 1;
+  cpu_trigger_seconds_arg.max_val = 3600;
+  cpu_trigger_seconds_arg.blk_sz = 0;
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "cpu_trigger_seconds",
+          PLUGIN_VAR_INT | PLUGIN_VAR_UNSIGNED | PLUGIN_VAR_RQCMDARG,
+          "Seconds a trigger condition must hold before the cpu profile is started",
+          cpu_trigger_seconds_check, cpu_trigger_update,
+          (void *)&cpu_trigger_seconds_arg, (void *)&cpu_trigger_seconds)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.cpu_trigger_seconds'.");
+    result = 1;
+  } else {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.cpu_trigger_seconds' has been registered successfully.");
+  }
+
+  INTEGRAL_CHECK_ARG(uint) cpu_trigger_duration_arg;
+  cpu_trigger_duration_arg.def_val = DEFAULT_CPU_TRIGGER_DURATION;
+  cpu_trigger_duration_arg.min_val = 1;
+  cpu_trigger_duration_arg.max_val = 3600;
+  cpu_trigger_duration_arg.blk_sz = 0;
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "cpu_trigger_duration",
+          PLUGIN_VAR_INT | PLUGIN_VAR_UNSIGNED | PLUGIN_VAR_RQCMDARG,
+          "Seconds a cpu profile started by a trigger lasts",
+          cpu_trigger_duration_check, cpu_trigger_update,
+          (void *)&cpu_trigger_duration_arg, (void *)&cpu_trigger_duration)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.cpu_trigger_duration'.");
+    result = 1;
+  } else {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.cpu_trigger_duration' has been registered successfully.");
+  }
+
+  INTEGRAL_CHECK_ARG(uint) cpu_trigger_cooldown_arg;
+  cpu_trigger_cooldown_arg.def_val = DEFAULT_CPU_TRIGGER_COOLDOWN;
+  cpu_trigger_cooldown_arg.min_val = 0;
+  cpu_trigger_cooldown_arg.max_val = 604800;
+  cpu_trigger_cooldown_arg.blk_sz = 0;
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "cpu_trigger_cooldown",
+          PLUGIN_VAR_INT | PLUGIN_VAR_UNSIGNED | PLUGIN_VAR_RQCMDARG,
+          "Minimum number of seconds between two cpu profiles started by a trigger",
+          cpu_trigger_cooldown_check, cpu_trigger_update,
+          (void *)&cpu_trigger_cooldown_arg, (void *)&cpu_trigger_cooldown)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.cpu_trigger_cooldown'.");
+    result = 1;
+  } else {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.cpu_trigger_cooldown' has been registered successfully.");
+  }
+
+  init_cpu_triggers();
+  // Only cpu profiles have nothing to dump during the run
+  init_profile_scheduler(PROFILE_SCHEDULE_CPU, read_profile_schedule,
+                         start_scheduled_profile, nullptr,
+                         stop_scheduled_profile);
+
   return result;
 }
 
@@ -472,13 +750,55 @@ static mysql_service_status_t profiler_cpu_service_deinit() {
 
   delete list;
 
+  deinit_profile_scheduler();
+  deinit_cpu_triggers();
+
   unregister_status_variables();
 
+  for (const char *variable :
+       {"cpu_trigger_cpu_percent", "cpu_trigger_threads_running",
+        "cpu_trigger_qps_drop_percent", "cpu_trigger_seconds",
+        "cpu_trigger_duration", "cpu_trigger_cooldown"}) {
+    if (mysql_service_component_sys_variable_unregister->unregister_variable(
+                "profiler", variable)) {
+      LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                (std::string("could not unregister variable 'profiler.") + variable + "'.").c_str());
+    } else {
+      LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                (std::string("variable 'profiler.") + variable + "' is now unregistered successfully.").c_str());
+    }
+  }
+
+  deinit_dump_store_client();
+
   LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG, "uninstalled.");
 
   return result;
 }
 
+bool read_global_status(const char *name, unsigned long long *value) {
+#if MYSQL_VERSION_ID >= 80100
+  my_h_string status = nullptr;
+  // Without session the global value is read
+  if (mysql_service_mysql_status_variable_string->get(nullptr, name, true,
+                                                      &status) ||
+      status == nullptr)
+    return false;
+  char buffer[32];
+  bool converted = !mysql_service_mysql_string_converter->convert_to_buffer(
+      status, buffer, sizeof(buffer), "utf8mb4");
+  mysql_service_mysql_string_factory->destroy(status);
+  if (!converted) return false;
+  char *end;
+  *value = strtoull(buffer, &end, 10);
+  return end != buffer && *end == '\0';
+#else
+  (void)name;
+  (void)value;
+  return false;
+#endif
+}
+
 BEGIN_COMPONENT_PROVIDES(profiler_cpu_service)
 END_COMPONENT_PROVIDES();
 
@@ -497,9 +817,15 @@ BEGIN_COMPONENT_REQUIRES(profiler_cpu_service)
     REQUIRES_SERVICE(mysql_runtime_error), 
 #if MYSQL_VERSION_ID >= 90000
     REQUIRES_SERVICE(mysql_system_variable_reader),
+#endif
+#if MYSQL_VERSION_ID >= 80100
+    REQUIRES_SERVICE(mysql_status_variable_string),
+    REQUIRES_SERVICE(mysql_string_converter),
+    REQUIRES_SERVICE(mysql_string_factory),
 #endif
     REQUIRES_SERVICE(profiler_var),
     REQUIRES_SERVICE(profiler_pfs),
+    REQUIRES_SERVICE(profiler_dump_store),
 END_COMPONENT_REQUIRES();
 
 /* A list of metadata to describe the Component. */
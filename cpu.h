@@ -25,4 +25,20 @@
 #include "common.h"
 #include <gperftools/profiler.h>
 #include "profiler_service.h"
+#include "pprof_proto.h"
+#include "dump_io.h"
+#include "dump_store_client.h"
 
+// Name of the next profile of a series: <dump_path>.<kind>.NNNN.prof.
+// Returns false if profiler.dump_path can't be read.
+extern bool next_cpu_profile_name(const char *kind, std::string *filePath);
+// Start the cpu profiler writing filePath, reason is logged in
+// profiler_actions. Returns false if it's already running.
+extern bool start_cpu_profile(const std::string& filePath, const char *reason);
+// Stop the cpu profiler if it's writing filePath, whatever it writes if
+// filePath is empty
+extern bool stop_cpu_profile(const std::string& filePath, const char *reason);
+// Global value of a numeric status variable (Threads_running, Queries).
+// Returns false if it can't be read, always before MySQL 8.1 which has no
+// status variable reader.
+extern bool read_global_status(const char *name, unsigned long long *value);
@@ -0,0 +1,340 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#include "cpu.h"
+#include "cpu_triggers.h"
+
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+unsigned int cpu_trigger_cpu_percent = 0;
+unsigned int cpu_trigger_threads_running = 0;
+unsigned int cpu_trigger_qps_drop_percent = 0;
+unsigned int cpu_trigger_seconds = DEFAULT_CPU_TRIGGER_SECONDS;
+unsigned int cpu_trigger_duration = DEFAULT_CPU_TRIGGER_DURATION;
+unsigned int cpu_trigger_cooldown = DEFAULT_CPU_TRIGGER_COOLDOWN;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const std::chrono::seconds trigger_interval(1);
+// The QPS baseline is a moving average over about a minute, it's only
+// meaningful on a server doing some work
+const double QPS_BASELINE_WEIGHT = 1.0 / 60;
+const double QPS_MIN_BASELINE = 10;
+
+std::mutex trigger_mutex;
+std::condition_variable trigger_cond;
+std::thread trigger_thread;
+bool trigger_stopping = false;
+
+struct Trigger_state {
+  bool sampled = false;
+  Clock::time_point last_sample;
+  uint64_t last_ticks = 0;
+  uint64_t last_queries = 0;
+  double qps_baseline = 0;
+  // Consecutive seconds each condition held
+  unsigned int cpu_seconds = 0;
+  unsigned int threads_seconds = 0;
+  unsigned int qps_seconds = 0;
+
+  bool capturing = false;
+  std::string capture_file;
+  Clock::time_point capture_started;
+  bool cooling_down = false;
+  Clock::time_point capture_ended;
+} state;
+
+// utime + stime of the process in clock ticks
+bool read_process_ticks(uint64_t *ticks) {
+  FILE *f = fopen("/proc/self/stat", "r");
+  if (f == nullptr) return false;
+  char buf[1024];
+  size_t length = fread(buf, 1, sizeof(buf) - 1, f);
+  fclose(f);
+  buf[length] = '\0';
+  // The name of the process may contain spaces, the fields start after it
+  const char *fields = strrchr(buf, ')');
+  unsigned long long utime, stime;
+  if (fields == nullptr ||
+      sscanf(fields + 1,
+             " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime,
+             &stime) != 2)
+    return false;
+  *ticks = utime + stime;
+  return true;
+}
+
+unsigned int count_seconds(bool holds, unsigned int seconds) {
+  return holds ? seconds + 1 : 0;
+}
+
+void start_capture(const char *reason) {
+  if (state.cooling_down &&
+      Clock::now() - state.capture_ended <
+          std::chrono::seconds(cpu_trigger_cooldown))
+    return;
+
+  std::string filePath;
+  if (!next_cpu_profile_name("trigger", &filePath)) return;
+  // When cpuprof_start() got there first, the trigger waits for the cooldown
+  state.cooling_down = true;
+  state.capture_ended = Clock::now();
+  if (!start_cpu_profile(filePath, reason)) {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    (std::string(reason) + ", capture skipped: the cpu profiler is already running.").c_str());
+    return;
+  }
+  state.capturing = true;
+  state.capture_file = filePath;
+  state.capture_started = Clock::now();
+  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                  (std::string(reason) + ", cpu profile written to " + filePath).c_str());
+}
+
+void stop_capture(const char *reason) {
+  // Stopped by cpuprof_stop() otherwise
+  stop_cpu_profile(state.capture_file, reason);
+  state.capturing = false;
+  state.cooling_down = true;
+  state.capture_ended = Clock::now();
+}
+
+void check_triggers() {
+  if (cpu_trigger_cpu_percent == 0 && cpu_trigger_threads_running == 0 &&
+      cpu_trigger_qps_drop_percent == 0 && !state.capturing) {
+    state.sampled = false;
+    state.qps_baseline = 0;
+    state.cpu_seconds = state.threads_seconds = state.qps_seconds = 0;
+    return;
+  }
+  Clock::time_point now = Clock::now();
+  uint64_t ticks = 0;
+  bool have_ticks = read_process_ticks(&ticks);
+  // Only read when their trigger is set
+  unsigned long long queries = 0, running = 0;
+  bool have_queries = cpu_trigger_qps_drop_percent > 0 &&
+                      read_global_status("Queries", &queries);
+  bool have_running = cpu_trigger_threads_running > 0 &&
+                      read_global_status("Threads_running", &running);
+
+  if (!state.sampled) {
+    state.sampled = true;
+    state.last_sample = now;
+    state.last_ticks = ticks;
+    state.last_queries = queries;
+    return;
+  }
+  double seconds =
+      std::chrono::duration<double>(now - state.last_sample).count();
+  if (seconds <= 0) return;
+  double cpu_percent =
+      have_ticks ? (ticks - state.last_ticks) * 100.0 / sysconf(_SC_CLK_TCK) /
+                       seconds
+                 : 0;
+  // Counted from the next sample when the trigger was just set
+  bool have_qps = have_queries && state.last_queries > 0 &&
+                  queries >= state.last_queries;
+  double qps = have_qps ? (queries - state.last_queries) / seconds : 0;
+  state.last_sample = now;
+  state.last_ticks = ticks;
+  state.last_queries = queries;
+
+  state.cpu_seconds =
+      count_seconds(cpu_trigger_cpu_percent > 0 && have_ticks &&
+                        cpu_percent >= cpu_trigger_cpu_percent,
+                    state.cpu_seconds);
+  state.threads_seconds =
+      count_seconds(have_running && running >= cpu_trigger_threads_running,
+                    state.threads_seconds);
+  bool qps_dropped =
+      have_qps && state.qps_baseline >= QPS_MIN_BASELINE &&
+      qps <= state.qps_baseline * (100 - cpu_trigger_qps_drop_percent) / 100;
+  state.qps_seconds = count_seconds(qps_dropped, state.qps_seconds);
+  // The baseline is kept during the drop, or it would follow it
+  if (have_qps && !qps_dropped)
+    state.qps_baseline += (qps - state.qps_baseline) * QPS_BASELINE_WEIGHT;
+
+  if (state.capturing) {
+    if (now - state.capture_started >=
+        std::chrono::seconds(cpu_trigger_duration)) {
+      char reason[64];
+      snprintf(reason, sizeof(reason), "trigger: %u s", cpu_trigger_duration);
+      stop_capture(reason);
+    }
+    return;
+  }
+
+  char reason[128];
+  if (cpu_trigger_cpu_percent > 0 && state.cpu_seconds >= cpu_trigger_seconds)
+    snprintf(reason, sizeof(reason), "trigger: cpu %.0f%% for %u s",
+             cpu_percent, state.cpu_seconds);
+  else if (cpu_trigger_threads_running > 0 &&
+           state.threads_seconds >= cpu_trigger_seconds)
+    snprintf(reason, sizeof(reason), "trigger: %llu threads running for %u s",
+             running, state.threads_seconds);
+  else if (cpu_trigger_qps_drop_percent > 0 &&
+           state.qps_seconds >= cpu_trigger_seconds)
+    snprintf(reason, sizeof(reason),
+             "trigger: %.0f qps instead of %.0f for %u s", qps,
+             state.qps_baseline, state.qps_seconds);
+  else
+    return;
+  start_capture(reason);
+}
+
+void trigger_thread_run() {
+  std::unique_lock<std::mutex> lock(trigger_mutex);
+  while (!trigger_stopping) {
+    trigger_cond.wait_for(lock, trigger_interval,
+                          [] { return trigger_stopping; });
+    if (trigger_stopping) break;
+    lock.unlock();
+    check_triggers();
+    lock.lock();
+  }
+}
+
+int check_range(MYSQL_THD thd, const char *variable, long long min,
+                long long max, const char *unit, void *save,
+                struct st_mysql_value *value) {
+  if (!check_variable_privilege(thd, variable))
+    return (ER_SPECIFIC_ACCESS_DENIED_ERROR);
+
+  long long new_value = 0;
+  if (value->val_int(value, &new_value) || new_value < min ||
+      new_value > max) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "wrong value it must be a number of %s between %lld and %lld.",
+                                    unit, min, max);
+    return true;
+  }
+
+  *static_cast<unsigned int *>(save) = new_value;
+
+  return (0);
+}
+
+#if MYSQL_VERSION_ID < 80100
+// Threads_running and Queries can't be read by a component before 8.1, only 0
+// is accepted
+bool status_trigger_supported(MYSQL_THD thd, const char *variable,
+                              struct st_mysql_value *value) {
+  long long new_value = 0;
+  if (value->val_int(value, &new_value) || new_value == 0) return true;
+  if (!check_variable_privilege(thd, variable)) return false;
+  mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                  ER_UDF_ERROR, 0, "profiler",
+                                  "%s requires MySQL 8.1 or later.", variable);
+  return false;
+}
+#endif
+
+}  // namespace
+
+void init_cpu_triggers() {
+  std::lock_guard<std::mutex> guard(trigger_mutex);
+  state = Trigger_state();
+  trigger_stopping = false;
+  trigger_thread = std::thread(trigger_thread_run);
+}
+
+void deinit_cpu_triggers() {
+  {
+    std::lock_guard<std::mutex> guard(trigger_mutex);
+    trigger_stopping = true;
+  }
+  trigger_cond.notify_all();
+  if (trigger_thread.joinable()) trigger_thread.join();
+  // The capture would never be completed
+  if (state.capturing) stop_capture("trigger: uninstalled");
+}
+
+int cpu_trigger_cpu_percent_check(MYSQL_THD thd,
+                                  SYS_VAR *self MY_ATTRIBUTE((unused)),
+                                  void *save, struct st_mysql_value *value) {
+  return check_range(thd, "profiler.cpu_trigger_cpu_percent", 0, 100000,
+                     "percents", save, value);
+}
+
+int cpu_trigger_threads_running_check(MYSQL_THD thd,
+                                      SYS_VAR *self MY_ATTRIBUTE((unused)),
+                                      void *save,
+                                      struct st_mysql_value *value) {
+#if MYSQL_VERSION_ID < 80100
+  if (!status_trigger_supported(thd, "profiler.cpu_trigger_threads_running",
+                                value))
+    return true;
+#endif
+  return check_range(thd, "profiler.cpu_trigger_threads_running", 0, 100000,
+                     "threads", save, value);
+}
+
+int cpu_trigger_qps_drop_percent_check(MYSQL_THD thd,
+                                       SYS_VAR *self MY_ATTRIBUTE((unused)),
+                                       void *save,
+                                       struct st_mysql_value *value) {
+#if MYSQL_VERSION_ID < 80100
+  if (!status_trigger_supported(thd, "profiler.cpu_trigger_qps_drop_percent",
+                                value))
+    return true;
+#endif
+  return check_range(thd, "profiler.cpu_trigger_qps_drop_percent", 0, 100,
+                     "percents", save, value);
+}
+
+int cpu_trigger_seconds_check(MYSQL_THD thd,
+                              SYS_VAR *self MY_ATTRIBUTE((unused)), void *save,
+                              struct st_mysql_value *value) {
+  return check_range(thd, "profiler.cpu_trigger_seconds", 1, 3600, "seconds",
+                     save, value);
+}
+
+int cpu_trigger_duration_check(MYSQL_THD thd,
+                               SYS_VAR *self MY_ATTRIBUTE((unused)),
+                               void *save, struct st_mysql_value *value) {
+  return check_range(thd, "profiler.cpu_trigger_duration", 1, 3600, "seconds",
+                     save, value);
+}
+
+int cpu_trigger_cooldown_check(MYSQL_THD thd,
+                               SYS_VAR *self MY_ATTRIBUTE((unused)),
+                               void *save, struct st_mysql_value *value) {
+  return check_range(thd, "profiler.cpu_trigger_cooldown", 0, 604800,
+                     "seconds", save, value);
+}
+
+void cpu_trigger_update(MYSQL_THD, SYS_VAR *, void *var_ptr,
+                        const void *save) {
+  std::lock_guard<std::mutex> guard(trigger_mutex);
+  *static_cast<unsigned int *>(var_ptr) =
+      *static_cast<const unsigned int *>(save);
+}
@@ -0,0 +1,71 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#ifndef PROFILER_CPU_TRIGGERS_H
+#define PROFILER_CPU_TRIGGERS_H
+
+#include "common.h"
+
+#define DEFAULT_CPU_TRIGGER_SECONDS 10
+#define DEFAULT_CPU_TRIGGER_DURATION 30
+#define DEFAULT_CPU_TRIGGER_COOLDOWN 3600
+
+// Values of the profiler.cpu_trigger_* global variables. A trigger fires
+// when its condition holds for cpu_trigger_seconds in a row, 0 disables it.
+// Process CPU usage, 100 is one CPU
+extern unsigned int cpu_trigger_cpu_percent;
+// Threads_running status variable, MySQL 8.1 or later
+extern unsigned int cpu_trigger_threads_running;
+// Drop of the queries per second (Queries status variable) compared to the
+// average of the last minutes, MySQL 8.1 or later
+extern unsigned int cpu_trigger_qps_drop_percent;
+extern unsigned int cpu_trigger_seconds;
+// Length of a capture and minimum time between two captures in seconds
+extern unsigned int cpu_trigger_duration;
+extern unsigned int cpu_trigger_cooldown;
+
+// Background thread of component_profiler_cpu checking the triggers every
+// second. A capture is written as <dump_path>.trigger.NNNN.prof.
+extern void init_cpu_triggers();
+extern void deinit_cpu_triggers();
+
+extern int cpu_trigger_cpu_percent_check(MYSQL_THD thd, SYS_VAR *self,
+                                         void *save,
+                                         struct st_mysql_value *value);
+extern int cpu_trigger_threads_running_check(MYSQL_THD thd, SYS_VAR *self,
+                                             void *save,
+                                             struct st_mysql_value *value);
+extern int cpu_trigger_qps_drop_percent_check(MYSQL_THD thd, SYS_VAR *self,
+                                              void *save,
+                                              struct st_mysql_value *value);
+extern int cpu_trigger_seconds_check(MYSQL_THD thd, SYS_VAR *self, void *save,
+                                     struct st_mysql_value *value);
+extern int cpu_trigger_duration_check(MYSQL_THD thd, SYS_VAR *self,
+                                      void *save,
+                                      struct st_mysql_value *value);
+extern int cpu_trigger_cooldown_check(MYSQL_THD thd, SYS_VAR *self,
+                                      void *save,
+                                      struct st_mysql_value *value);
+extern void cpu_trigger_update(MYSQL_THD thd, SYS_VAR *self, void *var_ptr,
+                               const void *save);
+
+#endif /* PROFILER_CPU_TRIGGERS_H */
@@ -0,0 +1,314 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#include "dump_catalog.h"
+#include "dump_io.h"
+#include "dump_store.h"
+#include "symbolizer.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+namespace {
+
+std::mutex dump_catalog_mutex;
+// Ordered by path: the dumps of a prefix are a range
+std::map<std::string, Dump_entry> dump_entries;
+// Last complete dump and start of the running session of each profiler
+std::map<std::string, std::string> last_dumps;
+std::map<std::string, time_t> session_starts;
+uint64_t dump_sequence = 0;
+std::string mysqld_build_id;
+// <profiler.dump_path>.catalog, the complete dumps are appended to it so the
+// ones of the previous runs are known after a restart
+std::string journal_path;
+
+std::string profiler_key(const std::string& type, const std::string& allocator) {
+  return type + "/" + allocator;
+}
+
+Dump_entry& catalog_entry(const std::string& path, const std::string& type,
+                          const std::string& allocator) {
+  auto it = dump_entries.find(path);
+  if (it != dump_entries.end()) return it->second;
+  Dump_entry& entry = dump_entries[path];
+  entry.path = path;
+  entry.type = type;
+  entry.allocator = allocator;
+  entry.build_id = mysqld_build_id;
+  entry.sequence = ++dump_sequence;
+  return entry;
+}
+
+// One line per record, the path comes last:
+//   D <type> <allocator> <started> <ended> <samples> <build id> <path>
+//   R <path>
+// with the fields separated by tabs
+std::string journal_record(const Dump_entry& entry) {
+  std::ostringstream record;
+  record << "D\t" << entry.type << '\t' << entry.allocator << '\t'
+         << entry.started << '\t' << entry.ended << '\t' << entry.samples
+         << '\t' << entry.build_id << '\t' << entry.path << '\n';
+  return record.str();
+}
+
+void journal_append(const std::string& path, const std::string& record) {
+  // Such names can't be read back
+  if (journal_path.empty() || path.find_first_of("\t\n") != std::string::npos)
+    return;
+  int fd = open(journal_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+                0640);
+  if (fd < 0) return;
+  ssize_t written = write(fd, record.data(), record.size());
+  (void)written;
+  close(fd);
+}
+
+void journal_entry(const Dump_entry& entry) {
+  journal_append(entry.path, journal_record(entry));
+}
+
+void journal_removal(const std::string& path) {
+  journal_append(path, "R\t" + path + "\n");
+}
+
+bool parse_journal_record(const std::string& line, Dump_entry* entry) {
+  std::vector<std::string> fields;
+  size_t start = 0;
+  while (fields.size() < 7) {
+    size_t tab = line.find('\t', start);
+    if (tab == std::string::npos) return false;
+    fields.push_back(line.substr(start, tab - start));
+    start = tab + 1;
+  }
+  entry->path = line.substr(start);
+  if (fields[0] != "D" || entry->path.empty()) return false;
+  entry->type = fields[1];
+  entry->allocator = fields[2];
+  entry->build_id = fields[6];
+  char* end;
+  entry->started = strtoll(fields[3].c_str(), &end, 10);
+  if (*end != '\0') return false;
+  entry->ended = strtoll(fields[4].c_str(), &end, 10);
+  if (*end != '\0') return false;
+  entry->samples = strtoll(fields[5].c_str(), &end, 10);
+  return *end == '\0';
+}
+
+}  // namespace
+
+void init_dump_catalog() {
+  char exe[PATH_MAX];
+  ssize_t n = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+  std::lock_guard<std::mutex> guard(dump_catalog_mutex);
+  if (n > 0) {
+    exe[n] = '\0';
+    mysqld_build_id = get_build_id(exe);
+  }
+}
+
+void dump_catalog_open_journal(const std::string& prefix) {
+  std::lock_guard<std::mutex> guard(dump_catalog_mutex);
+  journal_path = prefix.empty() ? "" : prefix + ".catalog";
+  if (journal_path.empty()) return;
+
+  // Replay the journal: last record of each dump wins, in the order the dumps
+  // were first recorded
+  std::map<std::string, std::pair<size_t, Dump_entry>> records;
+  std::ifstream in(journal_path);
+  std::string line;
+  for (size_t order = 0; std::getline(in, line); ++order) {
+    if (line.compare(0, 2, "R\t") == 0) {
+      records.erase(line.substr(2));
+      continue;
+    }
+    Dump_entry entry;
+    if (!parse_journal_record(line, &entry)) continue;
+    auto it = records.find(entry.path);
+    if (it == records.end())
+      records.emplace(entry.path, std::make_pair(order, entry));
+    else
+      it->second.second = entry;
+  }
+  if (!in.eof() && in.fail()) return;
+  in.close();
+
+  std::vector<std::pair<size_t, Dump_entry>> replayed;
+  for (auto& record : records) {
+    // Removed while the component wasn't loaded
+    if (dump_entries.count(record.first) != 0 ||
+        !dump_file_exists(record.first))
+      continue;
+    replayed.push_back(std::move(record.second));
+  }
+  std::sort(replayed.begin(), replayed.end(),
+            [](const std::pair<size_t, Dump_entry>& a,
+               const std::pair<size_t, Dump_entry>& b) {
+              return a.first < b.first;
+            });
+
+  // Rewritten with the dumps still existing so it doesn't grow forever
+  std::string compacted = journal_path + ".tmp";
+  std::ofstream out(compacted, std::ios::trunc);
+  for (auto& record : replayed) {
+    Dump_entry& entry = record.second;
+    out << journal_record(entry);
+    entry.sequence = ++dump_sequence;
+    if (entry.type != "profile")
+      last_dumps[profiler_key(entry.type, entry.allocator)] = entry.path;
+    dump_entries.emplace(entry.path, std::move(entry));
+  }
+  out.close();
+  if (!out.fail() && rename(compacted.c_str(), journal_path.c_str()) == 0)
+    return;
+  unlink(compacted.c_str());
+}
+
+void dump_catalog_clear() {
+  std::lock_guard<std::mutex> guard(dump_catalog_mutex);
+  dump_entries.clear();
+  journal_path.clear();
+  last_dumps.clear();
+  session_starts.clear();
+}
+
+bool dump_catalog_event(const std::string& type, const std::string& allocator,
+                        const std::string& action, const std::string& path) {
+  time_t now = time(nullptr);
+  std::string key = profiler_key(type, allocator);
+  std::lock_guard<std::mutex> guard(dump_catalog_mutex);
+
+  if (action == "started") {
+    session_starts[key] = now;
+    // The cpu profile is written from the start
+    if (!path.empty()) catalog_entry(path, type, allocator).started = now;
+    return false;
+  }
+  if (path.empty()) return false;
+
+  if (action == "dumped" || action == "stopped" || action == "sampled") {
+    Dump_entry& entry = catalog_entry(path, type, allocator);
+    // Heap samples are taken without profiler session
+    if (entry.started == 0) {
+      auto session = session_starts.find(key);
+      entry.started = (session != session_starts.end() && action != "sampled")
+                          ? session->second : now;
+    }
+    entry.ended = now;
+    last_dumps[key] = path;
+    journal_entry(entry);
+    return true;
+  }
+  // Files derived from the dumps
+  if (action == "exported" || action == "persist" || action == "report") {
+    Dump_entry& entry = catalog_entry(path, "profile", allocator);
+    entry.started = entry.ended = now;
+    journal_entry(entry);
+  }
+  return false;
+}
+
+void dump_catalog_set_samples(const std::string& path, int64_t samples) {
+  std::lock_guard<std::mutex> guard(dump_catalog_mutex);
+  auto it = dump_entries.find(path);
+  if (it == dump_entries.end()) return;
+  it->second.samples = samples;
+  if (it->second.ended != 0) journal_entry(it->second);
+}
+
+bool dump_catalog_last(const std::string& type, const std::string& allocator,
+                       std::string *path) {
+  std::lock_guard<std::mutex> guard(dump_catalog_mutex);
+  auto it = last_dumps.find(profiler_key(type, allocator));
+  if (it == last_dumps.end() || dump_entries.count(it->second) == 0)
+    return false;
+  *path = it->second;
+  return true;
+}
+
+void dump_catalog_remove(const std::string& path) {
+  std::lock_guard<std::mutex> guard(dump_catalog_mutex);
+  if (dump_entries.erase(path) != 0) journal_removal(path);
+}
+
+void dump_catalog_remove_prefix(const std::string& prefix,
+                                std::vector<std::string> *paths) {
+  std::lock_guard<std::mutex> guard(dump_catalog_mutex);
+  auto it = dump_entries.lower_bound(prefix);
+  while (it != dump_entries.end() &&
+         it->first.compare(0, prefix.size(), prefix) == 0) {
+    paths->push_back(it->first);
+    journal_removal(it->first);
+    it = dump_entries.erase(it);
+  }
+}
+
+size_t dump_catalog_count() {
+  std::lock_guard<std::mutex> guard(dump_catalog_mutex);
+  return dump_entries.size();
+}
+
+void dump_catalog_list(std::vector<Dump_entry> *entries) {
+  std::vector<Dump_entry> all;
+  {
+    std::lock_guard<std::mutex> guard(dump_catalog_mutex);
+    all.reserve(dump_entries.size());
+    for (const auto& entry : dump_entries) all.push_back(entry.second);
+  }
+  std::sort(all.begin(), all.end(), [](const Dump_entry& a, const Dump_entry& b) {
+    return a.sequence < b.sequence;
+  });
+
+  // Dumps removed behind our back are forgotten
+  std::vector<std::string> gone;
+  for (Dump_entry& entry : all) {
+    Dump_location location;
+    struct stat st;
+    if (!find_dump_file(entry.path, &location) || !location.stat(&st)) {
+      gone.push_back(entry.path);
+      continue;
+    }
+    entry.in_memory = location.in_memory();
+    // Descriptors are not shown, they are only valid while the location is
+    // held
+    entry.location = entry.in_memory
+                         ? "memfd:" + entry.path.substr(entry.path.find_last_of('/') + 1)
+                         : location.path();
+    entry.size = st.st_size;
+    entries->push_back(entry);
+  }
+
+  if (gone.empty()) return;
+  std::lock_guard<std::mutex> guard(dump_catalog_mutex);
+  for (const std::string& path : gone)
+    if (dump_entries.erase(path) != 0) journal_removal(path);
+}
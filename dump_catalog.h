@@ -0,0 +1,77 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#ifndef PROFILER_DUMP_CATALOG_H
+#define PROFILER_DUMP_CATALOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+// Every dump produced while the component is loaded, fed by the actions
+// reported to profiler_actions, and the ones of the previous runs found in the
+// journal
+struct Dump_entry {
+  std::string path;
+  std::string type;
+  std::string allocator;
+  std::string build_id;
+  // Number of samples, -1 until the dump has been read
+  int64_t samples = -1;
+  time_t started = 0;
+  time_t ended = 0;
+  uint64_t sequence = 0;
+
+  // Resolved when listed: the dump may have been compressed or kept in memory
+  std::string location;
+  bool in_memory = false;
+  uint64_t size = 0;
+};
+
+extern void init_dump_catalog();
+// Load the dumps recorded in <prefix>.catalog by the previous runs and record
+// the new ones there
+extern void dump_catalog_open_journal(const std::string& prefix);
+// Forget the dumps, the journal is kept
+extern void dump_catalog_clear();
+
+// Record an action of profiler_actions, the ones concerning a file create or
+// complete its entry. Returns true when the dump is complete.
+extern bool dump_catalog_event(const std::string& type,
+                               const std::string& allocator,
+                               const std::string& action,
+                               const std::string& path);
+extern void dump_catalog_set_samples(const std::string& path, int64_t samples);
+// Last complete dump of a profiler
+extern bool dump_catalog_last(const std::string& type,
+                              const std::string& allocator, std::string* path);
+extern void dump_catalog_remove(const std::string& path);
+// Forget the dumps starting with the prefix, their paths are returned
+extern void dump_catalog_remove_prefix(const std::string& prefix,
+                                       std::vector<std::string>* paths);
+extern size_t dump_catalog_count();
+// Dumps still existing, in the order they were produced
+extern void dump_catalog_list(std::vector<Dump_entry>* entries);
+
+#endif /* PROFILER_DUMP_CATALOG_H */
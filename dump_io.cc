@@ -0,0 +1,489 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#include "dump_io.h"
+
+#include <zlib.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <strings.h>
+
+namespace {
+
+const size_t DUMP_IO_CHUNK = 1024 * 1024;
+
+bool write_all(int fd, const char *data, size_t length) {
+  while (length > 0) {
+    ssize_t n = ::write(fd, data, length);
+    if (n < 0) return false;
+    data += n;
+    length -= n;
+  }
+  return true;
+}
+
+bool ends_with(const std::string& s, const char *suffix) {
+  size_t n = strlen(suffix);
+  return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+Dump_locator dump_store_find = nullptr;
+Dump_locator dump_store_create = nullptr;
+
+}  // namespace
+
+void set_dump_store_locators(Dump_locator find, Dump_locator create) {
+  dump_store_find = find;
+  dump_store_create = create;
+}
+
+void Dump_location::reset() {
+  if (m_fd >= 0) ::close(m_fd);
+  m_fd = -1;
+  m_in_memory = false;
+  m_path.clear();
+}
+
+void Dump_location::set_file(const std::string& path) {
+  reset();
+  m_path = path;
+}
+
+void Dump_location::set_memory(int fd) {
+  reset();
+  m_fd = fd;
+  m_in_memory = true;
+  // The external tools are other processes, they need our pid
+  m_path = "/proc/" + std::to_string(getpid()) + "/fd/" + std::to_string(fd);
+}
+
+bool Dump_location::pin() {
+  if (m_fd >= 0) return true;
+  int fd = ::open(m_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+  m_fd = fd;
+  m_path = "/proc/" + std::to_string(getpid()) + "/fd/" + std::to_string(fd);
+  return true;
+}
+
+bool Dump_location::stat(struct stat *st) const {
+  if (m_fd >= 0) return fstat(m_fd, st) == 0;
+  return !m_path.empty() && ::stat(m_path.c_str(), st) == 0;
+}
+
+void dump_write_location(const std::string& path, Dump_location *location) {
+  int fd = dump_store_create != nullptr ? dump_store_create(path) : -1;
+  if (fd >= 0)
+    location->set_memory(fd);
+  else
+    location->set_file(path);
+}
+
+int parse_dump_compression(const char *name) {
+  if (name == nullptr || strcasecmp(name, "NONE") == 0)
+    return DUMP_COMPRESSION_NONE;
+  if (strcasecmp(name, "GZIP") == 0) return DUMP_COMPRESSION_GZIP;
+  if (strcasecmp(name, "ZLIB") == 0) return DUMP_COMPRESSION_ZLIB;
+  return -1;
+}
+
+const char *dump_compression_suffix(int compression) {
+  switch (compression) {
+    case DUMP_COMPRESSION_GZIP:
+      return ".gz";
+    case DUMP_COMPRESSION_ZLIB:
+      return ".zz";
+    default:
+      return "";
+  }
+}
+
+std::string strip_compression_suffix(const std::string& path) {
+  for (int c : {DUMP_COMPRESSION_GZIP, DUMP_COMPRESSION_ZLIB}) {
+    if (ends_with(path, dump_compression_suffix(c)))
+      return path.substr(0, path.size() - strlen(dump_compression_suffix(c)));
+  }
+  return path;
+}
+
+bool find_dump_file(const std::string& path, Dump_location *location) {
+  location->reset();
+  int fd = dump_store_find != nullptr ? dump_store_find(path) : -1;
+  if (fd >= 0) {
+    location->set_memory(fd);
+    return true;
+  }
+  struct stat st;
+  if (stat(path.c_str(), &st) == 0) {
+    location->set_file(path);
+    return true;
+  }
+  for (int c : {DUMP_COMPRESSION_GZIP, DUMP_COMPRESSION_ZLIB}) {
+    std::string compressed = path + dump_compression_suffix(c);
+    if (stat(compressed.c_str(), &st) == 0) {
+      location->set_file(compressed);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool dump_file_exists(const std::string& path) {
+  Dump_location location;
+  return find_dump_file(path, &location);
+}
+
+bool stat_dump_file(const std::string& path, struct stat *st) {
+  Dump_location location;
+  return find_dump_file(path, &location) && location.stat(st);
+}
+
+bool list_files_with_prefix(const std::string& prefix,
+                            std::vector<std::string>* paths) {
+  namespace fs = std::filesystem;
+  fs::path p(prefix);
+  std::string name = p.filename().string();
+  std::error_code ec;
+  fs::directory_iterator it(p.has_parent_path() ? p.parent_path() : ".", ec);
+  if (ec) return false;
+  for (; it != fs::directory_iterator(); it.increment(ec)) {
+    if (ec) return false;
+    std::error_code type_ec;
+    if (it->is_regular_file(type_ec) &&
+        it->path().filename().string().compare(0, name.size(), name) == 0)
+      paths->push_back(it->path().string());
+  }
+  return true;
+}
+
+bool is_dump_file_name(const std::string& prefix, const std::string& path) {
+  std::string name = strip_compression_suffix(path);
+  if (name.size() <= prefix.size() + 1 ||
+      name.compare(0, prefix.size(), prefix) != 0 || name[prefix.size()] != '.')
+    return false;
+  std::vector<std::string> parts;
+  std::istringstream rest(name.substr(prefix.size() + 1));
+  std::string part;
+  while (std::getline(rest, part, '.')) {
+    if (part.empty()) return false;
+    for (char c : part)
+      if (!isalnum((unsigned char)c) && c != '_' && c != '-') return false;
+    parts.push_back(part);
+  }
+  if (name.back() == '.' || parts.empty()) return false;
+  if (parts.back() == "prof") return true;
+  if (parts.back() != "heap" || parts.size() < 2 || parts.size() > 3)
+    return false;
+  // The dumps of the tcmalloc component are tagged with 'm'
+  const std::string& number = parts[parts.size() - 2];
+  size_t digits = number[0] == 'm' ? 1 : 0;
+  return number.size() > digits &&
+         number.find_first_not_of("0123456789", digits) == std::string::npos;
+}
+
+bool Dump_reader::open(const std::string& path) {
+  close();
+  // The dump may have been compressed in the background meanwhile or be
+  // kept in memory
+  Dump_location location;
+  if (!find_dump_file(path, &location)) return false;
+  // Our own open file, the in-memory dump stays readable once the location
+  // is released
+  m_fd = ::open(location.path().c_str(), O_RDONLY | O_CLOEXEC);
+  // Compressed between the lookup and the open, the compressed version
+  // exists before the plain one is removed
+  if (m_fd < 0 && errno == ENOENT && !location.in_memory() &&
+      find_dump_file(path, &location))
+    m_fd = ::open(location.path().c_str(), O_RDONLY | O_CLOEXEC);
+  if (m_fd < 0) return false;
+  m_path = location.in_memory() ? path : location.path();
+
+  if (location.in_memory() || strip_compression_suffix(m_path) == m_path)
+    return true;
+
+  m_stream = new z_stream;
+  memset(m_stream, 0, sizeof(z_stream));
+  // 15 + 32: maximum window size, detect the gzip or zlib header
+  if (inflateInit2(m_stream, 15 + 32) != Z_OK) {
+    close();
+    return false;
+  }
+  m_stream_end = false;
+  m_input.resize(DUMP_IO_CHUNK);
+  return true;
+}
+
+ssize_t Dump_reader::read(char *buffer, size_t length) {
+  if (m_fd < 0) return -1;
+  if (m_stream == nullptr) return ::read(m_fd, buffer, length);
+
+  m_stream->next_out = reinterpret_cast<Bytef *>(buffer);
+  m_stream->avail_out = length;
+  while (m_stream->avail_out > 0 && !m_stream_end) {
+    if (m_stream->avail_in == 0) {
+      ssize_t n = ::read(m_fd, m_input.data(), m_input.size());
+      // A stream cut before its end is a truncated dump, not a shorter one
+      if (n <= 0) return -1;
+      m_stream->next_in = reinterpret_cast<Bytef *>(m_input.data());
+      m_stream->avail_in = n;
+    }
+    int ret = inflate(m_stream, Z_NO_FLUSH);
+    if (ret == Z_STREAM_END)
+      m_stream_end = true;
+    else if (ret != Z_OK && ret != Z_BUF_ERROR)
+      return -1;
+  }
+  return length - m_stream->avail_out;
+}
+
+void Dump_reader::close() {
+  if (m_stream != nullptr) {
+    inflateEnd(m_stream);
+    delete m_stream;
+    m_stream = nullptr;
+  }
+  if (m_fd >= 0) ::close(m_fd);
+  m_fd = -1;
+}
+
+Plain_dump_file::~Plain_dump_file() {
+  if (m_temporary) unlink(m_path.c_str());
+}
+
+bool Plain_dump_file::open(const std::string& path) {
+  if (!find_dump_file(path, &m_location)) return false;
+  std::string found = m_location.path();
+  if (m_location.in_memory()) {
+    m_path = found;
+    return true;
+  }
+  if (strip_compression_suffix(found) == found) {
+    // The tool opens it later, the background compression could remove it
+    // before: it reads our descriptor
+    if (m_location.pin()) {
+      m_path = m_location.path();
+      return true;
+    }
+    if (errno != ENOENT || !find_dump_file(path, &m_location)) return false;
+    found = m_location.path();
+    if (strip_compression_suffix(found) == found) {
+      if (!m_location.pin()) return false;
+      m_path = m_location.path();
+      return true;
+    }
+  }
+
+  Dump_reader reader;
+  if (!reader.open(found)) return false;
+  std::string tmp = strip_compression_suffix(found) + ".XXXXXX";
+  int fd = mkstemp(&tmp[0]);
+  if (fd < 0) return false;
+  m_path = tmp;
+  m_temporary = true;
+
+  std::vector<char> buffer(DUMP_IO_CHUNK);
+  ssize_t n;
+  while ((n = reader.read(buffer.data(), buffer.size())) > 0) {
+    if (!write_all(fd, buffer.data(), n)) {
+      n = -1;
+      break;
+    }
+  }
+  ::close(fd);
+  return n == 0;
+}
+
+Mapped_dump_file::~Mapped_dump_file() {
+  if (m_map != nullptr) munmap(m_map, m_map_length);
+}
+
+bool Mapped_dump_file::open(const std::string& path) {
+  Dump_location location;
+  if (!find_dump_file(path, &location)) return false;
+  std::string found = location.path();
+  if (!location.in_memory() && strip_compression_suffix(found) != found) {
+    if (!read_dump_file(found, &m_inflated)) return false;
+    m_data = m_inflated.data();
+    m_size = m_inflated.size();
+    return true;
+  }
+
+  int fd = ::open(found.c_str(), O_RDONLY | O_CLOEXEC);
+  // Compressed between the lookup and the open
+  if (fd < 0 && errno == ENOENT && !location.in_memory()) {
+    Dump_location compressed;
+    if (find_dump_file(path, &compressed) &&
+        strip_compression_suffix(compressed.path()) != compressed.path()) {
+      if (!read_dump_file(compressed.path(), &m_inflated)) return false;
+      m_data = m_inflated.data();
+      m_size = m_inflated.size();
+      return true;
+    }
+  }
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    ::close(fd);
+    return false;
+  }
+  m_size = st.st_size;
+  if (m_size == 0) {
+    ::close(fd);
+    m_data = "";
+    return true;
+  }
+  void *map = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) return false;
+  m_map = map;
+  m_map_length = m_size;
+  m_data = static_cast<const char *>(map);
+  return true;
+}
+
+bool read_dump_file(const std::string& path, std::string *data) {
+  Dump_reader reader;
+  if (!reader.open(path)) return false;
+  data->clear();
+  std::vector<char> buffer(DUMP_IO_CHUNK);
+  ssize_t n;
+  while ((n = reader.read(buffer.data(), buffer.size())) > 0)
+    data->append(buffer.data(), n);
+  return n == 0;
+}
+
+bool write_file(const std::string& location, const char *data, size_t length) {
+  std::ofstream f(location, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!f.is_open()) return false;
+  f.write(data, length);
+  return f.good();
+}
+
+bool write_dump_file(const std::string& path, const std::string& data) {
+  Dump_location location;
+  dump_write_location(path, &location);
+  return write_file(location.path(), data.data(), data.size());
+}
+
+bool compress_buffer(const char *data, size_t length, int compression,
+                     std::string *output) {
+  if (compression == DUMP_COMPRESSION_NONE) return false;
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  // 15 + 16: maximum window size with a gzip header and trailer
+  int window_bits = compression == DUMP_COMPRESSION_GZIP ? 15 + 16 : 15;
+  if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, window_bits, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK)
+    return false;
+
+  output->resize(deflateBound(&stream, length));
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+  stream.avail_in = length;
+  stream.next_out = reinterpret_cast<Bytef *>(&(*output)[0]);
+  stream.avail_out = output->size();
+
+  int ret = deflate(&stream, Z_FINISH);
+  deflateEnd(&stream);
+  if (ret != Z_STREAM_END) return false;
+  output->resize(stream.total_out);
+  return true;
+}
+
+bool gzip_buffer(const std::string& input, std::string *output) {
+  return compress_buffer(input.data(), input.size(), DUMP_COMPRESSION_GZIP,
+                         output);
+}
+
+bool compress_dump_file(const std::string& path, int compression,
+                        std::string *compressed_path, uint64_t *original_size,
+                        uint64_t *compressed_size) {
+  if (compression == DUMP_COMPRESSION_NONE) return false;
+  int in = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (in < 0) return false;
+
+  *compressed_path = path + dump_compression_suffix(compression);
+  std::string tmp = *compressed_path + ".tmp";
+  int out = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0640);
+  if (out < 0) {
+    ::close(in);
+    return false;
+  }
+
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  // gzip adds a header and a trailer to the deflate stream, zlib is smaller
+  int window_bits = compression == DUMP_COMPRESSION_GZIP ? 15 + 16 : 15;
+  bool ok = deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                         window_bits, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+
+  std::vector<char> input(DUMP_IO_CHUNK);
+  std::vector<char> output(DUMP_IO_CHUNK);
+  *original_size = 0;
+  int flush = Z_NO_FLUSH;
+  while (ok && flush != Z_FINISH) {
+    ssize_t n = ::read(in, input.data(), input.size());
+    if (n < 0) {
+      ok = false;
+      break;
+    }
+    *original_size += n;
+    flush = n == 0 ? Z_FINISH : Z_NO_FLUSH;
+    stream.next_in = reinterpret_cast<Bytef *>(input.data());
+    stream.avail_in = n;
+    do {
+      stream.next_out = reinterpret_cast<Bytef *>(output.data());
+      stream.avail_out = output.size();
+      deflate(&stream, flush);
+      ok = write_all(out, output.data(), output.size() - stream.avail_out);
+    } while (ok && stream.avail_out == 0);
+  }
+  *compressed_size = stream.total_out;
+  deflateEnd(&stream);
+
+  // Keep the time of the dump, the series are ordered by it
+  struct stat st;
+  if (ok && fstat(in, &st) == 0) {
+    struct timespec times[2] = {st.st_atim, st.st_mtim};
+    futimens(out, times);
+  }
+  ::close(in);
+
+  ok = ok && fsync(out) == 0;
+  ::close(out);
+  if (!ok || rename(tmp.c_str(), compressed_path->c_str()) != 0) {
+    unlink(tmp.c_str());
+    return false;
+  }
+  unlink(path.c_str());
+  return true;
+}
@@ -0,0 +1,181 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#ifndef PROFILER_DUMP_IO_H
+#define PROFILER_DUMP_IO_H
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct z_stream_s;
+
+// Values of profiler.dump_compression
+enum Dump_compression {
+  DUMP_COMPRESSION_NONE = 0,
+  DUMP_COMPRESSION_GZIP,
+  DUMP_COMPRESSION_ZLIB
+};
+
+// The dumps can be kept in memory by the profiler component
+// (profiler.dump_store), each component installs the functions opening the
+// in-memory file of a dump. They return a new descriptor owned by the caller,
+// -1 when the dump isn't in memory.
+typedef int (*Dump_locator)(const std::string& path);
+extern void set_dump_store_locators(Dump_locator find, Dump_locator create);
+
+// A dump on disk or in the in-memory store. An in-memory dump is held by a
+// descriptor of its own: the store can evict or replace it, the path stays
+// valid until the object is reset or destroyed.
+class Dump_location {
+ public:
+  Dump_location() = default;
+  Dump_location(const Dump_location&) = delete;
+  Dump_location& operator=(const Dump_location&) = delete;
+  ~Dump_location() { reset(); }
+  void reset();
+  void set_file(const std::string& path);
+  // Takes ownership of the descriptor
+  void set_memory(int fd);
+  // Open a dump on disk and use the /proc/<pid>/fd/<n> entry of the
+  // descriptor as path: the file stays readable if it's removed meanwhile.
+  // Fails with errno set.
+  bool pin();
+  bool empty() const { return m_path.empty(); }
+  bool in_memory() const { return m_in_memory; }
+  // Name to open the dump with, also by the external tools: the
+  // /proc/<pid>/fd/<n> entry of our descriptor for an in-memory dump
+  const std::string& path() const { return m_path; }
+  bool stat(struct stat* st) const;
+
+ private:
+  int m_fd = -1;
+  bool m_in_memory = false;
+  std::string m_path;
+};
+
+// Where a new dump has to be written: its in-memory file or the path itself
+extern void dump_write_location(const std::string& path,
+                                Dump_location* location);
+
+// Returns -1 if the name is not a valid compression
+extern int parse_dump_compression(const char* name);
+// Suffix added to the name of the compressed files (".gz" or ".zz")
+extern const char* dump_compression_suffix(int compression);
+// Name of the dump without the compression suffix
+extern std::string strip_compression_suffix(const std::string& path);
+// Locate a dump that may have been compressed since it was written: its
+// in-memory file, the path itself or its compressed version. Returns false if
+// none exists.
+extern bool find_dump_file(const std::string& path, Dump_location* location);
+extern bool dump_file_exists(const std::string& path);
+// stat() of the dump wherever it is
+extern bool stat_dump_file(const std::string& path, struct stat* st);
+// Files on disk whose name starts with the prefix (profiler.dump_path),
+// including the ones written before the component was loaded. Returns false
+// if the directory can't be read.
+extern bool list_files_with_prefix(const std::string& prefix,
+                                   std::vector<std::string>* paths);
+// Name of a finished dump of the prefix, compressed or not:
+// <prefix>[.<label>].[m]NNNN.heap or <prefix>[.<label>...].prof. The temporary
+// files, the exports and the dumps of jemalloc not imported yet don't match.
+extern bool is_dump_file_name(const std::string& prefix,
+                              const std::string& path);
+
+// Streaming reader that decompresses gzip and zlib dumps transparently
+class Dump_reader {
+ public:
+  ~Dump_reader() { close(); }
+  bool open(const std::string& path);
+  // Returns the number of bytes read, 0 at the end of the dump, -1 on error
+  ssize_t read(char* buffer, size_t length);
+  void close();
+  const std::string& path() const { return m_path; }
+
+ private:
+  int m_fd = -1;
+  struct z_stream_s* m_stream = nullptr;
+  bool m_stream_end = false;
+  std::vector<char> m_input;
+  std::string m_path;
+};
+
+// Uncompressed version of a dump for the external tools (pprof, jeprof). If
+// the dump is compressed it's inflated in a temporary file next to it, that
+// file is removed with the object.
+class Plain_dump_file {
+ public:
+  Plain_dump_file() = default;
+  Plain_dump_file(const Plain_dump_file&) = delete;
+  Plain_dump_file& operator=(const Plain_dump_file&) = delete;
+  ~Plain_dump_file();
+  bool open(const std::string& path);
+  const std::string& path() const { return m_path; }
+
+ private:
+  Dump_location m_location;
+  std::string m_path;
+  bool m_temporary = false;
+};
+
+// Read-only view of a whole dump: uncompressed dumps, on disk or in memory,
+// are mapped without copy
+class Mapped_dump_file {
+ public:
+  Mapped_dump_file() = default;
+  Mapped_dump_file(const Mapped_dump_file&) = delete;
+  Mapped_dump_file& operator=(const Mapped_dump_file&) = delete;
+  ~Mapped_dump_file();
+  bool open(const std::string& path);
+  const char* data() const { return m_data; }
+  size_t size() const { return m_size; }
+
+ private:
+  void* m_map = nullptr;
+  size_t m_map_length = 0;
+  const char* m_data = nullptr;
+  size_t m_size = 0;
+  std::string m_inflated;
+};
+
+// Read a whole dump file in memory, compressed or not
+extern bool read_dump_file(const std::string& path, std::string* data);
+// Write a buffer to a file, replacing it if it already exists
+extern bool write_file(const std::string& location, const char* data,
+                       size_t length);
+// Same for a new dump, it may go to the in-memory store
+extern bool write_dump_file(const std::string& path, const std::string& data);
+// Compress a buffer in gzip or zlib format using the bundled zlib
+extern bool compress_buffer(const char* data, size_t length, int compression,
+                            std::string* output);
+extern bool gzip_buffer(const std::string& input, std::string* output);
+// Compress a closed dump file and remove the original once the compressed
+// version is safely on disk
+extern bool compress_dump_file(const std::string& path, int compression,
+                               std::string* compressed_path,
+                               uint64_t* original_size,
+                               uint64_t* compressed_size);
+
+#endif /* PROFILER_DUMP_IO_H */
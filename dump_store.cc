@@ -0,0 +1,242 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#define LOG_COMPONENT_TAG "profiler"
+
+#include "profiler.h"
+#include "profiler_pfs.h"
+#include "dump_store.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <map>
+#include <mutex>
+
+std::atomic<bool> dump_store_in_memory{false};
+unsigned long long dump_store_max_bytes = 0;
+
+namespace {
+
+struct Memory_dump {
+  int fd;
+  std::string type;
+  std::string allocator;
+  // Still written by a profiler, it can't be evicted
+  bool complete;
+  time_t created;
+  time_t last_access;
+};
+
+std::mutex dump_store_mutex;
+std::map<std::string, Memory_dump> memory_dumps;
+
+uint64_t memory_dump_size(const Memory_dump& dump) {
+  struct stat st;
+  return fstat(dump.fd, &st) == 0 ? st.st_size : 0;
+}
+
+// Least recently used dumps are released first, called with the mutex held
+void enforce_budget(std::vector<Stored_dump> *evicted) {
+  uint64_t total = 0;
+  for (const auto& entry : memory_dumps) total += memory_dump_size(entry.second);
+
+  while (total > dump_store_max_bytes) {
+    auto victim = memory_dumps.end();
+    for (auto it = memory_dumps.begin(); it != memory_dumps.end(); ++it) {
+      if (!it->second.complete) continue;
+      if (victim == memory_dumps.end() ||
+          it->second.last_access < victim->second.last_access)
+        victim = it;
+    }
+    if (victim == memory_dumps.end()) break;
+
+    Stored_dump info;
+    info.path = victim->first;
+    info.type = victim->second.type;
+    info.allocator = victim->second.allocator;
+    info.size = memory_dump_size(victim->second);
+    evicted->push_back(info);
+
+    total -= std::min(total, info.size);
+    close(victim->second.fd);
+    memory_dumps.erase(victim);
+  }
+}
+
+void log_evicted(const std::vector<Stored_dump>& evicted) {
+  for (const Stored_dump& dump : evicted) {
+    char extra[100];
+    snprintf(extra, sizeof(extra), "memory: %llu bytes released",
+             (unsigned long long)dump.size);
+    addProfiler_element(time(nullptr), dump.path, dump.type, dump.allocator,
+                        "evicted", extra);
+  }
+}
+
+}  // namespace
+
+int dump_store_create(const std::string& path) {
+  if (!dump_store_in_memory.load()) return -1;
+
+  std::string name = path.substr(path.find_last_of('/') + 1);
+  int fd = memfd_create(name.c_str(), MFD_CLOEXEC);
+  if (fd < 0) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    ("could not create the in-memory file for " + path +
+                     ", the dump is written on disk").c_str());
+    return -1;
+  }
+  int writer = dup(fd);
+  if (writer < 0) {
+    close(fd);
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    ("could not create the in-memory file for " + path +
+                     ", the dump is written on disk").c_str());
+    return -1;
+  }
+
+  Memory_dump dump;
+  dump.fd = fd;
+  dump.complete = false;
+  dump.created = dump.last_access = time(nullptr);
+
+  std::vector<Stored_dump> evicted;
+  {
+    std::lock_guard<std::mutex> guard(dump_store_mutex);
+    auto it = memory_dumps.find(path);
+    if (it != memory_dumps.end()) {
+      close(it->second.fd);
+      memory_dumps.erase(it);
+    }
+    memory_dumps[path] = dump;
+    enforce_budget(&evicted);
+  }
+  log_evicted(evicted);
+  return writer;
+}
+
+int dump_store_open(const std::string& path) {
+  std::lock_guard<std::mutex> guard(dump_store_mutex);
+  auto it = memory_dumps.find(path);
+  if (it == memory_dumps.end()) return -1;
+  it->second.last_access = time(nullptr);
+  return dup(it->second.fd);
+}
+
+bool dump_store_contains(const std::string& path) {
+  std::lock_guard<std::mutex> guard(dump_store_mutex);
+  return memory_dumps.count(path) > 0;
+}
+
+void dump_store_complete(const std::string& path, const std::string& type,
+                         const std::string& allocator) {
+  std::vector<Stored_dump> evicted;
+  {
+    std::lock_guard<std::mutex> guard(dump_store_mutex);
+    auto it = memory_dumps.find(path);
+    if (it == memory_dumps.end()) return;
+    it->second.complete = true;
+    if (it->second.type.empty()) {
+      it->second.type = type;
+      it->second.allocator = allocator;
+    }
+    enforce_budget(&evicted);
+  }
+  log_evicted(evicted);
+}
+
+bool dump_store_persist(const std::string& path, const std::string& destination,
+                        uint64_t *size) {
+  int in;
+  {
+    std::lock_guard<std::mutex> guard(dump_store_mutex);
+    auto it = memory_dumps.find(path);
+    if (it == memory_dumps.end()) return false;
+    it->second.last_access = time(nullptr);
+    // Our own descriptor, an eviction during the copy can't close it
+    in = dup(it->second.fd);
+  }
+  if (in < 0) return false;
+
+  int out = open(destination.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                 0640);
+  if (out < 0) {
+    close(in);
+    return false;
+  }
+
+  struct stat st;
+  bool ok = fstat(in, &st) == 0;
+  off_t offset = 0;
+  while (ok && offset < st.st_size) {
+    ssize_t n = sendfile(out, in, &offset, st.st_size - offset);
+    if (n < 0 && errno == EINTR) continue;
+    ok = n > 0;
+  }
+  ok = ok && fsync(out) == 0;
+  ok = close(out) == 0 && ok;
+  close(in);
+  if (!ok) {
+    unlink(destination.c_str());
+    return false;
+  }
+  *size = offset;
+  return true;
+}
+
+void dump_store_remove_prefix(const std::string& prefix) {
+  std::lock_guard<std::mutex> guard(dump_store_mutex);
+  for (auto it = memory_dumps.begin(); it != memory_dumps.end();) {
+    if (it->first.compare(0, prefix.size(), prefix) == 0) {
+      close(it->second.fd);
+      it = memory_dumps.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void dump_store_list(std::vector<Stored_dump> *dumps) {
+  std::lock_guard<std::mutex> guard(dump_store_mutex);
+  for (const auto& entry : memory_dumps) {
+    Stored_dump info;
+    info.path = entry.first;
+    info.type = entry.second.type;
+    info.allocator = entry.second.allocator;
+    info.size = memory_dump_size(entry.second);
+    info.created = entry.second.created;
+    info.last_access = entry.second.last_access;
+    dumps->push_back(info);
+  }
+}
+
+void dump_store_clear() {
+  std::lock_guard<std::mutex> guard(dump_store_mutex);
+  for (auto& entry : memory_dumps) close(entry.second.fd);
+  memory_dumps.clear();
+}
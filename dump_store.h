@@ -0,0 +1,72 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#ifndef PROFILER_DUMP_STORE_H
+#define PROFILER_DUMP_STORE_H
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+// Values of profiler.dump_store
+#define DUMP_STORE_DISK "DISK"
+#define DUMP_STORE_MEMORY "MEMORY"
+
+// profiler.dump_store is MEMORY
+extern std::atomic<bool> dump_store_in_memory;
+// Value of profiler.dump_store_max_bytes
+extern unsigned long long dump_store_max_bytes;
+
+struct Stored_dump {
+  std::string path;
+  std::string type;
+  std::string allocator;
+  uint64_t size;
+  time_t created;
+  time_t last_access;
+};
+
+// The dumps are kept in memfd files. The store never hands out its own
+// descriptors: the callers get a dup() they close once done, an eviction or a
+// replacement can't make them read or write another file.
+
+// New descriptor on the in-memory file where a new dump has to be written,
+// -1 when they go to disk
+extern int dump_store_create(const std::string& path);
+// New descriptor on a dump kept in memory, -1 if it's not
+extern int dump_store_open(const std::string& path);
+extern bool dump_store_contains(const std::string& path);
+// The dump is fully written and can be evicted to respect the byte budget
+extern void dump_store_complete(const std::string& path,
+                                const std::string& type,
+                                const std::string& allocator);
+// Copy a dump kept in memory to a file on disk
+extern bool dump_store_persist(const std::string& path,
+                               const std::string& destination,
+                               uint64_t* size);
+extern void dump_store_remove_prefix(const std::string& prefix);
+extern void dump_store_list(std::vector<Stored_dump>* dumps);
+extern void dump_store_clear();
+
+#endif /* PROFILER_DUMP_STORE_H */
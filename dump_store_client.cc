@@ -0,0 +1,47 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#include "dump_store_client.h"
+#include "dump_io.h"
+
+static int locate_dump(bool create, const std::string& path) {
+  int fd = -1;
+  bool failed =
+      create ? mysql_service_profiler_dump_store->create_dump(path.c_str(), &fd)
+             : mysql_service_profiler_dump_store->find_dump(path.c_str(), &fd);
+  if (failed) return -1;
+  return fd;
+}
+
+static int find_in_dump_store(const std::string& path) {
+  return locate_dump(false, path);
+}
+
+static int create_in_dump_store(const std::string& path) {
+  return locate_dump(true, path);
+}
+
+void init_dump_store_client() {
+  set_dump_store_locators(find_in_dump_store, create_in_dump_store);
+}
+
+void deinit_dump_store_client() { set_dump_store_locators(nullptr, nullptr); }
@@ -0,0 +1,36 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#ifndef PROFILER_DUMP_STORE_CLIENT_H
+#define PROFILER_DUMP_STORE_CLIENT_H
+
+#include <mysql/components/service.h>
+#include "profiler_service.h"
+
+extern REQUIRES_SERVICE_PLACEHOLDER(profiler_dump_store);
+
+// Let dump_io find and create the dumps kept in memory by the profiler
+// component (profiler.dump_store)
+extern void init_dump_store_client();
+extern void deinit_dump_store_client();
+
+#endif /* PROFILER_DUMP_STORE_CLIENT_H */
@@ -0,0 +1,208 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#include "memory.h"
+#include "heap_dump_writer.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+// Every waiting dump holds a complete profile in memory
+static const size_t HEAP_DUMP_QUEUE_MAX = 8;
+// Size of the write() calls
+static const size_t HEAP_DUMP_WRITE_CHUNK = 4 * 1024 * 1024;
+
+struct Heap_dump {
+  std::string path;
+  char *profile;
+  std::string reason;
+  int compression;
+  std::chrono::steady_clock::time_point requested;
+};
+
+// Dump written but not yet synced nor renamed
+struct Heap_dump_file {
+  std::string path;
+  std::string tmp_path;
+  std::string reason;
+  std::chrono::steady_clock::time_point requested;
+  int fd;
+  uint64_t size;
+};
+
+static std::mutex heap_dump_mutex;
+static std::condition_variable heap_dump_cond;
+static std::deque<Heap_dump> heap_dumps;
+static bool heap_dump_stopping = false;
+static std::thread heap_dump_writer;
+
+static bool write_all(int fd, const char *data, size_t length) {
+  while (length > 0) {
+    ssize_t written = ::write(fd, data, std::min(length, HEAP_DUMP_WRITE_CHUNK));
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    data += written;
+    length -= written;
+  }
+  return true;
+}
+
+static bool write_heap_dump(Heap_dump& dump, Heap_dump_file *file) {
+  const char *data = dump.profile;
+  size_t length = strlen(dump.profile);
+  std::string compressed;
+  file->path = dump.path;
+  if (dump.compression != DUMP_COMPRESSION_NONE) {
+    if (compress_buffer(data, length, dump.compression, &compressed)) {
+      data = compressed.data();
+      length = compressed.size();
+      file->path += dump_compression_suffix(dump.compression);
+    } else {
+      LogComponentErr(WARNING_LEVEL, ER_LOG_PRINTF_MSG,
+                      ("could not compress " + dump.path + ", written as is").c_str());
+    }
+  }
+  file->tmp_path = file->path + ".tmp";
+  file->reason = dump.reason;
+  file->requested = dump.requested;
+  file->size = length;
+
+  file->fd = ::open(file->tmp_path.c_str(),
+                    O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0640);
+  bool ok = file->fd >= 0 && write_all(file->fd, data, length);
+
+  free(dump.profile);
+  dump.profile = nullptr;
+
+  if (!ok) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    ("could not write the heap dump " + file->path).c_str());
+    if (file->fd >= 0) ::close(file->fd);
+    unlink(file->tmp_path.c_str());
+  }
+  return ok;
+}
+
+// All the dumps waiting are written first and synced together, a burst of
+// dumps costs one sync of the directory
+static void write_heap_dumps(std::deque<Heap_dump>& batch) {
+  std::vector<Heap_dump_file> files;
+  for (Heap_dump& dump : batch) {
+    Heap_dump_file file;
+    if (write_heap_dump(dump, &file)) files.push_back(file);
+  }
+
+  std::set<std::string> directories;
+  for (Heap_dump_file& file : files) {
+    bool ok = fsync(file.fd) == 0;
+    ok = ::close(file.fd) == 0 && ok;
+    file.fd = -1;
+    if (!ok || rename(file.tmp_path.c_str(), file.path.c_str()) != 0) {
+      LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                      ("could not write the heap dump " + file.path).c_str());
+      unlink(file.tmp_path.c_str());
+      file.path.clear();
+      continue;
+    }
+    directories.insert(std::filesystem::path(file.path).parent_path().string());
+  }
+  // Make the renames durable
+  for (const std::string& directory : directories) {
+    int fd = ::open(directory.empty() ? "." : directory.c_str(),
+                    O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) continue;
+    fsync(fd);
+    ::close(fd);
+  }
+
+  for (const Heap_dump_file& file : files) {
+    if (file.path.empty()) continue;
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - file.requested);
+    char extra[100];
+    snprintf(extra, sizeof(extra), "%.50s (%llu bytes, %lld ms)",
+             file.reason.c_str(), (unsigned long long)file.size,
+             (long long)elapsed.count());
+    mysql_service_profiler_pfs->add("memory", "tcmalloc", "dumped",
+                                    file.path.c_str(), extra);
+  }
+}
+
+static void heap_dump_writer_run() {
+  std::unique_lock<std::mutex> lock(heap_dump_mutex);
+  while (true) {
+    heap_dump_cond.wait(
+        lock, [] { return heap_dump_stopping || !heap_dumps.empty(); });
+    // The dumps already collected are always written, even when stopping
+    if (heap_dumps.empty()) break;
+    std::deque<Heap_dump> batch;
+    batch.swap(heap_dumps);
+    lock.unlock();
+    write_heap_dumps(batch);
+    lock.lock();
+  }
+}
+
+void init_heap_dump_writer() {
+  std::lock_guard<std::mutex> guard(heap_dump_mutex);
+  heap_dump_stopping = false;
+  heap_dump_writer = std::thread(heap_dump_writer_run);
+}
+
+void deinit_heap_dump_writer() {
+  {
+    std::lock_guard<std::mutex> guard(heap_dump_mutex);
+    heap_dump_stopping = true;
+  }
+  heap_dump_cond.notify_all();
+  if (heap_dump_writer.joinable()) heap_dump_writer.join();
+}
+
+bool queue_heap_dump(const std::string& path, char *profile,
+                     const std::string& reason, int compression) {
+  {
+    std::lock_guard<std::mutex> guard(heap_dump_mutex);
+    if (heap_dump_stopping || heap_dumps.size() >= HEAP_DUMP_QUEUE_MAX) {
+      free(profile);
+      return false;
+    }
+    heap_dumps.push_back({path, profile, reason, compression,
+                          std::chrono::steady_clock::now()});
+  }
+  heap_dump_cond.notify_one();
+  return true;
+}
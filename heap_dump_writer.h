@@ -0,0 +1,45 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#ifndef PROFILER_HEAP_DUMP_WRITER_H
+#define PROFILER_HEAP_DUMP_WRITER_H
+
+#include <string>
+
+// Values of profiler.tcmalloc_dump_mode
+#define HEAP_DUMP_MODE_SYNC "SYNC"
+#define HEAP_DUMP_MODE_ASYNC "ASYNC"
+
+// Thread of the memory component writing the heap profiles collected with
+// GetHeapProfile(), the sessions don't wait for the disk
+extern void init_heap_dump_writer();
+// Pending dumps are written before returning
+extern void deinit_heap_dump_writer();
+
+// Hand a profile returned by GetHeapProfile() to the writer, it takes the
+// ownership of the buffer. The file is logged in profiler_actions once it's
+// on disk. Returns false if too many dumps are already waiting, the profile
+// is then released.
+extern bool queue_heap_dump(const std::string& path, char* profile,
+                            const std::string& reason, int compression);
+
+#endif /* PROFILER_HEAP_DUMP_WRITER_H */
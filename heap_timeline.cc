@@ -0,0 +1,171 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#include "heap_timeline.h"
+#include "dump_catalog.h"
+#include "dump_io.h"
+#include "dump_store.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+namespace {
+
+const char *SIDECAR_SUFFIX = ".sites";
+const char *SIDECAR_HEADER = "heap_timeline 1";
+// Summaries kept in memory, the ones of the dumps on disk are read back from
+// their .sites file past that
+const size_t MAX_CACHED_SUMMARIES = 256;
+
+// What the timeline keeps of a dump, the (other) row is the last one when
+// some sites were left out
+struct Dump_summary {
+  unsigned long long time = 0;  // microseconds
+  bool on_disk = false;
+  std::vector<Heap_site> sites;
+};
+
+std::mutex timeline_mutex;
+std::map<std::string, Dump_summary> timeline_cache;
+
+std::string sidecar_path(const std::string& path) {
+  return strip_compression_suffix(path) + SIDECAR_SUFFIX;
+}
+
+std::string serialize(const Dump_summary& summary) {
+  std::string data = std::string(SIDECAR_HEADER) + " " +
+                     std::to_string(summary.time) + "\n";
+  for (const Heap_site& usage : summary.sites)
+    data += std::to_string(usage.bytes) + " " +
+            std::to_string(usage.objects) + " " + usage.site + "\n";
+  return data;
+}
+
+bool load_sidecar(const std::string& path, Dump_summary *summary) {
+  std::ifstream f(sidecar_path(path));
+  std::string line;
+  if (!std::getline(f, line) ||
+      line.compare(0, strlen(SIDECAR_HEADER), SIDECAR_HEADER) != 0)
+    return false;
+  summary->time = strtoull(line.c_str() + strlen(SIDECAR_HEADER), nullptr, 10);
+  while (std::getline(f, line)) {
+    long long bytes, objects;
+    int site_pos = 0;
+    if (sscanf(line.c_str(), "%lld %lld %n", &bytes, &objects, &site_pos) < 2 ||
+        site_pos == 0)
+      continue;
+    summary->sites.push_back({line.substr(site_pos), bytes, objects});
+  }
+  return true;
+}
+
+void fill_heap_timeline(std::vector<Snapshot_row> *rows) {
+  std::vector<Dump_entry> entries;
+  dump_catalog_list(&entries);
+
+  std::lock_guard<std::mutex> guard(timeline_mutex);
+  for (const Dump_entry& entry : entries) {
+    if (entry.type != "memory" || entry.ended == 0) continue;
+    Dump_summary loaded;
+    auto it = timeline_cache.find(entry.path);
+    if (it == timeline_cache.end() &&
+        (entry.in_memory || !load_sidecar(entry.path, &loaded)))
+      continue;
+    const Dump_summary& summary =
+        it == timeline_cache.end() ? loaded : it->second;
+    unsigned long long rank = 0;
+    for (const Heap_site& usage : summary.sites) {
+      Snapshot_row row;
+      row.push_back(Snapshot_value::timestamp(summary.time));
+      row.push_back(Snapshot_value::string(entry.path));
+      row.push_back(Snapshot_value::string(entry.allocator));
+      row.push_back(usage.site == "(other)"
+                        ? Snapshot_value::null()
+                        : Snapshot_value::unsigned_number(++rank));
+      row.push_back(Snapshot_value::string(usage.site));
+      row.push_back(Snapshot_value::number(usage.bytes));
+      row.push_back(Snapshot_value::number(usage.objects));
+      rows->push_back(std::move(row));
+    }
+  }
+}
+
+}  // namespace
+
+Snapshot_table heap_timeline_table = {
+    "profiler_heap_timeline",
+    "`DUMP_TIME` timestamp(6), `FILENAME` VARCHAR(255), "
+    "`ALLOCATOR` VARCHAR(10), `SITE_RANK` INTEGER unsigned, "
+    "`SITE` VARCHAR(255), `INUSE_BYTES` BIGINT, `INUSE_OBJECTS` BIGINT",
+    fill_heap_timeline,
+    1000,
+    {}};
+
+void index_heap_dump(const std::string& path, const Profile_data& profile) {
+  Dump_summary summary;
+  struct stat st;
+  if (stat_dump_file(path, &st))
+    summary.time = st.st_mtim.tv_sec * 1000000ULL + st.st_mtim.tv_nsec / 1000;
+  else
+    summary.time = time(nullptr) * 1000000ULL;
+
+  summarize_heap_sites(profile, HEAP_TIMELINE_SITES, &summary.sites);
+
+  // The dumps kept in memory are gone with the component, so is their
+  // summary
+  if (!dump_store_contains(path)) {
+    std::string data = serialize(summary);
+    summary.on_disk = write_file(sidecar_path(path), data.data(), data.size());
+  }
+
+  std::lock_guard<std::mutex> guard(timeline_mutex);
+  timeline_cache[path] = std::move(summary);
+  for (auto it = timeline_cache.begin();
+       it != timeline_cache.end() &&
+       timeline_cache.size() > MAX_CACHED_SUMMARIES;) {
+    if (it->second.on_disk && it->first != path)
+      it = timeline_cache.erase(it);
+    else
+      ++it;
+  }
+}
+
+void remove_heap_timeline(const std::string& path) {
+  {
+    std::lock_guard<std::mutex> guard(timeline_mutex);
+    timeline_cache.erase(path);
+  }
+  unlink(sidecar_path(path).c_str());
+}
+
+void clear_heap_timeline() {
+  std::lock_guard<std::mutex> guard(timeline_mutex);
+  timeline_cache.clear();
+}
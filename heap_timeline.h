@@ -0,0 +1,46 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#ifndef PROFILER_HEAP_TIMELINE_H
+#define PROFILER_HEAP_TIMELINE_H
+
+#include "pprof_proto.h"
+#include "snapshot_table.h"
+
+#include <string>
+
+// Number of allocation sites kept for each dump, the others are summed in a
+// single "(other)" row
+#define HEAP_TIMELINE_SITES 20
+
+// Summarize a finished heap dump by allocation site. The summary is cached
+// and, for the dumps on disk, saved next to the dump in <dump>.sites so the
+// timeline never has to read the dumps again.
+extern void index_heap_dump(const std::string& path,
+                            const Profile_data& profile);
+// Forget the summary of a dump that has been removed, with its .sites file
+extern void remove_heap_timeline(const std::string& path);
+extern void clear_heap_timeline();
+
+extern Snapshot_table heap_timeline_table;
+
+#endif /* PROFILER_HEAP_TIMELINE_H */
@@ -0,0 +1,167 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#include "jemalloc_autodump.h"
+#include "jemalloc_stats.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+unsigned long long jemalloc_dump_interval_bytes = 0;
+
+namespace {
+
+const std::chrono::seconds autodump_interval(1);
+
+std::mutex autodump_mutex;
+std::condition_variable autodump_cond;
+std::thread autodump_thread;
+bool autodump_stopping = false;
+bool autodump_active = false;
+std::string autodump_prefix;
+Auto_dump_writer autodump_writer = nullptr;
+Auto_dump_importer autodump_importer = nullptr;
+// Bytes allocated since the start of mysqld at the last dump
+uint64_t interval_base = 0;
+
+// jemalloc names its dumps <prefix>.<pid>.<seq>.<type><seq>.heap, the type
+// is 'u' for gdump and 'i' for lg_prof_interval. Returns the reason of
+// the dump or nullptr if the file is not one of them.
+const char *jemalloc_dump_reason(const std::string& filename,
+                                 const std::string& start) {
+  if (filename.compare(0, start.size(), start) != 0 ||
+      filename.size() < start.size() + 5 ||
+      filename.compare(filename.size() - 5, 5, ".heap") != 0)
+    return nullptr;
+  size_t dot = filename.find('.', start.size());
+  if (dot == std::string::npos || dot + 1 >= filename.size()) return nullptr;
+  switch (filename[dot + 1]) {
+    case 'u':
+      return "gdump";
+    case 'i':
+      return "lg_prof_interval";
+    default:
+      return nullptr;
+  }
+}
+
+// Import the dumps of jemalloc found next to the prefix, oldest first. A
+// dump modified during the last second may still be written unless
+// the profiler is stopped.
+void import_jemalloc_dumps(const std::string& prefix, bool all) {
+  std::filesystem::path path(prefix);
+  std::filesystem::path directory = path.parent_path();
+  if (directory.empty()) directory = ".";
+  std::string start =
+      path.filename().string() + "." + std::to_string(getpid()) + ".";
+
+  std::vector<std::pair<time_t, std::string>> found;
+  std::error_code ec;
+  for (const auto& entry :
+       std::filesystem::directory_iterator(directory, ec)) {
+    std::string filename = entry.path().filename().string();
+    if (jemalloc_dump_reason(filename, start) == nullptr) continue;
+    struct stat st;
+    if (stat(entry.path().c_str(), &st) != 0) continue;
+    if (!all && st.st_mtime >= time(nullptr) - 1) continue;
+    found.emplace_back(st.st_mtime, entry.path().string());
+  }
+  std::sort(found.begin(), found.end());
+  for (const auto& file : found) {
+    std::string filename = std::filesystem::path(file.second).filename();
+    autodump_importer(file.second, jemalloc_dump_reason(filename, start));
+  }
+}
+
+void check_dump_interval() {
+  if (jemalloc_dump_interval_bytes == 0) return;
+  // Like lg_prof_interval, every allocation counts even if the heap doesn't
+  // grow
+  uint64_t allocated = 0;
+  if (!jemalloc_requested_bytes(&allocated)) return;
+  // Lower after an arena was destroyed
+  if (interval_base == 0 || allocated < interval_base) {
+    interval_base = allocated;
+    return;
+  }
+  if (allocated - interval_base < jemalloc_dump_interval_bytes) return;
+  char reason[64];
+  snprintf(reason, sizeof(reason), "interval: %llu bytes",
+           (unsigned long long)(allocated - interval_base));
+  autodump_writer(reason);
+  interval_base = allocated;
+}
+
+void autodump_thread_run() {
+  std::unique_lock<std::mutex> lock(autodump_mutex);
+  while (!autodump_stopping) {
+    autodump_cond.wait_for(lock, autodump_interval,
+                           [] { return autodump_stopping; });
+    if (autodump_stopping || !autodump_active) continue;
+    check_dump_interval();
+    import_jemalloc_dumps(autodump_prefix, false);
+  }
+}
+
+}  // namespace
+
+void init_jemalloc_autodump(Auto_dump_writer writer,
+                            Auto_dump_importer importer) {
+  std::lock_guard<std::mutex> guard(autodump_mutex);
+  autodump_writer = writer;
+  autodump_importer = importer;
+  autodump_stopping = false;
+  autodump_thread = std::thread(autodump_thread_run);
+}
+
+void deinit_jemalloc_autodump() {
+  {
+    std::lock_guard<std::mutex> guard(autodump_mutex);
+    autodump_stopping = true;
+  }
+  autodump_cond.notify_all();
+  if (autodump_thread.joinable()) autodump_thread.join();
+}
+
+void start_jemalloc_autodump(const std::string& prefix) {
+  std::lock_guard<std::mutex> guard(autodump_mutex);
+  autodump_prefix = prefix;
+  autodump_active = true;
+  interval_base = 0;
+}
+
+void stop_jemalloc_autodump() {
+  std::lock_guard<std::mutex> guard(autodump_mutex);
+  if (!autodump_active) return;
+  autodump_active = false;
+  import_jemalloc_dumps(autodump_prefix, true);
+}
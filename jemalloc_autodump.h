@@ -0,0 +1,50 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#ifndef PROFILER_JEMALLOC_AUTODUMP_H
+#define PROFILER_JEMALLOC_AUTODUMP_H
+
+#include <string>
+
+// Write the next heap dump of the series, reason is logged with it
+typedef void (*Auto_dump_writer)(const char *reason);
+// Move a dump written by jemalloc itself into the series
+typedef void (*Auto_dump_importer)(const std::string& file,
+                                   const char *reason);
+
+// Value of profiler.jemalloc_dump_interval_bytes: a heap dump is written
+// each time mysqld allocated this much, freed or not, 0 disables it
+extern unsigned long long jemalloc_dump_interval_bytes;
+
+// Background thread of component_profiler_jemalloc_memory checking the
+// interval and collecting the dumps jemalloc writes by itself (prof.gdump
+// or lg_prof_interval) while the profiler is running
+extern void init_jemalloc_autodump(Auto_dump_writer writer,
+                                   Auto_dump_importer importer);
+extern void deinit_jemalloc_autodump();
+
+// The profiler was started, jemalloc writes its dumps with this prefix
+extern void start_jemalloc_autodump(const std::string& prefix);
+// The profiler was stopped, the last dumps of jemalloc are imported
+extern void stop_jemalloc_autodump();
+
+#endif /* PROFILER_JEMALLOC_AUTODUMP_H */
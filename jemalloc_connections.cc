@@ -0,0 +1,166 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#include "jemalloc_connections.h"
+
+#include <jemalloc/jemalloc.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Thread_connections;
+
+struct Connection_allocs {
+  std::string user;
+  std::string host;
+  // thread.allocatedp and thread.deallocatedp of the connection thread
+  const uint64_t *allocated = nullptr;
+  const uint64_t *deallocated = nullptr;
+  // The counters are cumulated by the thread, which is reused by the
+  // following connections when thread_cache_size allows it
+  uint64_t allocated_start = 0;
+  uint64_t deallocated_start = 0;
+  unsigned long long connected = 0;
+  const Thread_connections *owner = nullptr;
+};
+
+// Only locked when a connection starts or ends and while the table is read,
+// the pointers must not be used once the thread is gone
+std::mutex connections_mutex;
+std::map<unsigned long long, Connection_allocs> connections;
+
+// Connections tracked from the current thread. The thread_local destructors
+// run before the ones of the pthread keys, where jemalloc releases the
+// counters: a thread exiting without DISCONNECT doesn't leave its pointers
+// in the table.
+struct Thread_connections {
+  std::vector<unsigned long long> ids;
+  ~Thread_connections() {
+    std::lock_guard<std::mutex> guard(connections_mutex);
+    for (unsigned long long id : ids) {
+      auto it = connections.find(id);
+      if (it != connections.end() && it->second.owner == this)
+        connections.erase(it);
+    }
+  }
+};
+
+thread_local Thread_connections thread_connections;
+
+unsigned long long now_micros() {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return (unsigned long long)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+// The owner thread updates the counters without synchronization, a relaxed
+// load is enough for statistics
+uint64_t read_counter(const uint64_t *counter) {
+  return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+void fill_connection_allocs(std::vector<Snapshot_row> *rows) {
+  unsigned long long now = now_micros();
+  std::lock_guard<std::mutex> guard(connections_mutex);
+  for (const auto& connection : connections) {
+    const Connection_allocs& c = connection.second;
+    uint64_t allocated = read_counter(c.allocated) - c.allocated_start;
+    uint64_t freed = read_counter(c.deallocated) - c.deallocated_start;
+    unsigned long long elapsed = now > c.connected ? now - c.connected : 0;
+    Snapshot_row row;
+    row.push_back(Snapshot_value::unsigned_number(connection.first));
+    row.push_back(Snapshot_value::string(c.user));
+    row.push_back(Snapshot_value::string(c.host));
+    row.push_back(Snapshot_value::unsigned_number(allocated));
+    row.push_back(Snapshot_value::unsigned_number(freed));
+    // A thread can free memory allocated by others
+    row.push_back(Snapshot_value::number((long long)(allocated - freed)));
+    row.push_back(Snapshot_value::unsigned_number(
+        elapsed > 0 ? (unsigned long long)(allocated * 1000000.0 / elapsed)
+                    : 0));
+    row.push_back(Snapshot_value::timestamp(c.connected));
+    rows->push_back(row);
+  }
+}
+
+}  // namespace
+
+void track_connection(unsigned long long id, const std::string& user,
+                      const std::string& host) {
+  Connection_allocs c;
+  uint64_t *counter = nullptr;
+  size_t size = sizeof(counter);
+  // Fails when jemalloc is built without statistics
+  if (mallctl("thread.allocatedp", &counter, &size, nullptr, 0) != 0) return;
+  c.allocated = counter;
+  size = sizeof(counter);
+  if (mallctl("thread.deallocatedp", &counter, &size, nullptr, 0) != 0) return;
+  c.deallocated = counter;
+  c.allocated_start = read_counter(c.allocated);
+  c.deallocated_start = read_counter(c.deallocated);
+  c.user = user;
+  c.host = host;
+  c.connected = now_micros();
+  c.owner = &thread_connections;
+  if (std::find(thread_connections.ids.begin(), thread_connections.ids.end(),
+                id) == thread_connections.ids.end())
+    thread_connections.ids.push_back(id);
+
+  std::lock_guard<std::mutex> guard(connections_mutex);
+  connections[id] = c;
+}
+
+void rename_connection(unsigned long long id, const std::string& user,
+                       const std::string& host) {
+  std::lock_guard<std::mutex> guard(connections_mutex);
+  auto it = connections.find(id);
+  if (it == connections.end()) return;
+  it->second.user = user;
+  it->second.host = host;
+}
+
+void untrack_connection(unsigned long long id) {
+  std::vector<unsigned long long>& ids = thread_connections.ids;
+  ids.erase(std::remove(ids.begin(), ids.end(), id), ids.end());
+  std::lock_guard<std::mutex> guard(connections_mutex);
+  connections.erase(id);
+}
+
+void clear_connections() {
+  std::lock_guard<std::mutex> guard(connections_mutex);
+  connections.clear();
+}
+
+Snapshot_table connection_allocs_table = {
+    "profiler_connection_allocs",
+    "`PROCESSLIST_ID` BIGINT unsigned, `USER` VARCHAR(97), "
+    "`HOST` VARCHAR(255), `ALLOCATED_BYTES` BIGINT unsigned, "
+    "`FREED_BYTES` BIGINT unsigned, `CURRENT_BYTES` BIGINT, "
+    "`ALLOC_RATE` BIGINT unsigned, `CONNECTED_SINCE` timestamp(6)",
+    fill_connection_allocs, 100, {}};
@@ -0,0 +1,47 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#ifndef PROFILER_JEMALLOC_CONNECTIONS_H
+#define PROFILER_JEMALLOC_CONNECTIONS_H
+
+#include "snapshot_table.h"
+
+#include <string>
+
+// Called from the connection thread (event_tracking_connection): remember
+// where jemalloc keeps the allocation counters of the thread. Nothing is
+// added on the allocation path, the counters are only read by the table.
+// Only the connections opened after the component was installed are known.
+extern void track_connection(unsigned long long id, const std::string& user,
+                             const std::string& host);
+// CHANGE_USER keeps the counters of the connection
+extern void rename_connection(unsigned long long id, const std::string& user,
+                              const std::string& host);
+// The connection is also forgotten when its thread exits, the counters live
+// in its TSD
+extern void untrack_connection(unsigned long long id);
+extern void clear_connections();
+
+// performance_schema.profiler_connection_allocs
+extern Snapshot_table connection_allocs_table;
+
+#endif /* PROFILER_JEMALLOC_CONNECTIONS_H */
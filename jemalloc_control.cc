@@ -0,0 +1,116 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#include "jemalloc_control.h"
+
+#include <jemalloc/jemalloc.h>
+
+#include <string>
+
+namespace {
+
+std::string arena_ctl(int arena, const char *name) {
+  return "arena." +
+         (arena == JEMALLOC_ALL_ARENAS ? std::to_string(MALLCTL_ARENAS_ALL)
+                                       : std::to_string(arena)) +
+         "." + name;
+}
+
+}  // namespace
+
+bool get_jemalloc_decay_ms(const char *kind, int arena, ssize_t *ms) {
+  std::string name = std::string(kind) + "_decay_ms";
+  name = arena == JEMALLOC_ALL_ARENAS ? "arenas." + name
+                                      : arena_ctl(arena, name.c_str());
+  size_t length = sizeof(*ms);
+  return mallctl(name.c_str(), ms, &length, nullptr, 0) == 0;
+}
+
+bool set_jemalloc_decay_ms(const char *kind, int arena, ssize_t ms) {
+  std::string name = std::string(kind) + "_decay_ms";
+  if (arena != JEMALLOC_ALL_ARENAS)
+    return mallctl(arena_ctl(arena, name.c_str()).c_str(), nullptr, nullptr,
+                   &ms, sizeof(ms)) == 0;
+
+  // arenas.*_decay_ms is only the default of the new arenas
+  if (mallctl(("arenas." + name).c_str(), nullptr, nullptr, &ms, sizeof(ms)) !=
+      0)
+    return false;
+  unsigned int narenas = 0;
+  size_t length = sizeof(narenas);
+  if (mallctl("arenas.narenas", &narenas, &length, nullptr, 0) != 0)
+    return false;
+  for (unsigned int i = 0; i < narenas; i++) {
+    // Fails for the arenas not initialized yet, they get the new default
+    mallctl(arena_ctl(i, name.c_str()).c_str(), nullptr, nullptr, &ms,
+            sizeof(ms));
+  }
+  return true;
+}
+
+bool purge_jemalloc_arena(int arena, bool decay_only) {
+  return mallctl(arena_ctl(arena, decay_only ? "decay" : "purge").c_str(),
+                 nullptr, nullptr, nullptr, 0) == 0;
+}
+
+bool get_jemalloc_background_thread(bool *enabled) {
+  size_t length = sizeof(*enabled);
+  return mallctl("background_thread", enabled, &length, nullptr, 0) == 0;
+}
+
+bool set_jemalloc_background_thread(bool enabled) {
+  return mallctl("background_thread", nullptr, nullptr, &enabled,
+                 sizeof(enabled)) == 0;
+}
+
+bool jemalloc_prof_enabled() {
+  bool enabled = false;
+  size_t length = sizeof(enabled);
+  return mallctl("opt.prof", &enabled, &length, nullptr, 0) == 0 && enabled;
+}
+
+std::string set_jemalloc_prof_prefix(const std::string& prefix) {
+  const char *value = prefix.c_str();
+  if (mallctl("prof.prefix", nullptr, nullptr, &value, sizeof(value)) == 0)
+    return prefix;
+  const char *current = nullptr;
+  size_t length = sizeof(current);
+  if (mallctl("opt.prof_prefix", &current, &length, nullptr, 0) != 0 ||
+      current == nullptr)
+    return "jeprof";
+  return current;
+}
+
+bool get_jemalloc_lg_prof_sample(size_t *lg_sample) {
+  size_t length = sizeof(*lg_sample);
+  return mallctl("prof.lg_sample", lg_sample, &length, nullptr, 0) == 0;
+}
+
+bool reset_jemalloc_prof(size_t lg_sample) {
+  return mallctl("prof.reset", nullptr, nullptr, &lg_sample,
+                 sizeof(lg_sample)) == 0;
+}
+
+bool set_jemalloc_gdump(bool enabled) {
+  return mallctl("prof.gdump", nullptr, nullptr, &enabled, sizeof(enabled)) ==
+         0;
+}
@@ -0,0 +1,69 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#ifndef PROFILER_JEMALLOC_CONTROL_H
+#define PROFILER_JEMALLOC_CONTROL_H
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <string>
+
+// Arena argument meaning the default of the new arenas for the decay times
+// and all the arenas for the purges
+#define JEMALLOC_ALL_ARENAS -1
+
+// Decay time of the "dirty" or "muzzy" pages in milliseconds, -1 never
+// purges them. Setting it for all the arenas also changes the default of
+// the arenas created later. Return false on failure (unknown arena, value
+// refused by jemalloc).
+extern bool get_jemalloc_decay_ms(const char *kind, int arena, ssize_t *ms);
+extern bool set_jemalloc_decay_ms(const char *kind, int arena, ssize_t ms);
+
+// Return the unused dirty pages of the arena(s) to the system: all of them
+// (arena.<i>.purge) or only the ones whose decay time has passed
+// (arena.<i>.decay)
+extern bool purge_jemalloc_arena(int arena, bool decay_only);
+
+// Background threads purging the arenas instead of the application threads
+extern bool get_jemalloc_background_thread(bool *enabled);
+extern bool set_jemalloc_background_thread(bool enabled);
+
+// jemalloc built with --enable-prof and started with prof:true in
+// MALLOC_CONF, opt.prof can't be changed at runtime
+extern bool jemalloc_prof_enabled();
+
+// Prefix of the dumps written by jemalloc itself (gdump, interval): the
+// path given if prof.prefix is writable (jemalloc 5.3), opt.prof_prefix
+// otherwise
+extern std::string set_jemalloc_prof_prefix(const std::string& prefix);
+
+// Average bytes between two sampled allocations as a power of two
+extern bool get_jemalloc_lg_prof_sample(size_t *lg_sample);
+// Discard the collected samples and sample every 2^lg_sample bytes from
+// now on (prof.reset)
+extern bool reset_jemalloc_prof(size_t lg_sample);
+
+// Dump each time the virtual memory reaches a new maximum (prof.gdump)
+extern bool set_jemalloc_gdump(bool enabled);
+
+#endif /* PROFILER_JEMALLOC_CONTROL_H */
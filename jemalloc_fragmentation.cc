@@ -0,0 +1,228 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#include "jemalloc_fragmentation.h"
+#include "jemalloc_stats.h"
+
+#include <jemalloc/jemalloc.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+// The statistics merged over all the arenas, with the size class index in
+// the 5th component
+const std::string ALL_ARENAS =
+    "stats.arenas." + std::to_string(MALLCTL_ARENAS_ALL);
+const int CLASS_INDEX = 4;
+// Position of the index in arenas.bin.<j>.*
+const int BIN_INDEX = 2;
+
+Jemalloc_mib allocated_mib("stats.allocated");
+Jemalloc_mib active_mib("stats.active");
+Jemalloc_mib metadata_mib("stats.metadata");
+Jemalloc_mib resident_mib("stats.resident");
+Jemalloc_mib page_mib("arenas.page");
+Jemalloc_mib nbins_mib("arenas.nbins");
+Jemalloc_mib bin_size_mib("arenas.bin.0.size");
+Jemalloc_mib bin_nregs_mib("arenas.bin.0.nregs");
+Jemalloc_mib bin_slab_size_mib("arenas.bin.0.slab_size");
+Jemalloc_mib curregs_mib(ALL_ARENAS + ".bins.0.curregs");
+Jemalloc_mib curslabs_mib(ALL_ARENAS + ".bins.0.curslabs");
+Jemalloc_mib nonfull_slabs_mib(ALL_ARENAS + ".bins.0.nonfull_slabs");
+Jemalloc_mib pdirty_mib(ALL_ARENAS + ".pdirty");
+Jemalloc_mib pmuzzy_mib(ALL_ARENAS + ".pmuzzy");
+Jemalloc_mib dirty_bytes_mib(ALL_ARENAS + ".extents.0.dirty_bytes");
+Jemalloc_mib muzzy_bytes_mib(ALL_ARENAS + ".extents.0.muzzy_bytes");
+Jemalloc_mib retained_bytes_mib(ALL_ARENAS + ".extents.0.retained_bytes");
+
+// Page size classes are not exposed by mallctl, they follow the default
+// scheme of 4 classes per doubling: 1, 2, 3, 4, 5, 6, 7, 8, 10, 12... pages
+size_t page_size_class(size_t index, size_t page) {
+  if (index < 4) return (index + 1) * page;
+  size_t base = (4 * page) << (index / 4 - 1);
+  return base + (index % 4 + 1) * (base / 4);
+}
+
+double mb(uint64_t bytes) { return bytes / 1048576.0; }
+
+size_t read_size(Jemalloc_mib *mib) {
+  size_t value = 0;
+  jemalloc_read(mib, &value);
+  return value;
+}
+
+void fill_jemalloc_bins(std::vector<Snapshot_row> *rows) {
+  std::vector<Jemalloc_bin_usage> bins;
+  if (!read_jemalloc_bins(&bins)) return;
+  for (const Jemalloc_bin_usage& bin : bins)
+    rows->push_back(
+        {Snapshot_value::unsigned_number(bin.bin),
+         Snapshot_value::unsigned_number(bin.size),
+         Snapshot_value::unsigned_number(bin.nregs),
+         Snapshot_value::unsigned_number(bin.slab_size),
+         Snapshot_value::unsigned_number(bin.curslabs),
+         bin.nonfull_slabs < 0
+             ? Snapshot_value::null()
+             : Snapshot_value::unsigned_number(bin.nonfull_slabs),
+         Snapshot_value::unsigned_number(bin.curregs),
+         Snapshot_value::unsigned_number(bin.size * bin.curregs),
+         Snapshot_value::unsigned_number(bin.wasted_bytes()),
+         Snapshot_value::unsigned_number((unsigned long long)(
+             bin.utilization() + 0.5))});
+}
+
+}  // namespace
+
+bool read_jemalloc_bins(std::vector<Jemalloc_bin_usage> *bins) {
+  refresh_jemalloc_stats();
+  unsigned int nbins = 0;
+  if (!jemalloc_read(&nbins_mib, &nbins)) return false;
+  for (unsigned int i = 0; i < nbins; i++) {
+    Jemalloc_bin_usage bin;
+    bin.bin = i;
+    if (!jemalloc_read(&curslabs_mib, &bin.curslabs, CLASS_INDEX, i))
+      return false;
+    if (bin.curslabs == 0) continue;
+    jemalloc_read(&curregs_mib, &bin.curregs, CLASS_INDEX, i);
+    jemalloc_read(&bin_size_mib, &bin.size, BIN_INDEX, i);
+    jemalloc_read(&bin_nregs_mib, &bin.nregs, BIN_INDEX, i);
+    jemalloc_read(&bin_slab_size_mib, &bin.slab_size, BIN_INDEX, i);
+    size_t nonfull = 0;
+    if (jemalloc_read(&nonfull_slabs_mib, &nonfull, CLASS_INDEX, i))
+      bin.nonfull_slabs = nonfull;
+    bins->push_back(bin);
+  }
+  std::sort(bins->begin(), bins->end(),
+            [](const Jemalloc_bin_usage& a, const Jemalloc_bin_usage& b) {
+              return a.wasted_bytes() > b.wasted_bytes();
+            });
+  return true;
+}
+
+void read_jemalloc_extents(std::vector<Jemalloc_extent_usage> *extents) {
+  refresh_jemalloc_stats();
+  size_t page = read_size(&page_mib);
+  // The number of page size classes isn't exposed either, read until the
+  // first unknown index
+  for (size_t i = 0; i < 256; i++) {
+    Jemalloc_extent_usage extent;
+    if (!jemalloc_read(&dirty_bytes_mib, &extent.dirty_bytes, CLASS_INDEX, i))
+      break;
+    jemalloc_read(&muzzy_bytes_mib, &extent.muzzy_bytes, CLASS_INDEX, i);
+    jemalloc_read(&retained_bytes_mib, &extent.retained_bytes, CLASS_INDEX, i);
+    if (extent.dirty_bytes + extent.muzzy_bytes + extent.retained_bytes == 0)
+      continue;
+    extent.size = page_size_class(i, page);
+    extents->push_back(extent);
+  }
+  std::sort(extents->begin(), extents->end(),
+            [](const Jemalloc_extent_usage& a, const Jemalloc_extent_usage& b) {
+              return a.dirty_bytes + a.muzzy_bytes >
+                     b.dirty_bytes + b.muzzy_bytes;
+            });
+}
+
+bool jemalloc_fragmentation_report(long long limit, std::string *report,
+                                   uint64_t *wasted) {
+  std::vector<Jemalloc_bin_usage> bins;
+  if (!read_jemalloc_bins(&bins)) return false;
+  std::vector<Jemalloc_extent_usage> extents;
+  read_jemalloc_extents(&extents);
+
+  size_t allocated = read_size(&allocated_mib);
+  size_t active = read_size(&active_mib);
+  size_t metadata = read_size(&metadata_mib);
+  size_t resident = read_size(&resident_mib);
+  size_t page = read_size(&page_mib);
+  size_t pdirty = 0, pmuzzy = 0;
+  jemalloc_read(&pdirty_mib, &pdirty);
+  jemalloc_read(&pmuzzy_mib, &pmuzzy);
+
+  uint64_t slab_bytes = 0, used_bytes = 0;
+  *wasted = 0;
+  for (const Jemalloc_bin_usage& bin : bins) {
+    slab_bytes += bin.curslabs * bin.slab_size;
+    used_bytes += bin.curregs * bin.size;
+    *wasted += bin.wasted_bytes();
+  }
+
+  // Where the resident memory goes: allocated, free regions in the slabs
+  // and page rounding (active - allocated), unused pages not returned to
+  // the system yet, and the metadata of jemalloc
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(1);
+  out << "Resident: " << mb(resident) << " MB, allocated: " << mb(allocated)
+      << " MB (" << (resident > 0 ? 100.0 * allocated / resident : 0)
+      << "%)\n";
+  out << "  active not allocated: "
+      << mb(active > allocated ? active - allocated : 0) << " MB, of which "
+      << mb(*wasted) << " MB of free regions in slabs\n";
+  out << "  dirty pages: " << mb(pdirty * page) << " MB, muzzy pages: "
+      << mb(pmuzzy * page) << " MB\n";
+  out << "  metadata: " << mb(metadata) << " MB\n";
+  out << "Small size classes: " << mb(slab_bytes) << " MB in slabs, "
+      << mb(used_bytes) << " MB used ("
+      << (slab_bytes > 0 ? 100.0 * used_bytes / slab_bytes : 100.0)
+      << "%)\n\n";
+
+  out << "      size      slabs    nonfull    regions  util%  wasted MB\n";
+  long long rank = 0;
+  for (const Jemalloc_bin_usage& bin : bins) {
+    if (limit > 0 && rank++ >= limit) break;
+    out << std::setw(10) << bin.size << " " << std::setw(10) << bin.curslabs
+        << " " << std::setw(10);
+    if (bin.nonfull_slabs < 0)
+      out << "-";
+    else
+      out << bin.nonfull_slabs;
+    out << " " << std::setw(10) << bin.curregs << " " << std::setw(6)
+        << bin.utilization() << " " << std::setw(10) << mb(bin.wasted_bytes())
+        << "\n";
+  }
+
+  if (!extents.empty()) {
+    out << "\nUnused extents by size:\n";
+    out << "      size   dirty MB   muzzy MB retained MB\n";
+    rank = 0;
+    for (const Jemalloc_extent_usage& extent : extents) {
+      if (limit > 0 && rank++ >= limit) break;
+      out << std::setw(10) << extent.size << " " << std::setw(10)
+          << mb(extent.dirty_bytes) << " " << std::setw(10)
+          << mb(extent.muzzy_bytes) << " " << std::setw(11)
+          << mb(extent.retained_bytes) << "\n";
+    }
+  }
+  *report = out.str();
+  return true;
+}
+
+Snapshot_table jemalloc_bins_table = {
+    "profiler_jemalloc_bins",
+    "`BIN` BIGINT unsigned, `SIZE` BIGINT unsigned, "
+    "`REGIONS_PER_SLAB` BIGINT unsigned, `SLAB_SIZE` BIGINT unsigned, "
+    "`SLABS` BIGINT unsigned, `NONFULL_SLABS` BIGINT unsigned, "
+    "`REGIONS` BIGINT unsigned, `USED_BYTES` BIGINT unsigned, "
+    "`WASTED_BYTES` BIGINT unsigned, `UTILIZATION` BIGINT unsigned",
+    fill_jemalloc_bins, 40, {}};
@@ -0,0 +1,76 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#ifndef PROFILER_JEMALLOC_FRAGMENTATION_H
+#define PROFILER_JEMALLOC_FRAGMENTATION_H
+
+#include "snapshot_table.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Slab usage of one small size class, merged over all the arenas
+struct Jemalloc_bin_usage {
+  unsigned int bin = 0;
+  size_t size = 0;
+  uint32_t nregs = 0;
+  size_t slab_size = 0;
+  size_t curregs = 0;
+  size_t curslabs = 0;
+  // -1 when this jemalloc doesn't count them (before 5.2.1)
+  long long nonfull_slabs = -1;
+
+  size_t capacity() const { return curslabs * nregs; }
+  // Free regions in the slabs of the size class
+  size_t wasted_bytes() const {
+    return curregs < capacity() ? (capacity() - curregs) * size : 0;
+  }
+  double utilization() const {
+    return capacity() > 0 ? 100.0 * curregs / capacity() : 100.0;
+  }
+};
+
+// Unused extents of one page size class, merged over all the arenas
+struct Jemalloc_extent_usage {
+  size_t size = 0;
+  size_t dirty_bytes = 0;
+  size_t muzzy_bytes = 0;
+  size_t retained_bytes = 0;
+};
+
+// Size classes with slabs, the most wasteful first. Returns false when the
+// jemalloc statistics can't be read.
+extern bool read_jemalloc_bins(std::vector<Jemalloc_bin_usage> *bins);
+// Page size classes with unused extents, the largest first (jemalloc 5.2)
+extern void read_jemalloc_extents(std::vector<Jemalloc_extent_usage> *extents);
+
+// Text report of memprof_jemalloc_fragmentation(), limit is the number of
+// size classes listed (0 for all)
+extern bool jemalloc_fragmentation_report(long long limit, std::string *report,
+                                          uint64_t *wasted);
+
+// performance_schema.profiler_jemalloc_bins: one row per size class in use
+extern Snapshot_table jemalloc_bins_table;
+
+#endif /* PROFILER_JEMALLOC_FRAGMENTATION_H */
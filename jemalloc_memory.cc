@@ -24,6 +24,25 @@
 #define SIGNATURE_CHANGE 1
 
 #include "jemalloc_memory.h"
+#include "memory_timeline.h"
+#include "jemalloc_stats.h"
+#include "jemalloc_control.h"
+#include "jemalloc_autodump.h"
+#include "jemalloc_recent.h"
+#include "jemalloc_connections.h"
+#include "jemalloc_fragmentation.h"
+#include "jemalloc_stats_json.h"
+#include "memory_watchdog.h"
+#include "schedule.h"
+
+#include <algorithm>
+#include <climits>
+#include <list>
+#include <mutex>
+
+#if MYSQL_VERSION_ID >= 80100
+#include <mysql/components/services/event_tracking_connection_service.h>
+#endif
 
 REQUIRES_SERVICE_PLACEHOLDER(log_builtins);
 REQUIRES_SERVICE_PLACEHOLDER(log_builtins_string);
@@ -42,6 +61,11 @@ REQUIRES_SERVICE_PLACEHOLDER(mysql_system_variable_reader);
 #endif
 REQUIRES_SERVICE_PLACEHOLDER(profiler_var);
 REQUIRES_SERVICE_PLACEHOLDER(profiler_pfs);
+REQUIRES_SERVICE_PLACEHOLDER(profiler_dump_store);
+REQUIRES_SERVICE_PLACEHOLDER(pfs_plugin_table_v1);
+REQUIRES_SERVICE_PLACEHOLDER_AS(pfs_plugin_column_string_v2, pfs_string);
+REQUIRES_SERVICE_PLACEHOLDER_AS(pfs_plugin_column_bigint_v1, pfs_bigint);
+REQUIRES_SERVICE_PLACEHOLDER_AS(pfs_plugin_column_timestamp_v2, pfs_timestamp);
 
 SERVICE_TYPE(log_builtins) * log_bi;
 SERVICE_TYPE(log_builtins_string) * log_bs;
@@ -57,12 +81,352 @@ int dump_count;
 // Buffer for the value of the profiler.dump_path global variable
 std::string memprof_jemalloc_dump_path;
 
+// The dumps are numbered by the UDF and the background thread
+static std::mutex jemalloc_dump_mutex;
+// Protects memprof_jemalloc_status and the start and stop of the profiler:
+// the UDFs, the watchdog and the schedule use them concurrently. The series
+// (memprof_jemalloc_dump_path, dump_count) is only changed with both mutexes
+// held, this one first, the dump writers only take jemalloc_dump_mutex.
+static std::mutex memprof_jemalloc_mutex;
+// Incremented each time the profiler starts, a scheduled run only stops the
+// session it started
+static unsigned long memprof_jemalloc_session = 0;
+static unsigned long memprof_jemalloc_scheduled_session = 0;
+// opt.prof probed when the component is loaded
+static bool jemalloc_prof_available = false;
+
+#define DEFAULT_JEMALLOC_LG_PROF_SAMPLE 19
+// Value of the profiler.jemalloc_lg_prof_sample global variable
+static unsigned int jemalloc_lg_prof_sample = DEFAULT_JEMALLOC_LG_PROF_SAMPLE;
+// Value of the profiler.jemalloc_gdump global variable
+static bool jemalloc_gdump = false;
+
+// Start a new series of heap dumps: <dump_path>.NNNN.heap
+static void start_jemalloc_dump_series(const std::string& dump_path) {
+  std::lock_guard<std::mutex> guard(jemalloc_dump_mutex);
+  memprof_jemalloc_dump_path = dump_path;
+  dump_count = 1;
+}
+
+// Number of the next dump of the current series
+static int jemalloc_dump_count() {
+  std::lock_guard<std::mutex> guard(jemalloc_dump_mutex);
+  return dump_count;
+}
+
+static std::string jemalloc_dump_name(int number) {
+  std::lock_guard<std::mutex> guard(jemalloc_dump_mutex);
+  std::ostringstream filename;
+  filename << memprof_jemalloc_dump_path << "."  << std::setw(4) << std::setfill('0') << number << ".heap";
+  return filename.str();
+}
+
+// Write the next heap dump of the series, filePath receives its name
+static bool write_jemalloc_dump(const char *reason, std::string *filePath) {
+  std::lock_guard<std::mutex> guard(jemalloc_dump_mutex);
+  std::ostringstream filename;
+  filename << memprof_jemalloc_dump_path << "."  << std::setw(4) << std::setfill('0') << dump_count << ".heap";
+  *filePath = filename.str();
+  // The dump may be kept in memory (profiler.dump_store)
+  Dump_location location;
+  dump_write_location(*filePath, &location);
+  const char* fname = location.path().c_str();
+
+  if (mallctl("prof.dump", nullptr, nullptr, &fname, sizeof(const char*)) != 0)
+    return false;
+  mysql_service_profiler_pfs->add("memory", "jemalloc", "dumped", filePath->c_str(), reason);
+  ++dump_count;
+  return true;
+}
+
+static void write_interval_dump(const char *reason) {
+  std::string filePath;
+  if (!write_jemalloc_dump(reason, &filePath))
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG, "error dumping profile");
+}
+
+// Called by the watchdog when profiler.memory_dump_threshold_bytes is
+// crossed. The dump goes in the series while the profiler runs, next to it
+// otherwise: jemalloc only has the allocations sampled while prof.active was
+// set.
+static void write_threshold_dump(const char *reason) {
+  std::string filePath;
+  if (jemalloc_prof_available) {
+    std::lock_guard<std::mutex> guard(memprof_jemalloc_mutex);
+    if (strcmp(memprof_jemalloc_status, "RUNNING") == 0) {
+      if (!write_jemalloc_dump(reason, &filePath)) filePath.clear();
+    } else {
+      char variable_value[1024];
+      size_t value_length = sizeof(variable_value) - 1;
+      if (!mysql_service_profiler_var->get("dump_path", variable_value, &value_length)) {
+        variable_value[value_length] = '\0';
+        filePath = next_threshold_dump_name(variable_value);
+        Dump_location location;
+        dump_write_location(filePath, &location);
+        const char* fname = location.path().c_str();
+        if (mallctl("prof.dump", nullptr, nullptr, &fname, sizeof(const char*)) == 0)
+          mysql_service_profiler_pfs->add("memory", "jemalloc", "sampled", filePath.c_str(), reason);
+        else
+          filePath.clear();
+      }
+    }
+  }
+  if (filePath.empty()) {
+    LogComponentErr(WARNING_LEVEL, ER_LOG_PRINTF_MSG,
+                    (std::string("memory ") + reason +
+                     ", no heap dump written: jemalloc profiling requires MALLOC_CONF=prof:true.").c_str());
+    mysql_service_profiler_pfs->add("memory", "jemalloc", "threshold", "", reason);
+    return;
+  }
+
+  LogComponentErr(WARNING_LEVEL, ER_LOG_PRINTF_MSG,
+                  (std::string("memory ") + reason + ", heap dump written to " +
+                   filePath).c_str());
+  std::string profile;
+  std::vector<std::string> lines;
+  if (read_dump_file(filePath, &profile)) format_heap_sites(profile, &lines);
+  for (const std::string& line : lines)
+    LogComponentErr(WARNING_LEVEL, ER_LOG_PRINTF_MSG, line.c_str());
+}
+
+// The dumps written by jemalloc itself are renamed into the series, they
+// are listed and reported like the others
+static void import_jemalloc_dump(const std::string& file, const char *reason) {
+  std::lock_guard<std::mutex> guard(jemalloc_dump_mutex);
+  std::ostringstream filename;
+  filename << memprof_jemalloc_dump_path << "."  << std::setw(4) << std::setfill('0') << dump_count << ".heap";
+  std::string filePath = filename.str();
+
+  bool imported;
+  Dump_location location;
+  dump_write_location(filePath, &location);
+  if (!location.in_memory()) {
+    imported = rename(file.c_str(), filePath.c_str()) == 0;
+  } else {
+    std::string data;
+    imported = read_dump_file(file, &data) &&
+               write_file(location.path(), data.data(), data.size());
+    if (imported) unlink(file.c_str());
+  }
+  if (!imported) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    ("could not import the jemalloc dump " + file).c_str());
+    return;
+  }
+  mysql_service_profiler_pfs->add("memory", "jemalloc", "dumped", filePath.c_str(), reason);
+  ++dump_count;
+}
+
+static bool read_profile_schedule(std::string *spec) {
+  char variable_value[1024];
+  size_t value_length = sizeof(variable_value) - 1;
+  if (mysql_service_profiler_var->get("schedule", variable_value, &value_length) ||
+      value_length >= sizeof(variable_value))
+    return false;
+  variable_value[value_length] = '\0';
+  *spec = variable_value;
+  return true;
+}
+
+// A run of profiler.schedule writes its own series of heap dumps:
+// <dump_path>.<run name>.NNNN.heap, sampled from the start of the run
+static bool start_scheduled_heap_profile(Scheduled_run *run) {
+  char variable_value[1024];
+  size_t value_length = sizeof(variable_value) - 1;
+  if (mysql_service_profiler_var->get("dump_path", variable_value, &value_length))
+    return false;
+  variable_value[value_length] = '\0';
+  run->prefix = std::string(variable_value) + "." + run->name;
+
+  std::lock_guard<std::mutex> guard(memprof_jemalloc_mutex);
+  const char *skipped = nullptr;
+  bool active = true;
+  if (!jemalloc_prof_available)
+    skipped = "jemalloc profiling requires MALLOC_CONF=prof:true,prof_active:false";
+  // The component was reloaded during the minute of the run
+  else if (dump_file_exists(run->prefix + ".0001.heap"))
+    skipped = "the heap dumps already exist";
+  else if (strcmp(memprof_jemalloc_status, "STOPPED") != 0)
+    skipped = "the jemalloc memory profiler is already running";
+  else {
+    start_jemalloc_dump_series(run->prefix);
+    std::string prof_prefix = set_jemalloc_prof_prefix(run->prefix);
+    if (!reset_jemalloc_prof(jemalloc_lg_prof_sample) ||
+        mallctl("prof.active", nullptr, nullptr, &active, sizeof(active)) != 0)
+      skipped = "error enabling jemalloc profiling";
+    else {
+      strcpy(memprof_jemalloc_status, "RUNNING");
+      memprof_jemalloc_scheduled_session = ++memprof_jemalloc_session;
+      if (jemalloc_gdump) set_jemalloc_gdump(true);
+      start_jemalloc_autodump(prof_prefix);
+    }
+  }
+  if (skipped != nullptr) {
+    LogComponentErr(WARNING_LEVEL, ER_LOG_PRINTF_MSG,
+                    (run->extra + ", run skipped: " + skipped + ".").c_str());
+    mysql_service_profiler_pfs->add("memory", "jemalloc", "skipped", "", run->extra.c_str());
+    return false;
+  }
+  mysql_service_profiler_pfs->add("memory", "jemalloc", "started", "", run->extra.c_str());
+  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                  (run->extra + ", heap dumps written to " + run->prefix +
+                   ".NNNN.heap").c_str());
+  return true;
+}
+
+// Stopped or restarted by memprof_jemalloc_stop() and
+// memprof_jemalloc_start() otherwise, memprof_jemalloc_mutex must be held
+static bool scheduled_heap_profile_running() {
+  return strcmp(memprof_jemalloc_status, "RUNNING") == 0 &&
+         memprof_jemalloc_session == memprof_jemalloc_scheduled_session;
+}
+
+static void dump_scheduled_heap_profile(const Scheduled_run&) {
+  std::lock_guard<std::mutex> guard(memprof_jemalloc_mutex);
+  if (scheduled_heap_profile_running()) write_interval_dump("schedule");
+}
+
+// Unlike memprof_jemalloc_stop() the run ends with a dump, the runs of the
+// different days are compared with it
+static void stop_scheduled_heap_profile(const Scheduled_run&,
+                                        const char *reason) {
+  std::lock_guard<std::mutex> guard(memprof_jemalloc_mutex);
+  if (!scheduled_heap_profile_running()) return;
+  write_interval_dump("stopping");
+  bool active = false;
+  if (mallctl("prof.active", nullptr, nullptr, &active, sizeof(active)) != 0)
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "Error disabling jemalloc profiling.");
+  if (jemalloc_gdump) set_jemalloc_gdump(false);
+  stop_jemalloc_autodump();
+  strcpy(memprof_jemalloc_status, "STOPPED");
+  mysql_service_profiler_pfs->add("memory", "jemalloc", "stopped", "", reason);
+}
+
+static int jemalloc_lg_prof_sample_check(MYSQL_THD thd,
+                                         SYS_VAR *self MY_ATTRIBUTE((unused)),
+                                         void *save,
+                                         struct st_mysql_value *value) {
+  if (!check_variable_privilege(thd, "profiler.jemalloc_lg_prof_sample"))
+    return (ER_SPECIFIC_ACCESS_DENIED_ERROR);
+
+  long long new_value = 0;
+  if (value->val_int(value, &new_value) || new_value < 0 || new_value > 62) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "wrong value it must be between 0 and 62.");
+    return true;
+  }
+
+  *static_cast<unsigned int *>(save) = new_value;
+
+  return (0);
+}
+
+// A running profiler starts a new window with the new sampling
+static void jemalloc_lg_prof_sample_update(MYSQL_THD, SYS_VAR *, void *var_ptr,
+                                           const void *save) {
+  *static_cast<unsigned int *>(var_ptr) =
+      *static_cast<const unsigned int *>(save);
+  std::lock_guard<std::mutex> guard(memprof_jemalloc_mutex);
+  if (strcmp(memprof_jemalloc_status, "STOPPED") == 0) return;
+  if (reset_jemalloc_prof(jemalloc_lg_prof_sample)) {
+    char extra[100];
+    snprintf(extra, sizeof(extra), "lg_prof_sample: %u", jemalloc_lg_prof_sample);
+    mysql_service_profiler_pfs->add("memory", "jemalloc", "reset", "", extra);
+  }
+}
+
+static int jemalloc_dump_interval_bytes_check(
+    MYSQL_THD thd, SYS_VAR *self MY_ATTRIBUTE((unused)), void *save,
+    struct st_mysql_value *value) {
+  return check_unsigned_value(thd, "profiler.jemalloc_dump_interval_bytes",
+                              "bytes", save, value);
+}
+
+static void jemalloc_dump_interval_bytes_update(MYSQL_THD, SYS_VAR *,
+                                                void *var_ptr,
+                                                const void *save) {
+  *static_cast<unsigned long long *>(var_ptr) =
+      *static_cast<const unsigned long long *>(save);
+}
+
+// Value of the profiler.jemalloc_recent_allocs global variable
+static unsigned int jemalloc_recent_allocs = 0;
+
+static int jemalloc_recent_allocs_check(MYSQL_THD thd,
+                                        SYS_VAR *self MY_ATTRIBUTE((unused)),
+                                        void *save,
+                                        struct st_mysql_value *value) {
+  if (!check_variable_privilege(thd, "profiler.jemalloc_recent_allocs"))
+    return (ER_SPECIFIC_ACCESS_DENIED_ERROR);
+
+  long long current = 0;
+  if (!get_jemalloc_recent_alloc_max(&current)) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "this jemalloc doesn't keep the recent allocations, jemalloc 5.3 is required.");
+    return true;
+  }
+
+  long long new_value = 0;
+  if (value->val_int(value, &new_value) || new_value < 0 || new_value > 100000) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "wrong value it must be between 0 and 100000.");
+    return true;
+  }
+
+  *static_cast<unsigned int *>(save) = new_value;
+
+  return (0);
+}
+
+static void jemalloc_recent_allocs_update(MYSQL_THD, SYS_VAR *, void *var_ptr,
+                                          const void *save) {
+  *static_cast<unsigned int *>(var_ptr) =
+      *static_cast<const unsigned int *>(save);
+  set_jemalloc_recent_alloc_max(jemalloc_recent_allocs);
+}
+
+static int jemalloc_gdump_check(MYSQL_THD thd,
+                                SYS_VAR *self MY_ATTRIBUTE((unused)),
+                                void *save, struct st_mysql_value *value) {
+  if (!check_variable_privilege(thd, "profiler.jemalloc_gdump"))
+    return (ER_SPECIFIC_ACCESS_DENIED_ERROR);
+
+  long long new_value = 0;
+  if (value->val_int(value, &new_value)) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "wrong value it must be ON or OFF.");
+    return true;
+  }
+
+  *static_cast<bool *>(save) = new_value != 0;
+
+  return (0);
+}
+
+static void jemalloc_gdump_update(MYSQL_THD, SYS_VAR *, void *var_ptr,
+                                  const void *save) {
+  *static_cast<bool *>(var_ptr) = *static_cast<const bool *>(save);
+  std::lock_guard<std::mutex> guard(memprof_jemalloc_mutex);
+  if (strcmp(memprof_jemalloc_status, "STOPPED") != 0)
+    set_jemalloc_gdump(jemalloc_gdump);
+}
+
 static SHOW_VAR memprof_jemalloc_status_variables[] = {
   {"profiler.jemalloc_memory_status", (char *)&memprof_jemalloc_status, SHOW_CHAR,
     SHOW_SCOPE_GLOBAL},{nullptr, nullptr, SHOW_UNDEF,
     SHOW_SCOPE_UNDEF}  // null terminator required
 };
 
+/* performance_schema tables of the component */
+static PFS_engine_table_share_proxy *jemalloc_share_list[8] = {
+    nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
+static const unsigned int jemalloc_share_list_count = 8;
+
 static int jeprof_path_check(MYSQL_THD thd,
                                        SYS_VAR *self MY_ATTRIBUTE((unused)),
                                        void *save,
@@ -247,10 +611,9 @@ const char *memprof_jemalloc_start_udf(UDF_INIT *, UDF_ARGS *, char *outp,
     *is_null = 1;
     return 0;
   }
-  memprof_jemalloc_dump_path = variable_value;
-  std::string filePath = memprof_jemalloc_dump_path + ".0001.heap";
-  // Check if there is something already existing
-  if (fileExists(filePath)) {
+  std::string filePath = std::string(variable_value) + ".0001.heap";
+  // Check if there is something already existing, maybe compressed
+  if (dump_file_exists(filePath)) {
     mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
                                     ER_UDF_ERROR, 0, "profiler",
                                     "There is already a heap dump, change the 'profiler.dump_path' value first.");
@@ -258,23 +621,15 @@ const char *memprof_jemalloc_start_udf(UDF_INIT *, UDF_ARGS *, char *outp,
     *is_null = 1;
     return 0;
   }
-  dump_count = 1;
-  bool enable_prof = true;
-  mallctl("opt.prof", nullptr, nullptr, &enable_prof, sizeof(enable_prof));
-
-  const char* prof_prefix = memprof_jemalloc_dump_path.c_str();
-  mallctl("opt.prof_prefix", nullptr, nullptr, &prof_prefix, sizeof(const char*));
-
-  bool active = true;
-  if (mallctl("prof.active", nullptr, nullptr, &active, sizeof(active)) != 0)
-  {
+  if (!jemalloc_prof_available) {
     mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
                                     ER_UDF_ERROR, 0, "profiler",
-                                    "Error enabling jemalloc profiling.");
+                                    "jemalloc profiling is not enabled, mysqld must be started with MALLOC_CONF=prof:true,prof_active:false");
     *error = 1;
     *is_null = 1;
     return 0;
   }
+  std::lock_guard<std::mutex> guard(memprof_jemalloc_mutex);
   if (strcmp(memprof_jemalloc_status, "STOPPED") != 0) {
     mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
                                     ER_UDF_ERROR, 0, "profiler",
@@ -283,10 +638,41 @@ const char *memprof_jemalloc_start_udf(UDF_INIT *, UDF_ARGS *, char *outp,
     *is_null = 1;
     return 0;
   }
+  // Only once we know it's not running, the session in progress keeps its files
+  start_jemalloc_dump_series(variable_value);
+
+  // The dumps written by jemalloc itself go next to ours when possible
+  std::string prof_prefix = set_jemalloc_prof_prefix(variable_value);
+
+  // A new window: the samples collected before are discarded
+  if (!reset_jemalloc_prof(jemalloc_lg_prof_sample)) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "Error resetting jemalloc profiling.");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  bool active = true;
+  if (mallctl("prof.active", nullptr, nullptr, &active, sizeof(active)) != 0)
+  {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "Error enabling jemalloc profiling.");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
   strcpy(memprof_jemalloc_status, "RUNNING");
+  ++memprof_jemalloc_session;
+  if (jemalloc_gdump) set_jemalloc_gdump(true);
+  start_jemalloc_autodump(prof_prefix);
 
+  char extra[100];
+  snprintf(extra, sizeof(extra), "lg_prof_sample: %u", jemalloc_lg_prof_sample);
   strcpy(outp, "memory profiling started");
-  mysql_service_profiler_pfs->add("memory", "jemalloc", "started", "", "");
+  mysql_service_profiler_pfs->add("memory", "jemalloc", "started", "", extra);
 
   *length = strlen(outp);
 
@@ -337,6 +723,7 @@ const char *memprof_jemalloc_stop_udf(UDF_INIT *, UDF_ARGS *, char *outp,
     *is_null = 1;
     return 0;
   }
+  std::lock_guard<std::mutex> guard(memprof_jemalloc_mutex);
   if (strcmp(memprof_jemalloc_status, "STOPPED") == 0) {
     mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
                                     ER_UDF_ERROR, 0, "profiler",
@@ -358,6 +745,9 @@ const char *memprof_jemalloc_stop_udf(UDF_INIT *, UDF_ARGS *, char *outp,
     return 0;
   }
  
+  if (jemalloc_gdump) set_jemalloc_gdump(false);
+  stop_jemalloc_autodump();
+
   strcpy(memprof_jemalloc_status, "STOPPED");
   mysql_service_profiler_pfs->add("memory", "jemalloc", "stopped", "", "");
 
@@ -429,17 +819,14 @@ const char *memprof_jemalloc_dump_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
           strcpy(buf, "user request");
   }
 
-  std::ostringstream filename;
-  filename << memprof_jemalloc_dump_path << "."  << std::setw(4) << std::setfill('0') << dump_count << ".heap";
-  std::string filePath = filename.str();
-  const char* fname = filePath.c_str();
-
-  if (mallctl("prof.dump", nullptr, nullptr, &fname, sizeof(const char*)) != 0) {
+  std::lock_guard<std::mutex> guard(memprof_jemalloc_mutex);
+  std::string filePath;
+  // Stopped since memprof_jemalloc_dump_udf_init() checked it
+  if (strcmp(memprof_jemalloc_status, "STOPPED") == 0 ||
+      !write_jemalloc_dump(buf, &filePath)) {
         strcpy(outp, "error dumping profile");
   } else {
         strcpy(outp, "memory profiling data dumped");
-        mysql_service_profiler_pfs->add("memory", "jemalloc", "dumped", filePath.c_str(), buf); 
-        ++dump_count;
   }
 
   *length = strlen(outp);
@@ -450,10 +837,10 @@ const char *memprof_jemalloc_dump_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
 // UDF to run jeprof for memory 
 
 static bool jeprof_mem_udf_init(UDF_INIT *initid, UDF_ARGS *args, char *) {
-  if (args->arg_count > 1) {
+  if (args->arg_count > 2) {
     mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
                                     ER_UDF_ERROR, 0, "profiler",
-                                    "this function requires none or 1 parameter: 'text' or 'dot'");
+                                    "this function requires none, 1 or 2 parameters: <limit>, <'text', 'dot' or 'pb'>");
     return true;
   }
 
@@ -515,10 +902,12 @@ const char *jeprof_mem_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
                   report_type = "text";
           } else if (strcasecmp(report_type.c_str(), "DOT") == 0) {
                   report_type = "dot";
+          } else if (strcasecmp(report_type.c_str(), "PB") == 0) {
+                  report_type = "pb";
           } else {
 		mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
                                     ER_UDF_ERROR, 0, "profiler",
-                                    "wrong parameter it must be 'TEXT' or 'DOT'.");
+                                    "wrong parameter it must be 'TEXT', 'DOT' or 'PB'.");
     		*error = 1;
     		*is_null = 1;
     		return 0;
@@ -535,6 +924,41 @@ const char *jeprof_mem_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
     return 0;
   }
 
+  if (report_type == "pb") {
+    // profile.proto is written directly from the last dump, neither jeprof
+    // nor mysqld are needed
+    int count = jemalloc_dump_count();
+    if (count < 2) {
+      mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "there is no heap dump to export.");
+      *error = 1;
+      *is_null = 1;
+      return 0;
+    }
+    std::string filePath = jemalloc_dump_name(count - 1);
+    std::string buf;
+    if (!export_pprof(filePath, filePath + ".pb.gz", &buf)) {
+      mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "%s", buf.c_str());
+      *error = 1;
+      *is_null = 1;
+      return 0;
+    }
+    outp = (char *)malloc(buf.length() + 1);
+    if (outp == nullptr) {
+        *error = 1;
+        *is_null = 1;
+        return nullptr;
+    }
+    mysql_service_profiler_pfs->add("memory", "jemalloc", "report", (filePath + ".pb.gz").c_str(), report_type.c_str());
+    strcpy(outp, buf.c_str());
+    *length = strlen(outp);
+
+    return const_cast<char *>(outp);
+  }
+
   std::string mysqld_binary;
   if (get_mysqld(&mysqld_binary)) {
     mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
@@ -560,9 +984,37 @@ const char *jeprof_mem_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
     return 0;
   }
 
+  // jeprof can't read the compressed dumps and a glob would miss them, the
+  // dumps are listed explicitly
+  std::list<Plain_dump_file> dump_files;
+  std::string dump_list;
+  int count = jemalloc_dump_count();
+  for (int i = 1; i < count; i++) {
+    std::string filename = jemalloc_dump_name(i);
+    if (!dump_file_exists(filename)) continue;
+    dump_files.emplace_back();
+    if (!dump_files.back().open(filename)) {
+      mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "could not read the dump file %s", filename.c_str());
+      *error = 1;
+      *is_null = 1;
+      return 0;
+    }
+    dump_list += " " + dump_files.back().path();
+  }
+  if (dump_list.empty()) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "there is no heap dump to report.");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
   std::string buf; 
   buf = exec_pprof((std::string(p_variable_value) + " --" +  report_type + " "
-                 + mysqld_binary + " " + memprof_jemalloc_dump_path + "*.heap").c_str());
+                 + mysqld_binary + dump_list).c_str());
 
   if (limit > 0 && report_type == "text") {
     buf = limit_lines(buf, limit);
@@ -584,60 +1036,729 @@ const char *jeprof_mem_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
 }
 
 
+// UDF to reset the counters of profiler_jemalloc_mutexes
 
-} /* namespace udf_impl */
-
-static mysql_service_status_t profiler_jemalloc_memory_service_init() {
-  mysql_service_status_t result = 0;
+static bool memprof_jemalloc_mutex_reset_udf_init(UDF_INIT *initid,
+                                                  UDF_ARGS *args, char *) {
+  if (args->arg_count > 0) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "this function doesn't require any parameter");
+    return true;
+  }
+  const char* name = "utf8mb4";
+  char *value = const_cast<char*>(name);
+  initid->ptr = const_cast<char *>(udf_init);
+  if (mysql_service_mysql_udf_metadata->result_set(
+          initid, "charset",
+          const_cast<char *>(value))) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG, "failed to set result charset");
+    return false;
+  }
+  return false;
+}
 
-  log_bi = mysql_service_log_builtins;
-  log_bs = mysql_service_log_builtins_string;
+static void memprof_jemalloc_mutex_reset_udf_deinit(__attribute__((unused))
+                                                     UDF_INIT *initid) {
+  assert(initid->ptr == udf_init || initid->ptr == my_udf);
+}
 
-  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG, "initializing…");
+const char *memprof_jemalloc_mutex_reset_udf(UDF_INIT *, UDF_ARGS *,
+                                             char *outp, unsigned long *length,
+                                             char *is_null, char *error) {
+  *error = 0;
+  *is_null = 0;
 
-  list = new udf_list();
+  MYSQL_THD thd;
 
-  if (list->add_scalar("MEMPROF_JEMALLOC_START", Item_result::STRING_RESULT,
-                       (Udf_func_any)udf_impl::memprof_jemalloc_start_udf,
-                       udf_impl::memprof_jemalloc_start_udf_init,
-                       udf_impl::memprof_jemalloc_start_udf_deinit)) {
-    delete list;
-    return 1; /* failure: one of the UDF registrations failed */
+  mysql_service_mysql_current_thread_reader->get(&thd);
+  if (!have_required_privilege(thd))
+  {
+    mysql_error_service_printf(
+        ER_SPECIFIC_ACCESS_DENIED_ERROR, 0,
+        PRIVILEGE_NAME);
+    *error = 1;
+    *is_null = 1;
+    return 0;
   }
-  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
-                    "new UDF 'memprof_jemalloc_start()' has been registered successfully.");
 
-  if (list->add_scalar("MEMPROF_JEMALLOC_STOP", Item_result::STRING_RESULT,
-                       (Udf_func_any)udf_impl::memprof_jemalloc_stop_udf,
-                       udf_impl::memprof_jemalloc_stop_udf_init,
-                       udf_impl::memprof_jemalloc_stop_udf_deinit)) {
-    delete list;
-    return 1; /* failure: one of the UDF registrations failed */
+  if (!reset_jemalloc_mutex_stats()) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "Error resetting the jemalloc mutex statistics, is jemalloc built with --enable-stats?");
+    *error = 1;
+    *is_null = 1;
+    return 0;
   }
-  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
-                    "new UDF 'memprof_jemalloc_stop()' has been registered successfully.");
 
-  if (list->add_scalar("MEMPROF_JEMALLOC_DUMP", Item_result::STRING_RESULT,
-                       (Udf_func_any)udf_impl::memprof_jemalloc_dump_udf,
-                       udf_impl::memprof_jemalloc_dump_udf_init,
-                       udf_impl::memprof_jemalloc_dump_udf_deinit)) {
-    delete list;
-    return 1; /* failure: one of the UDF registrations failed */
-  }
-  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
-                    "new UDF 'memprof_jemalloc_dump()' has been registered successfully.");
+  mysql_service_profiler_pfs->add("memory", "jemalloc", "reset", "", "mutexes");
 
-  if (list->add_scalar("MEMPROF_JEMALLOC_REPORT", Item_result::STRING_RESULT,
-                       (Udf_func_any)udf_impl::jeprof_mem_udf,
-                       udf_impl::jeprof_mem_udf_init,
-                       udf_impl::jeprof_mem_udf_deinit)) {
-    delete list;
-    return 1; /* failure: one of the UDF registrations failed */
-  }
-  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
-                    "new UDF 'memprof_jemalloc_report()' has been registered successfully.");
+  strcpy(outp, "jemalloc mutex statistics reset");
+  *length = strlen(outp);
 
-  register_status_variables();
+  return const_cast<char *>(outp);
+}
+
+// UDF to report which size classes waste the memory of jemalloc
+
+static bool memprof_jemalloc_fragmentation_udf_init(UDF_INIT *initid,
+                                                    UDF_ARGS *args, char *) {
+  if (args->arg_count > 1) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "this function requires none or 1 parameter: <limit>, limit is 0 by default and doesn't limit the output");
+    return true;
+  }
+  if (args->arg_count == 1) args->arg_type[0] = INT_RESULT;
+  const char* name = "utf8mb4";
+  char *value = const_cast<char*>(name);
+  initid->ptr = const_cast<char *>(udf_init);
+  if (mysql_service_mysql_udf_metadata->result_set(
+          initid, "charset",
+          const_cast<char *>(value))) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG, "failed to set result charset");
+    return false;
+  }
+  return false;
+}
+
+static void memprof_jemalloc_fragmentation_udf_deinit(__attribute__((unused))
+                                                       UDF_INIT *initid) {
+  assert(initid->ptr == udf_init || initid->ptr == my_udf);
+}
+
+const char *memprof_jemalloc_fragmentation_udf(UDF_INIT *, UDF_ARGS *args,
+                                               char *outp,
+                                               unsigned long *length,
+                                               char *is_null, char *error) {
+  *error = 0;
+  *is_null = 0;
+
+  MYSQL_THD thd;
+
+  mysql_service_mysql_current_thread_reader->get(&thd);
+  if (!have_required_privilege(thd))
+  {
+    mysql_error_service_printf(
+        ER_SPECIFIC_ACCESS_DENIED_ERROR, 0,
+        PRIVILEGE_NAME);
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  long long limit = 0;
+  if (args->arg_count > 0 && args->args[0] != nullptr)
+    limit = *((long long *)args->args[0]);
+
+  std::string buf;
+  uint64_t wasted = 0;
+  if (!jemalloc_fragmentation_report(limit, &buf, &wasted)) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "Error reading the jemalloc bin statistics, is jemalloc built with --enable-stats?");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  outp = (char *)malloc(buf.length() + 1);
+  if (outp == nullptr) {
+      *error = 1;
+      *is_null = 1;
+      return nullptr;
+  }
+
+  char extra[100];
+  snprintf(extra, sizeof(extra), "fragmentation: %llu bytes wasted in slabs",
+           (unsigned long long)wasted);
+  mysql_service_profiler_pfs->add("memory", "jemalloc", "report", "", extra);
+
+  strcpy(outp, buf.c_str());
+  *length = strlen(outp);
+
+  return const_cast<char *>(outp);
+}
+
+// UDF to return the output of malloc_stats_print() in JSON
+
+static bool memprof_jemalloc_stats_json_udf_init(UDF_INIT *initid,
+                                                 UDF_ARGS *args, char *) {
+  if (args->arg_count > 0) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "this function doesn't require any parameter");
+    return true;
+  }
+  const char* name = "utf8mb4";
+  char *value = const_cast<char*>(name);
+  initid->ptr = const_cast<char *>(udf_init);
+  if (mysql_service_mysql_udf_metadata->result_set(
+          initid, "charset",
+          const_cast<char *>(value))) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG, "failed to set result charset");
+    return false;
+  }
+  return false;
+}
+
+// The result is kept in initid->ptr until the end of the statement, it's
+// several megabytes on a busy server
+static void memprof_jemalloc_stats_json_udf_deinit(UDF_INIT *initid) {
+  if (initid->ptr != udf_init && initid->ptr != my_udf) free(initid->ptr);
+  initid->ptr = nullptr;
+}
+
+const char *memprof_jemalloc_stats_json_udf(UDF_INIT *initid, UDF_ARGS *,
+                                            char *outp, unsigned long *length,
+                                            char *is_null, char *error) {
+  *error = 0;
+  *is_null = 0;
+
+  MYSQL_THD thd;
+
+  mysql_service_mysql_current_thread_reader->get(&thd);
+  if (!have_required_privilege(thd))
+  {
+    mysql_error_service_printf(
+        ER_SPECIFIC_ACCESS_DENIED_ERROR, 0,
+        PRIVILEGE_NAME);
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  std::string buf;
+  if (!capture_jemalloc_stats_json(&buf)) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "jemalloc didn't print any statistics.");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  // Reused by the next row, freed by _deinit
+  char *result = initid->ptr == udf_init || initid->ptr == my_udf
+                     ? nullptr : initid->ptr;
+  outp = (char *)realloc(result, buf.length() + 1);
+  if (outp == nullptr) {
+      *error = 1;
+      *is_null = 1;
+      return nullptr;
+  }
+  initid->ptr = outp;
+
+  char extra[100];
+  snprintf(extra, sizeof(extra), "stats json: %zu bytes", buf.length());
+  mysql_service_profiler_pfs->add("memory", "jemalloc", "report", "", extra);
+
+  strcpy(outp, buf.c_str());
+  *length = strlen(outp);
+
+  return const_cast<char *>(outp);
+}
+
+// Log a change of the jemalloc settings with the resident bytes before and
+// after it, the same text is returned by the UDF
+static const char *jemalloc_change_done(const char *action,
+                                        const std::string& change,
+                                        uint64_t resident_before, char *outp,
+                                        unsigned long *length) {
+  uint64_t resident_after = jemalloc_resident();
+  char extra[255];
+  snprintf(extra, sizeof(extra), "%s, resident: %llu -> %llu bytes",
+           change.c_str(), (unsigned long long)resident_before,
+           (unsigned long long)resident_after);
+  mysql_service_profiler_pfs->add("memory", "jemalloc", action, "", extra);
+
+  strcpy(outp, extra);
+  *length = strlen(outp);
+  return const_cast<char *>(outp);
+}
+
+// Optional arena argument of the UDFs, JEMALLOC_ALL_ARENAS when not given
+static bool get_arena_arg(UDF_ARGS *args, unsigned int position, int *arena) {
+  *arena = JEMALLOC_ALL_ARENAS;
+  if (args->arg_count <= position || args->args[position] == nullptr)
+    return true;
+  long long value = *((long long *)args->args[position]);
+  if (value < 0 || value >= MALLCTL_ARENAS_ALL) return false;
+  *arena = (int)value;
+  return true;
+}
+
+// UDF to change the decay time of the dirty or muzzy pages
+
+static bool memprof_jemalloc_decay_ms_udf_init(UDF_INIT *initid, UDF_ARGS *args, char *) {
+  if (args->arg_count < 2 || args->arg_count > 3) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "this function requires 2 or 3 parameters: <'dirty' or 'muzzy'>, <milliseconds>, <arena>, all the arenas are changed by default");
+    return true;
+  }
+  args->arg_type[0] = STRING_RESULT;
+  args->arg_type[1] = INT_RESULT;
+  if (args->arg_count == 3) args->arg_type[2] = INT_RESULT;
+  const char* name = "utf8mb4";
+  char *value = const_cast<char*>(name);
+  initid->ptr = const_cast<char *>(udf_init);
+  if (mysql_service_mysql_udf_metadata->result_set(
+          initid, "charset",
+          const_cast<char *>(value))) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG, "failed to set result charset");
+    return false;
+  }
+  return false;
+}
+
+static void memprof_jemalloc_decay_ms_udf_deinit(__attribute__((unused))
+                                       UDF_INIT *initid) {
+  assert(initid->ptr == udf_init || initid->ptr == my_udf);
+}
+
+const char *memprof_jemalloc_decay_ms_udf(UDF_INIT *, UDF_ARGS *args,
+                                          char *outp, unsigned long *length,
+                                          char *is_null, char *error) {
+  *error = 0;
+  *is_null = 0;
+
+  MYSQL_THD thd;
+
+  mysql_service_mysql_current_thread_reader->get(&thd);
+  if (!have_required_privilege(thd))
+  {
+    mysql_error_service_printf(
+        ER_SPECIFIC_ACCESS_DENIED_ERROR, 0,
+        PRIVILEGE_NAME);
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  std::string kind = args->args[0] != nullptr
+                         ? std::string(args->args[0], args->lengths[0])
+                         : "";
+  std::transform(kind.begin(), kind.end(), kind.begin(), ::tolower);
+  if (kind != "dirty" && kind != "muzzy") {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "the first parameter must be 'dirty' or 'muzzy'.");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+  int arena;
+  if (args->args[1] == nullptr || !get_arena_arg(args, 2, &arena)) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "wrong number of milliseconds or arena.");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+  ssize_t ms = *((long long *)args->args[1]);
+
+  ssize_t previous = 0;
+  if (!get_jemalloc_decay_ms(kind.c_str(), arena, &previous)) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "Error reading the decay time, is the arena initialized?");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+  uint64_t resident_before = jemalloc_resident();
+  if (!set_jemalloc_decay_ms(kind.c_str(), arena, ms)) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "Error setting the decay time, it must be -1 or a positive number of milliseconds.");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  std::string change = kind + "_decay_ms";
+  if (arena != JEMALLOC_ALL_ARENAS)
+    change = "arena " + std::to_string(arena) + " " + change;
+  change += ": " + std::to_string(previous) + " -> " + std::to_string(ms);
+  return jemalloc_change_done("configured", change, resident_before, outp,
+                              length);
+}
+
+// UDFs to return the dirty pages to the system, all of them or only the
+// ones whose decay time has passed
+
+static bool memprof_jemalloc_purge_udf_init(UDF_INIT *initid, UDF_ARGS *args, char *) {
+  if (args->arg_count > 1) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "this function requires none or 1 parameter: <arena>, all the arenas are purged by default");
+    return true;
+  }
+  if (args->arg_count == 1) args->arg_type[0] = INT_RESULT;
+  const char* name = "utf8mb4";
+  char *value = const_cast<char*>(name);
+  initid->ptr = const_cast<char *>(udf_init);
+  if (mysql_service_mysql_udf_metadata->result_set(
+          initid, "charset",
+          const_cast<char *>(value))) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG, "failed to set result charset");
+    return false;
+  }
+  return false;
+}
+
+static void memprof_jemalloc_purge_udf_deinit(__attribute__((unused))
+                                       UDF_INIT *initid) {
+  assert(initid->ptr == udf_init || initid->ptr == my_udf);
+}
+
+static const char *jemalloc_purge(UDF_ARGS *args, bool decay_only, char *outp,
+                                  unsigned long *length, char *is_null,
+                                  char *error) {
+  *error = 0;
+  *is_null = 0;
+
+  MYSQL_THD thd;
+
+  mysql_service_mysql_current_thread_reader->get(&thd);
+  if (!have_required_privilege(thd))
+  {
+    mysql_error_service_printf(
+        ER_SPECIFIC_ACCESS_DENIED_ERROR, 0,
+        PRIVILEGE_NAME);
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  int arena;
+  if (!get_arena_arg(args, 0, &arena)) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "wrong arena number.");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  uint64_t resident_before = jemalloc_resident();
+  if (!purge_jemalloc_arena(arena, decay_only)) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "Error purging the arena, is it initialized?");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  std::string change = arena == JEMALLOC_ALL_ARENAS
+                           ? std::string("all arenas")
+                           : "arena " + std::to_string(arena);
+  return jemalloc_change_done(decay_only ? "decayed" : "purged", change,
+                              resident_before, outp, length);
+}
+
+const char *memprof_jemalloc_purge_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
+                                       unsigned long *length, char *is_null,
+                                       char *error) {
+  return jemalloc_purge(args, false, outp, length, is_null, error);
+}
+
+const char *memprof_jemalloc_decay_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
+                                       unsigned long *length, char *is_null,
+                                       char *error) {
+  return jemalloc_purge(args, true, outp, length, is_null, error);
+}
+
+// UDF to enable or disable the background threads of jemalloc
+
+static bool memprof_jemalloc_background_thread_udf_init(UDF_INIT *initid, UDF_ARGS *args, char *) {
+  if (args->arg_count != 1) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "this function requires 1 parameter: <1 to enable or 0 to disable>");
+    return true;
+  }
+  args->arg_type[0] = INT_RESULT;
+  const char* name = "utf8mb4";
+  char *value = const_cast<char*>(name);
+  initid->ptr = const_cast<char *>(udf_init);
+  if (mysql_service_mysql_udf_metadata->result_set(
+          initid, "charset",
+          const_cast<char *>(value))) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG, "failed to set result charset");
+    return false;
+  }
+  return false;
+}
+
+static void memprof_jemalloc_background_thread_udf_deinit(__attribute__((unused))
+                                       UDF_INIT *initid) {
+  assert(initid->ptr == udf_init || initid->ptr == my_udf);
+}
+
+const char *memprof_jemalloc_background_thread_udf(UDF_INIT *, UDF_ARGS *args,
+                                                   char *outp,
+                                                   unsigned long *length,
+                                                   char *is_null,
+                                                   char *error) {
+  *error = 0;
+  *is_null = 0;
+
+  MYSQL_THD thd;
+
+  mysql_service_mysql_current_thread_reader->get(&thd);
+  if (!have_required_privilege(thd))
+  {
+    mysql_error_service_printf(
+        ER_SPECIFIC_ACCESS_DENIED_ERROR, 0,
+        PRIVILEGE_NAME);
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  if (args->args[0] == nullptr) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "the parameter must be 1 or 0.");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+  bool enable = *((long long *)args->args[0]) != 0;
+
+  bool previous = false;
+  get_jemalloc_background_thread(&previous);
+  uint64_t resident_before = jemalloc_resident();
+  if (!set_jemalloc_background_thread(enable)) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "Error changing background_thread, this jemalloc may not support it.");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  std::string change = std::string("background_thread: ") +
+                       (previous ? "on" : "off") + " -> " +
+                       (enable ? "on" : "off");
+  return jemalloc_change_done("configured", change, resident_before, outp,
+                              length);
+}
+
+// UDF to start a new profiling window: the samples collected so far are
+// discarded
+
+static bool memprof_jemalloc_reset_udf_init(UDF_INIT *initid, UDF_ARGS *args,
+                                            char *) {
+  if (args->arg_count > 0) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "this function doesn't require any parameter");
+    return true;
+  }
+  const char* name = "utf8mb4";
+  char *value = const_cast<char*>(name);
+  initid->ptr = const_cast<char *>(udf_init);
+  if (mysql_service_mysql_udf_metadata->result_set(
+          initid, "charset",
+          const_cast<char *>(value))) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG, "failed to set result charset");
+    return false;
+  }
+  return false;
+}
+
+static void memprof_jemalloc_reset_udf_deinit(__attribute__((unused))
+                                              UDF_INIT *initid) {
+  assert(initid->ptr == udf_init || initid->ptr == my_udf);
+}
+
+const char *memprof_jemalloc_reset_udf(UDF_INIT *, UDF_ARGS *, char *outp,
+                                       unsigned long *length, char *is_null,
+                                       char *error) {
+  *error = 0;
+  *is_null = 0;
+
+  MYSQL_THD thd;
+
+  mysql_service_mysql_current_thread_reader->get(&thd);
+  if (!have_required_privilege(thd))
+  {
+    mysql_error_service_printf(
+        ER_SPECIFIC_ACCESS_DENIED_ERROR, 0,
+        PRIVILEGE_NAME);
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+  std::lock_guard<std::mutex> guard(memprof_jemalloc_mutex);
+  if (strcmp(memprof_jemalloc_status, "STOPPED") == 0) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "jemalloc memory profiler is not running.");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  if (!reset_jemalloc_prof(jemalloc_lg_prof_sample)) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "Error resetting jemalloc profiling.");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  char extra[100];
+  snprintf(extra, sizeof(extra), "lg_prof_sample: %u", jemalloc_lg_prof_sample);
+  mysql_service_profiler_pfs->add("memory", "jemalloc", "reset", "", extra);
+
+  snprintf(outp, 255, "memory profiling reset, %s", extra);
+  *length = strlen(outp);
+
+  return const_cast<char *>(outp);
+}
+
+} /* namespace udf_impl */
+
+static mysql_service_status_t profiler_jemalloc_memory_service_init() {
+  mysql_service_status_t result = 0;
+
+  log_bi = mysql_service_log_builtins;
+  log_bs = mysql_service_log_builtins_string;
+
+  init_dump_store_client();
+
+  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG, "initializing…");
+
+  list = new udf_list();
+
+  if (list->add_scalar("MEMPROF_JEMALLOC_START", Item_result::STRING_RESULT,
+                       (Udf_func_any)udf_impl::memprof_jemalloc_start_udf,
+                       udf_impl::memprof_jemalloc_start_udf_init,
+                       udf_impl::memprof_jemalloc_start_udf_deinit)) {
+    delete list;
+    return 1; /* failure: one of the UDF registrations failed */
+  }
+  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new UDF 'memprof_jemalloc_start()' has been registered successfully.");
+
+  if (list->add_scalar("MEMPROF_JEMALLOC_STOP", Item_result::STRING_RESULT,
+                       (Udf_func_any)udf_impl::memprof_jemalloc_stop_udf,
+                       udf_impl::memprof_jemalloc_stop_udf_init,
+                       udf_impl::memprof_jemalloc_stop_udf_deinit)) {
+    delete list;
+    return 1; /* failure: one of the UDF registrations failed */
+  }
+  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new UDF 'memprof_jemalloc_stop()' has been registered successfully.");
+
+  if (list->add_scalar("MEMPROF_JEMALLOC_DUMP", Item_result::STRING_RESULT,
+                       (Udf_func_any)udf_impl::memprof_jemalloc_dump_udf,
+                       udf_impl::memprof_jemalloc_dump_udf_init,
+                       udf_impl::memprof_jemalloc_dump_udf_deinit)) {
+    delete list;
+    return 1; /* failure: one of the UDF registrations failed */
+  }
+  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new UDF 'memprof_jemalloc_dump()' has been registered successfully.");
+
+  if (list->add_scalar("MEMPROF_JEMALLOC_REPORT", Item_result::STRING_RESULT,
+                       (Udf_func_any)udf_impl::jeprof_mem_udf,
+                       udf_impl::jeprof_mem_udf_init,
+                       udf_impl::jeprof_mem_udf_deinit)) {
+    delete list;
+    return 1; /* failure: one of the UDF registrations failed */
+  }
+  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new UDF 'memprof_jemalloc_report()' has been registered successfully.");
+
+  if (list->add_scalar("MEMPROF_JEMALLOC_RESET", Item_result::STRING_RESULT,
+                       (Udf_func_any)udf_impl::memprof_jemalloc_reset_udf,
+                       udf_impl::memprof_jemalloc_reset_udf_init,
+                       udf_impl::memprof_jemalloc_reset_udf_deinit)) {
+    delete list;
+    return 1; /* failure: one of the UDF registrations failed */
+  }
+  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new UDF 'memprof_jemalloc_reset()' has been registered successfully.");
+
+  if (list->add_scalar("MEMPROF_JEMALLOC_MUTEX_RESET", Item_result::STRING_RESULT,
+                       (Udf_func_any)udf_impl::memprof_jemalloc_mutex_reset_udf,
+                       udf_impl::memprof_jemalloc_mutex_reset_udf_init,
+                       udf_impl::memprof_jemalloc_mutex_reset_udf_deinit)) {
+    delete list;
+    return 1; /* failure: one of the UDF registrations failed */
+  }
+  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new UDF 'memprof_jemalloc_mutex_reset()' has been registered successfully.");
+
+  if (list->add_scalar("MEMPROF_JEMALLOC_FRAGMENTATION", Item_result::STRING_RESULT,
+                       (Udf_func_any)udf_impl::memprof_jemalloc_fragmentation_udf,
+                       udf_impl::memprof_jemalloc_fragmentation_udf_init,
+                       udf_impl::memprof_jemalloc_fragmentation_udf_deinit)) {
+    delete list;
+    return 1; /* failure: one of the UDF registrations failed */
+  }
+  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new UDF 'memprof_jemalloc_fragmentation()' has been registered successfully.");
+
+  if (list->add_scalar("MEMPROF_JEMALLOC_STATS_JSON", Item_result::STRING_RESULT,
+                       (Udf_func_any)udf_impl::memprof_jemalloc_stats_json_udf,
+                       udf_impl::memprof_jemalloc_stats_json_udf_init,
+                       udf_impl::memprof_jemalloc_stats_json_udf_deinit)) {
+    delete list;
+    return 1; /* failure: one of the UDF registrations failed */
+  }
+  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new UDF 'memprof_jemalloc_stats_json()' has been registered successfully.");
+
+  if (list->add_scalar("MEMPROF_JEMALLOC_DECAY_MS", Item_result::STRING_RESULT,
+                       (Udf_func_any)udf_impl::memprof_jemalloc_decay_ms_udf,
+                       udf_impl::memprof_jemalloc_decay_ms_udf_init,
+                       udf_impl::memprof_jemalloc_decay_ms_udf_deinit)) {
+    delete list;
+    return 1; /* failure: one of the UDF registrations failed */
+  }
+  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new UDF 'memprof_jemalloc_decay_ms()' has been registered successfully.");
+
+  if (list->add_scalar("MEMPROF_JEMALLOC_PURGE", Item_result::STRING_RESULT,
+                       (Udf_func_any)udf_impl::memprof_jemalloc_purge_udf,
+                       udf_impl::memprof_jemalloc_purge_udf_init,
+                       udf_impl::memprof_jemalloc_purge_udf_deinit)) {
+    delete list;
+    return 1; /* failure: one of the UDF registrations failed */
+  }
+  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new UDF 'memprof_jemalloc_purge()' has been registered successfully.");
+
+  if (list->add_scalar("MEMPROF_JEMALLOC_DECAY", Item_result::STRING_RESULT,
+                       (Udf_func_any)udf_impl::memprof_jemalloc_decay_udf,
+                       udf_impl::memprof_jemalloc_purge_udf_init,
+                       udf_impl::memprof_jemalloc_purge_udf_deinit)) {
+    delete list;
+    return 1; /* failure: one of the UDF registrations failed */
+  }
+  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new UDF 'memprof_jemalloc_decay()' has been registered successfully.");
+
+  if (list->add_scalar("MEMPROF_JEMALLOC_BACKGROUND_THREAD", Item_result::STRING_RESULT,
+                       (Udf_func_any)udf_impl::memprof_jemalloc_background_thread_udf,
+                       udf_impl::memprof_jemalloc_background_thread_udf_init,
+                       udf_impl::memprof_jemalloc_background_thread_udf_deinit)) {
+    delete list;
+    return 1; /* failure: one of the UDF registrations failed */
+  }
+  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new UDF 'memprof_jemalloc_background_thread()' has been registered successfully.");
+
+  register_status_variables();
 
   STR_CHECK_ARG(str1) jeprof_path_arg;
   jeprof_path_arg.def_val = const_cast<char*>(DEFAULT_JEPROF_PATH);
@@ -657,6 +1778,186 @@ static mysql_service_status_t profiler_jemalloc_memory_service_init() {
                     "new variable 'profiler.jeprof_binary' has been registered successfully.");
   } 
 
+  INTEGRAL_CHECK_ARG(uint) memory_timeline_interval_arg;
+  memory_timeline_interval_arg.def_val = DEFAULT_MEMORY_TIMELINE_INTERVAL;
+  memory_timeline_interval_arg.min_val = 0;
+  memory_timeline_interval_arg.max_val = 86400;
+  memory_timeline_interval_arg.blk_sz = 0;
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "memory_timeline_interval",
+          PLUGIN_VAR_INT | PLUGIN_VAR_UNSIGNED | PLUGIN_VAR_RQCMDARG,
+          "Seconds between two samples of profiler_memory_timeline, 0 to stop sampling",
+          memory_timeline_interval_check, memory_timeline_interval_update,
+          (void *)&memory_timeline_interval_arg, (void *)&memory_timeline_interval)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.memory_timeline_interval'.");
+    result = 1;
+  } else {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.memory_timeline_interval' has been registered successfully.");
+  }
+
+  INTEGRAL_CHECK_ARG(ulonglong) memory_dump_threshold_bytes_arg;
+  memory_dump_threshold_bytes_arg.def_val = 0;
+  memory_dump_threshold_bytes_arg.min_val = 0;
+  memory_dump_threshold_bytes_arg.max_val = ULLONG_MAX;
+  memory_dump_threshold_bytes_arg.blk_sz = 0;
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "memory_dump_threshold_bytes",
+          PLUGIN_VAR_LONGLONG | PLUGIN_VAR_UNSIGNED | PLUGIN_VAR_RQCMDARG,
+          "Memory usage triggering a heap dump and a report in the error log, 0 disables it",
+          memory_dump_threshold_bytes_check, memory_dump_threshold_bytes_update,
+          (void *)&memory_dump_threshold_bytes_arg,
+          (void *)&memory_dump_threshold_bytes)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.memory_dump_threshold_bytes'.");
+    result = 1;
+  } else {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.memory_dump_threshold_bytes' has been registered successfully.");
+  }
+
+  STR_CHECK_ARG(str) memory_dump_threshold_source_arg;
+  memory_dump_threshold_source_arg.def_val = const_cast<char*>(MEMORY_DUMP_SOURCE_RSS);
+  memory_dump_threshold_source_value = nullptr;
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "memory_dump_threshold_source",
+          PLUGIN_VAR_STR | PLUGIN_VAR_RQCMDARG | PLUGIN_VAR_MEMALLOC,
+          "Value compared to profiler.memory_dump_threshold_bytes: RSS of mysqld or ALLOCATED by jemalloc",
+          memory_dump_threshold_source_check, memory_dump_threshold_source_update,
+          (void *)&memory_dump_threshold_source_arg,
+          (void *)&memory_dump_threshold_source_value)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.memory_dump_threshold_source'.");
+    result = 1;
+  } else {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.memory_dump_threshold_source' has been registered successfully.");
+  }
+
+  // The default is the sampling jemalloc was started with
+  size_t lg_prof_sample = DEFAULT_JEMALLOC_LG_PROF_SAMPLE;
+  get_jemalloc_lg_prof_sample(&lg_prof_sample);
+  INTEGRAL_CHECK_ARG(uint) jemalloc_lg_prof_sample_arg;
+  jemalloc_lg_prof_sample_arg.def_val = lg_prof_sample;
+  jemalloc_lg_prof_sample_arg.min_val = 0;
+  jemalloc_lg_prof_sample_arg.max_val = 62;
+  jemalloc_lg_prof_sample_arg.blk_sz = 0;
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "jemalloc_lg_prof_sample",
+          PLUGIN_VAR_INT | PLUGIN_VAR_UNSIGNED | PLUGIN_VAR_RQCMDARG,
+          "Average bytes between two allocations sampled by jemalloc as a power of 2, applied when profiling starts",
+          jemalloc_lg_prof_sample_check, jemalloc_lg_prof_sample_update,
+          (void *)&jemalloc_lg_prof_sample_arg, (void *)&jemalloc_lg_prof_sample)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.jemalloc_lg_prof_sample'.");
+    result = 1;
+  } else {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.jemalloc_lg_prof_sample' has been registered successfully.");
+  }
+
+  INTEGRAL_CHECK_ARG(ulonglong) jemalloc_dump_interval_bytes_arg;
+  jemalloc_dump_interval_bytes_arg.def_val = 0;
+  jemalloc_dump_interval_bytes_arg.min_val = 0;
+  jemalloc_dump_interval_bytes_arg.max_val = LLONG_MAX;
+  jemalloc_dump_interval_bytes_arg.blk_sz = 0;
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "jemalloc_dump_interval_bytes",
+          PLUGIN_VAR_LONGLONG | PLUGIN_VAR_UNSIGNED | PLUGIN_VAR_RQCMDARG,
+          "Write a heap dump each time mysqld allocated this many bytes, freed or not, 0 disables it",
+          jemalloc_dump_interval_bytes_check, jemalloc_dump_interval_bytes_update,
+          (void *)&jemalloc_dump_interval_bytes_arg,
+          (void *)&jemalloc_dump_interval_bytes)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.jemalloc_dump_interval_bytes'.");
+    result = 1;
+  } else {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.jemalloc_dump_interval_bytes' has been registered successfully.");
+  }
+
+  BOOL_CHECK_ARG(bool) jemalloc_gdump_arg;
+  jemalloc_gdump_arg.def_val = false;
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "jemalloc_gdump",
+          PLUGIN_VAR_BOOL | PLUGIN_VAR_RQCMDARG,
+          "Write a heap dump each time the memory used reaches a new maximum while profiling",
+          jemalloc_gdump_check, jemalloc_gdump_update,
+          (void *)&jemalloc_gdump_arg, (void *)&jemalloc_gdump)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.jemalloc_gdump'.");
+    result = 1;
+  } else {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.jemalloc_gdump' has been registered successfully.");
+  }
+
+  // The default is the limit jemalloc was started with (prof_recent_alloc_max)
+  long long recent_alloc_max = 0;
+  get_jemalloc_recent_alloc_max(&recent_alloc_max);
+  INTEGRAL_CHECK_ARG(uint) jemalloc_recent_allocs_arg;
+  jemalloc_recent_allocs_arg.def_val =
+      recent_alloc_max < 0 ? 100000 : std::min(recent_alloc_max, 100000LL);
+  jemalloc_recent_allocs_arg.min_val = 0;
+  jemalloc_recent_allocs_arg.max_val = 100000;
+  jemalloc_recent_allocs_arg.blk_sz = 0;
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "jemalloc_recent_allocs",
+          PLUGIN_VAR_INT | PLUGIN_VAR_UNSIGNED | PLUGIN_VAR_RQCMDARG,
+          "Number of sampled allocations kept for profiler_jemalloc_recent_allocs, 0 disables the records",
+          jemalloc_recent_allocs_check, jemalloc_recent_allocs_update,
+          (void *)&jemalloc_recent_allocs_arg, (void *)&jemalloc_recent_allocs)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.jemalloc_recent_allocs'.");
+    result = 1;
+  } else {
+    if ((long long)jemalloc_recent_allocs != recent_alloc_max)
+      set_jemalloc_recent_alloc_max(jemalloc_recent_allocs);
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.jemalloc_recent_allocs' has been registered successfully.");
+  }
+
+  // opt.prof is read-only, profiling must be enabled in MALLOC_CONF
+  jemalloc_prof_available = jemalloc_prof_enabled();
+  if (!jemalloc_prof_available)
+    LogComponentErr(WARNING_LEVEL, ER_LOG_PRINTF_MSG,
+                    "jemalloc profiling is not enabled, memprof_jemalloc_start() requires MALLOC_CONF=prof:true,prof_active:false");
+
+  init_memory_timeline("jemalloc", jemalloc_totals);
+  init_jemalloc_autodump(write_interval_dump, import_jemalloc_dump);
+  init_memory_watchdog(jemalloc_totals, write_threshold_dump);
+  init_profile_scheduler(PROFILE_SCHEDULE_MEMORY, read_profile_schedule,
+                         start_scheduled_heap_profile,
+                         dump_scheduled_heap_profile,
+                         stop_scheduled_heap_profile);
+
+  jemalloc_share_list[0] = init_snapshot_share<&memory_timeline_table>();
+  jemalloc_share_list[1] = init_snapshot_share<&jemalloc_stats_table>();
+  jemalloc_share_list[2] = init_snapshot_share<&jemalloc_arenas_table>();
+  jemalloc_share_list[3] = init_snapshot_share<&jemalloc_mutexes_table>();
+  jemalloc_share_list[4] =
+      init_snapshot_share<&jemalloc_recent_allocs_table>();
+  jemalloc_share_list[5] = init_snapshot_share<&connection_allocs_table>();
+  jemalloc_share_list[6] = init_snapshot_share<&jemalloc_bins_table>();
+  jemalloc_share_list[7] = init_snapshot_share<&jemalloc_stats_json_table>();
+  if (mysql_service_pfs_plugin_table_v1->add_tables(&jemalloc_share_list[0],
+                                                    jemalloc_share_list_count)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "PFS tables have NOT been registered successfully!");
+    result = 1;
+  } else {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "PFS tables have been registered successfully.");
+  }
+
   return result;
 }
 
@@ -667,6 +1968,22 @@ static mysql_service_status_t profiler_jemalloc_memory_service_deinit() {
 
   delete list;
 
+  // Before the autodump thread, a run in progress stops it
+  deinit_profile_scheduler();
+  deinit_memory_timeline();
+  deinit_memory_watchdog();
+  deinit_jemalloc_autodump();
+
+  if (mysql_service_pfs_plugin_table_v1->delete_tables(&jemalloc_share_list[0],
+                                                       jemalloc_share_list_count)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "Error while trying to remove PFS tables");
+  } else {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "PFS tables have been removed successfully.");
+  }
+  clear_connections();
+
   unregister_status_variables();
   if (mysql_service_component_sys_variable_unregister->unregister_variable(
               "profiler", "jeprof_binary")) {
@@ -679,12 +1996,66 @@ static mysql_service_status_t profiler_jemalloc_memory_service_deinit() {
 
   jeprof_path_value = nullptr;
 
+  for (const char *variable :
+       {"memory_timeline_interval", "memory_dump_threshold_bytes",
+        "memory_dump_threshold_source", "jemalloc_lg_prof_sample",
+        "jemalloc_dump_interval_bytes", "jemalloc_gdump",
+        "jemalloc_recent_allocs"}) {
+    if (mysql_service_component_sys_variable_unregister->unregister_variable(
+                "profiler", variable)) {
+      LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                (std::string("could not unregister variable 'profiler.") + variable + "'.").c_str());
+    } else {
+      LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                (std::string("variable 'profiler.") + variable + "' is now unregistered successfully.").c_str());
+    }
+  }
+  memory_dump_threshold_source_value = nullptr;
+
+  deinit_dump_store_client();
+
   LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG, "uninstalled.");
 
   return result;
 }
 
+#if MYSQL_VERSION_ID >= 80100
+static std::string event_string(const mysql_cstring_with_length& value) {
+  return value.str != nullptr ? std::string(value.str, value.length) : "";
+}
+
+/* The connection events are sent from the thread of the connection, this is
+   where profiler_connection_allocs finds the jemalloc counters */
+static DEFINE_BOOL_METHOD(connection_notify,
+                          (const mysql_event_tracking_connection_data *data)) {
+  if (data->status != 0) return false;
+  std::string host = event_string(data->host);
+  if (host.empty()) host = event_string(data->ip);
+  switch (data->event_subclass) {
+    case EVENT_TRACKING_CONNECTION_CONNECT:
+      track_connection(data->connection_id, event_string(data->user), host);
+      break;
+    case EVENT_TRACKING_CONNECTION_CHANGE_USER:
+      rename_connection(data->connection_id, event_string(data->user), host);
+      break;
+    case EVENT_TRACKING_CONNECTION_DISCONNECT:
+      untrack_connection(data->connection_id);
+      break;
+    default:
+      break;
+  }
+  return false;
+}
+
+BEGIN_SERVICE_IMPLEMENTATION(profiler_jemalloc_memory_service,
+                             event_tracking_connection)
+connection_notify, END_SERVICE_IMPLEMENTATION();
+#endif
+
 BEGIN_COMPONENT_PROVIDES(profiler_jemalloc_memory_service)
+#if MYSQL_VERSION_ID >= 80100
+  PROVIDES_SERVICE(profiler_jemalloc_memory_service, event_tracking_connection),
+#endif
 END_COMPONENT_PROVIDES();
 
 BEGIN_COMPONENT_REQUIRES(profiler_jemalloc_memory_service)
@@ -705,6 +2076,11 @@ BEGIN_COMPONENT_REQUIRES(profiler_jemalloc_memory_service)
 #endif
     REQUIRES_SERVICE(profiler_var),
     REQUIRES_SERVICE(profiler_pfs),
+    REQUIRES_SERVICE(profiler_dump_store),
+    REQUIRES_SERVICE(pfs_plugin_table_v1),
+    REQUIRES_SERVICE_AS(pfs_plugin_column_string_v2, pfs_string),
+    REQUIRES_SERVICE_AS(pfs_plugin_column_bigint_v1, pfs_bigint),
+    REQUIRES_SERVICE_AS(pfs_plugin_column_timestamp_v2, pfs_timestamp),
 END_COMPONENT_REQUIRES();
 
 /* A list of metadata to describe the Component. */
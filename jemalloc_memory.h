@@ -25,3 +25,6 @@
 #include "common.h"
 #include <jemalloc/jemalloc.h>
 #include "profiler_service.h"
+#include "pprof_proto.h"
+#include "dump_io.h"
+#include "dump_store_client.h"
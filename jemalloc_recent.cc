@@ -0,0 +1,158 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#include "jemalloc_recent.h"
+#include "symbolizer.h"
+
+#include <jemalloc/jemalloc.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "my_rapidjson_size_t.h"
+#include <rapidjson/document.h>
+
+namespace {
+
+// Argument of experimental.prof_recent.alloc_dump
+struct Dump_callback {
+  void (*write_cb)(void *, const char *);
+  void *cbopaque;
+};
+
+void append_output(void *opaque, const char *text) {
+  static_cast<std::string *>(opaque)->append(text);
+}
+
+// The times of the records come from the clock of jemalloc, monotonic
+// unless prof_time_res:high is set. Returns the offset to add to get the
+// real time.
+long long clock_offset_ns(uint64_t sample_ns) {
+  struct timespec realtime, monotonic;
+  clock_gettime(CLOCK_REALTIME, &realtime);
+  clock_gettime(CLOCK_MONOTONIC, &monotonic);
+  long long real_ns = realtime.tv_sec * 1000000000LL + realtime.tv_nsec;
+  long long mono_ns = monotonic.tv_sec * 1000000000LL + monotonic.tv_nsec;
+  // Already a real time (less than a year away from now)
+  if (llabs(real_ns - (long long)sample_ns) < 365LL * 86400 * 1000000000LL)
+    return 0;
+  return real_ns - mono_ns;
+}
+
+uint64_t json_uint(const rapidjson::Value& object, const char *name) {
+  if (!object.HasMember(name) || !object[name].IsUint64()) return 0;
+  return object[name].GetUint64();
+}
+
+void fill_jemalloc_recent_allocs(std::vector<Snapshot_row> *rows) {
+  std::string output;
+  Dump_callback callback = {append_output, &output};
+  if (mallctl("experimental.prof_recent.alloc_dump", nullptr, nullptr,
+              &callback, sizeof(callback)) != 0)
+    return;
+
+  rapidjson::Document doc;
+  doc.Parse(output.c_str());
+  if (doc.HasParseError() || !doc.IsObject() ||
+      !doc.HasMember("recent_alloc") || !doc["recent_alloc"].IsArray())
+    return;
+
+  std::vector<Mapped_region> regions;
+  read_self_mappings(&regions);
+  bool offset_known = false;
+  long long offset = 0;
+
+  for (const rapidjson::Value& record : doc["recent_alloc"].GetArray()) {
+    if (!record.IsObject()) continue;
+    uint64_t alloc_time = json_uint(record, "alloc_time");
+    if (!offset_known) {
+      offset = clock_offset_ns(alloc_time);
+      offset_known = true;
+    }
+
+    std::string top_frame, stack;
+    if (record.HasMember("alloc_trace") && record["alloc_trace"].IsArray()) {
+      bool in_allocator = true;
+      for (const rapidjson::Value& frame : record["alloc_trace"].GetArray()) {
+        if (!frame.IsString()) continue;
+        uint64_t pc = strtoull(frame.GetString(), nullptr, 16);
+        std::string function, filename;
+        if (!symbolize_address(regions, pc > 0 ? pc - 1 : 0, &function,
+                               &filename))
+          function = symbolize(regions, pc);
+        if (in_allocator && is_allocator_frame(filename, function)) continue;
+        if (in_allocator) top_frame = function;
+        in_allocator = false;
+        if (!stack.empty()) stack += "; ";
+        stack += function;
+      }
+    }
+    if (stack.size() > 1024) stack.resize(1024);
+
+    bool released = record.HasMember("released") &&
+                    record["released"].IsBool() &&
+                    record["released"].GetBool();
+    uint64_t dalloc_time = json_uint(record, "dalloc_time");
+    Snapshot_value lifetime = Snapshot_value::null();
+    if (released && dalloc_time >= alloc_time && alloc_time > 0)
+      lifetime = Snapshot_value::unsigned_number((dalloc_time - alloc_time) /
+                                                 1000);
+
+    rows->push_back(
+        {Snapshot_value::timestamp((alloc_time + offset) / 1000),
+         Snapshot_value::unsigned_number(json_uint(record, "size")),
+         Snapshot_value::unsigned_number(json_uint(record, "usize")),
+         Snapshot_value::string(released ? "YES" : "NO"), lifetime,
+         Snapshot_value::unsigned_number(
+             json_uint(record, "alloc_thread_uid")),
+         Snapshot_value::string(top_frame), Snapshot_value::string(stack)});
+  }
+}
+
+}  // namespace
+
+bool get_jemalloc_recent_alloc_max(long long *max) {
+  ssize_t value = 0;
+  size_t length = sizeof(value);
+  if (mallctl("experimental.prof_recent.alloc_max", &value, &length, nullptr,
+              0) != 0)
+    return false;
+  *max = value;
+  return true;
+}
+
+bool set_jemalloc_recent_alloc_max(long long max) {
+  ssize_t value = max;
+  return mallctl("experimental.prof_recent.alloc_max", nullptr, nullptr,
+                 &value, sizeof(value)) == 0;
+}
+
+Snapshot_table jemalloc_recent_allocs_table = {
+    "profiler_jemalloc_recent_allocs",
+    "`ALLOC_TIME` timestamp(6), `SIZE` BIGINT unsigned, "
+    "`USIZE` BIGINT unsigned, `RELEASED` VARCHAR(3), "
+    "`LIFETIME` BIGINT unsigned, `THREAD_UID` BIGINT unsigned, "
+    "`TOP_FRAME` VARCHAR(255), `STACK` VARCHAR(1024)",
+    fill_jemalloc_recent_allocs, 100, {}};
@@ -0,0 +1,38 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#ifndef PROFILER_JEMALLOC_RECENT_H
+#define PROFILER_JEMALLOC_RECENT_H
+
+#include "snapshot_table.h"
+
+// Number of sampled allocations kept by jemalloc 5.3
+// (experimental.prof_recent.alloc_max), 0 disables the records. Return
+// false when this jemalloc doesn't support them.
+extern bool get_jemalloc_recent_alloc_max(long long *max);
+extern bool set_jemalloc_recent_alloc_max(long long max);
+
+// performance_schema.profiler_jemalloc_recent_allocs: the last sampled
+// allocations (experimental.prof_recent.alloc_dump), symbolized
+extern Snapshot_table jemalloc_recent_allocs_table;
+
+#endif /* PROFILER_JEMALLOC_RECENT_H */
@@ -0,0 +1,335 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#include "jemalloc_stats.h"
+
+#include <jemalloc/jemalloc.h>
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+namespace {
+
+// Protects the MIB cache and the refresh time
+std::mutex jemalloc_stats_mutex;
+std::chrono::steady_clock::time_point last_refresh;
+bool refreshed = false;
+
+Jemalloc_mib epoch_mib("epoch");
+
+Jemalloc_mib allocated_mib("stats.allocated");
+Jemalloc_mib active_mib("stats.active");
+Jemalloc_mib metadata_mib("stats.metadata");
+Jemalloc_mib resident_mib("stats.resident");
+Jemalloc_mib mapped_mib("stats.mapped");
+Jemalloc_mib retained_mib("stats.retained");
+
+Jemalloc_mib narenas_mib("arenas.narenas");
+Jemalloc_mib page_mib("arenas.page");
+Jemalloc_mib arena_nthreads_mib("stats.arenas.0.nthreads");
+Jemalloc_mib arena_pdirty_mib("stats.arenas.0.pdirty");
+Jemalloc_mib arena_pmuzzy_mib("stats.arenas.0.pmuzzy");
+Jemalloc_mib arena_small_allocated_mib("stats.arenas.0.small.allocated");
+Jemalloc_mib arena_small_nmalloc_mib("stats.arenas.0.small.nmalloc");
+Jemalloc_mib arena_small_ndalloc_mib("stats.arenas.0.small.ndalloc");
+Jemalloc_mib arena_large_allocated_mib("stats.arenas.0.large.allocated");
+Jemalloc_mib arena_large_nmalloc_mib("stats.arenas.0.large.nmalloc");
+Jemalloc_mib arena_large_ndalloc_mib("stats.arenas.0.large.ndalloc");
+
+// Position of the arena index in the stats.arenas.<i>.* names
+const int ARENA_INDEX = 2;
+
+// Allocation requests of each size class merged over all the arenas, the
+// class index is the 5th component of the stats names and the 3rd of the
+// arenas.bin / arenas.lextent names
+const std::string ALL_ARENAS =
+    "stats.arenas." + std::to_string(MALLCTL_ARENAS_ALL);
+const int CLASS_INDEX = 4;
+const int SIZE_INDEX = 2;
+Jemalloc_mib nbins_mib("arenas.nbins");
+Jemalloc_mib bin_size_mib("arenas.bin.0.size");
+Jemalloc_mib bin_nrequests_mib(ALL_ARENAS + ".bins.0.nrequests");
+Jemalloc_mib nlextents_mib("arenas.nlextents");
+Jemalloc_mib lextent_size_mib("arenas.lextent.0.size");
+Jemalloc_mib lextent_nrequests_mib(ALL_ARENAS + ".lextents.0.nrequests");
+
+// Mutexes of jemalloc 5.x, the ones unknown by the version in use are
+// skipped
+const char *const GLOBAL_MUTEXES[] = {
+    "background_thread", "max_per_bg_thd",   "ctl",
+    "prof",              "prof_thds_data",   "prof_dump",
+    "prof_recent_alloc", "prof_recent_dump", "prof_stats"};
+const char *const ARENA_MUTEXES[] = {
+    "large",         "extent_avail",     "extents_dirty",
+    "extents_muzzy", "extents_retained", "decay_dirty",
+    "decay_muzzy",   "base",             "tcache_list",
+    "hpa_shard",     "hpa_shard_grow",   "hpa_sec"};
+// max_num_thds is a 32 bits counter, the others are 64 bits
+const char *const MUTEX_COUNTERS[] = {
+    "num_ops",         "num_wait",      "num_spin_acq", "num_owner_switch",
+    "total_wait_time", "max_wait_time", "max_num_thds"};
+const size_t MUTEX_COUNTER_COUNT =
+    sizeof(MUTEX_COUNTERS) / sizeof(MUTEX_COUNTERS[0]);
+
+// One MIB per mutex and counter, built on the first read
+std::once_flag mutex_mibs_once;
+std::vector<Jemalloc_mib> global_mutex_mibs;
+std::vector<Jemalloc_mib> arena_mutex_mibs;
+
+// Copy the MIB of a name, resolving it the first time
+bool resolve_mib(Jemalloc_mib *mib, size_t *path, size_t *length) {
+  std::lock_guard<std::mutex> guard(jemalloc_stats_mutex);
+  if (mib->missing) return false;
+  if (mib->length == 0) {
+    size_t resolved = sizeof(mib->mib) / sizeof(mib->mib[0]);
+    if (mallctlnametomib(mib->name.c_str(), mib->mib, &resolved) != 0) {
+      mib->missing = true;
+      return false;
+    }
+    mib->length = resolved;
+  }
+  *length = mib->length;
+  std::copy(mib->mib, mib->mib + mib->length, path);
+  return true;
+}
+
+Snapshot_value size_value(Jemalloc_mib *mib, int index_position = -1,
+                          size_t index = 0) {
+  size_t value = 0;
+  if (!jemalloc_read(mib, &value, index_position, index))
+    return Snapshot_value::null();
+  return Snapshot_value::unsigned_number(value);
+}
+
+Snapshot_value counter_value(Jemalloc_mib *mib, size_t arena) {
+  uint64_t value = 0;
+  if (!jemalloc_read(mib, &value, ARENA_INDEX, arena))
+    return Snapshot_value::null();
+  return Snapshot_value::unsigned_number(value);
+}
+
+void fill_jemalloc_stats(std::vector<Snapshot_row> *rows) {
+  refresh_jemalloc_stats();
+  rows->push_back({size_value(&allocated_mib), size_value(&active_mib),
+                   size_value(&metadata_mib), size_value(&resident_mib),
+                   size_value(&mapped_mib), size_value(&retained_mib)});
+}
+
+void build_mutex_mibs() {
+  for (const char *mutex : GLOBAL_MUTEXES)
+    for (const char *counter : MUTEX_COUNTERS)
+      global_mutex_mibs.emplace_back(std::string("stats.mutexes.") + mutex +
+                                     "." + counter);
+  for (const char *mutex : ARENA_MUTEXES)
+    for (const char *counter : MUTEX_COUNTERS)
+      arena_mutex_mibs.emplace_back(std::string("stats.arenas.0.mutexes.") +
+                                    mutex + "." + counter);
+}
+
+// Counters of one mutex, skipped if this jemalloc doesn't have it
+void add_mutex_row(std::vector<Snapshot_row> *rows, Snapshot_value arena,
+                   const char *mutex, Jemalloc_mib *mibs, int index_position,
+                   size_t index) {
+  Snapshot_row row = {arena, Snapshot_value::string(mutex)};
+  for (size_t i = 0; i < MUTEX_COUNTER_COUNT; i++) {
+    bool found;
+    if (i == MUTEX_COUNTER_COUNT - 1) {
+      uint32_t value = 0;
+      found = jemalloc_read(&mibs[i], &value, index_position, index);
+      row.push_back(Snapshot_value::unsigned_number(value));
+    } else {
+      uint64_t value = 0;
+      found = jemalloc_read(&mibs[i], &value, index_position, index);
+      row.push_back(Snapshot_value::unsigned_number(value));
+    }
+    if (!found) {
+      // num_ops is always there
+      if (i == 0) return;
+      row.back() = Snapshot_value::null();
+    }
+  }
+  rows->push_back(row);
+}
+
+void fill_jemalloc_mutexes(std::vector<Snapshot_row> *rows) {
+  std::call_once(mutex_mibs_once, build_mutex_mibs);
+  refresh_jemalloc_stats();
+
+  for (size_t i = 0; i < sizeof(GLOBAL_MUTEXES) / sizeof(GLOBAL_MUTEXES[0]);
+       i++)
+    add_mutex_row(rows, Snapshot_value::null(), GLOBAL_MUTEXES[i],
+                  &global_mutex_mibs[i * MUTEX_COUNTER_COUNT], -1, 0);
+
+  unsigned int narenas = 0;
+  if (!jemalloc_read(&narenas_mib, &narenas)) return;
+  for (unsigned int arena = 0; arena < narenas; arena++) {
+    unsigned int nthreads = 0;
+    if (!jemalloc_read(&arena_nthreads_mib, &nthreads, ARENA_INDEX, arena))
+      continue;
+    for (size_t i = 0; i < sizeof(ARENA_MUTEXES) / sizeof(ARENA_MUTEXES[0]);
+         i++)
+      add_mutex_row(rows, Snapshot_value::unsigned_number(arena),
+                    ARENA_MUTEXES[i],
+                    &arena_mutex_mibs[i * MUTEX_COUNTER_COUNT], ARENA_INDEX,
+                    arena);
+  }
+}
+
+void fill_jemalloc_arenas(std::vector<Snapshot_row> *rows) {
+  refresh_jemalloc_stats();
+  unsigned int narenas = 0;
+  if (!jemalloc_read(&narenas_mib, &narenas)) return;
+  size_t page = 0;
+  jemalloc_read(&page_mib, &page);
+
+  for (unsigned int arena = 0; arena < narenas; arena++) {
+    // Arenas not initialized yet can't be read
+    unsigned int nthreads = 0;
+    if (!jemalloc_read(&arena_nthreads_mib, &nthreads, ARENA_INDEX, arena))
+      continue;
+    rows->push_back({Snapshot_value::unsigned_number(arena),
+                     Snapshot_value::unsigned_number(nthreads),
+                     size_value(&arena_pdirty_mib, ARENA_INDEX, arena),
+                     size_value(&arena_pmuzzy_mib, ARENA_INDEX, arena),
+                     size_value(&arena_small_allocated_mib, ARENA_INDEX, arena),
+                     counter_value(&arena_small_nmalloc_mib, arena),
+                     counter_value(&arena_small_ndalloc_mib, arena),
+                     size_value(&arena_large_allocated_mib, ARENA_INDEX, arena),
+                     counter_value(&arena_large_nmalloc_mib, arena),
+                     counter_value(&arena_large_ndalloc_mib, arena),
+                     Snapshot_value::unsigned_number(page)});
+  }
+}
+
+}  // namespace
+
+bool jemalloc_read(Jemalloc_mib *mib, void *value, size_t size,
+                   int index_position, size_t index) {
+  size_t path[8];
+  size_t length = 0;
+  if (!resolve_mib(mib, path, &length)) return false;
+  if (index_position >= 0) {
+    if ((size_t)index_position >= length) return false;
+    path[index_position] = index;
+  }
+  size_t value_size = size;
+  return mallctlbymib(path, length, value, &value_size, nullptr, 0) == 0 &&
+         value_size == size;
+}
+
+void refresh_jemalloc_stats(bool force) {
+  auto now = std::chrono::steady_clock::now();
+  {
+    std::lock_guard<std::mutex> guard(jemalloc_stats_mutex);
+    if (!force && refreshed && now - last_refresh <
+                         std::chrono::milliseconds(JEMALLOC_STATS_REFRESH_MS))
+      return;
+    refreshed = true;
+    last_refresh = now;
+  }
+  size_t path[8];
+  size_t length = 0;
+  if (!resolve_mib(&epoch_mib, path, &length)) return;
+  uint64_t epoch = 1;
+  size_t epoch_length = sizeof(epoch);
+  mallctlbymib(path, length, &epoch, &epoch_length, &epoch, epoch_length);
+}
+
+bool reset_jemalloc_mutex_stats() {
+  if (mallctl("stats.mutexes.reset", nullptr, nullptr, nullptr, 0) != 0)
+    return false;
+  // The next read must see the reset counters
+  std::lock_guard<std::mutex> guard(jemalloc_stats_mutex);
+  refreshed = false;
+  return true;
+}
+
+uint64_t jemalloc_resident() {
+  refresh_jemalloc_stats(true);
+  size_t value = 0;
+  jemalloc_read(&resident_mib, &value);
+  return value;
+}
+
+bool jemalloc_totals(uint64_t *allocated, uint64_t *heap_size) {
+  refresh_jemalloc_stats();
+  size_t value = 0;
+  if (!jemalloc_read(&allocated_mib, &value)) return false;
+  *allocated = value;
+  if (!jemalloc_read(&mapped_mib, &value)) return false;
+  *heap_size = value;
+  return true;
+}
+
+bool jemalloc_requested_bytes(uint64_t *requested) {
+  refresh_jemalloc_stats();
+  uint64_t total = 0;
+  unsigned int nbins = 0;
+  if (!jemalloc_read(&nbins_mib, &nbins)) return false;
+  for (unsigned int i = 0; i < nbins; i++) {
+    size_t size = 0;
+    uint64_t nrequests = 0;
+    if (!jemalloc_read(&bin_size_mib, &size, SIZE_INDEX, i) ||
+        !jemalloc_read(&bin_nrequests_mib, &nrequests, CLASS_INDEX, i))
+      return false;
+    total += size * nrequests;
+  }
+  unsigned int nlextents = 0;
+  if (!jemalloc_read(&nlextents_mib, &nlextents)) return false;
+  for (unsigned int i = 0; i < nlextents; i++) {
+    size_t size = 0;
+    uint64_t nrequests = 0;
+    if (!jemalloc_read(&lextent_size_mib, &size, SIZE_INDEX, i) ||
+        !jemalloc_read(&lextent_nrequests_mib, &nrequests, CLASS_INDEX, i))
+      return false;
+    total += size * nrequests;
+  }
+  *requested = total;
+  return true;
+}
+
+Snapshot_table jemalloc_stats_table = {
+    "profiler_jemalloc_stats",
+    "`ALLOCATED` BIGINT unsigned, `ACTIVE` BIGINT unsigned, "
+    "`METADATA` BIGINT unsigned, `RESIDENT` BIGINT unsigned, "
+    "`MAPPED` BIGINT unsigned, `RETAINED` BIGINT unsigned",
+    fill_jemalloc_stats, 1, {}};
+
+Snapshot_table jemalloc_arenas_table = {
+    "profiler_jemalloc_arenas",
+    "`ARENA` BIGINT unsigned, `THREADS` BIGINT unsigned, "
+    "`DIRTY_PAGES` BIGINT unsigned, `MUZZY_PAGES` BIGINT unsigned, "
+    "`SMALL_ALLOCATED` BIGINT unsigned, `SMALL_NMALLOC` BIGINT unsigned, "
+    "`SMALL_NDALLOC` BIGINT unsigned, `LARGE_ALLOCATED` BIGINT unsigned, "
+    "`LARGE_NMALLOC` BIGINT unsigned, `LARGE_NDALLOC` BIGINT unsigned, "
+    "`PAGE_SIZE` BIGINT unsigned",
+    fill_jemalloc_arenas, 16, {}};
+
+Snapshot_table jemalloc_mutexes_table = {
+    "profiler_jemalloc_mutexes",
+    "`ARENA` BIGINT unsigned, `MUTEX` VARCHAR(64), "
+    "`NUM_OPS` BIGINT unsigned, `NUM_WAIT` BIGINT unsigned, "
+    "`NUM_SPIN_ACQ` BIGINT unsigned, `NUM_OWNER_SWITCH` BIGINT unsigned, "
+    "`TOTAL_WAIT_TIME` BIGINT unsigned, `MAX_WAIT_TIME` BIGINT unsigned, "
+    "`MAX_THREADS` BIGINT unsigned",
+    fill_jemalloc_mutexes, 200, {}};
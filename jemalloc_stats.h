@@ -0,0 +1,89 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#ifndef PROFILER_JEMALLOC_STATS_H
+#define PROFILER_JEMALLOC_STATS_H
+
+#include "snapshot_table.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// The statistics are refreshed (epoch mallctl) at most once per interval,
+// reading several tables in a row doesn't refresh them each time
+#define JEMALLOC_STATS_REFRESH_MS 1000
+
+// A mallctl name resolved once with mallctlnametomib(). Names with an
+// index (e.g. "stats.arenas.0.pdirty") are resolved with 0, the index is
+// replaced when reading.
+struct Jemalloc_mib {
+  explicit Jemalloc_mib(const std::string& mallctl_name)
+      : name(mallctl_name) {}
+
+  std::string name;
+  size_t mib[8] = {0};
+  size_t length = 0;
+  // Not known by the jemalloc in use
+  bool missing = false;
+};
+
+// Read a mallctl through its cached MIB, index_position is the component
+// of the name replaced by index (-1 for none). Returns false on failure.
+extern bool jemalloc_read(Jemalloc_mib *mib, void *value, size_t size,
+                          int index_position = -1, size_t index = 0);
+
+template <typename T>
+bool jemalloc_read(Jemalloc_mib *mib, T *value, int index_position = -1,
+                   size_t index = 0) {
+  return jemalloc_read(mib, value, sizeof(T), index_position, index);
+}
+
+// Update the statistics of jemalloc if they are older than
+// JEMALLOC_STATS_REFRESH_MS, or right away when forced
+extern void refresh_jemalloc_stats(bool force = false);
+
+// Bytes of physical memory used by jemalloc (stats.resident), refreshed
+// first: used to measure the effect of a setting
+extern uint64_t jemalloc_resident();
+
+// Bytes allocated by mysqld and mapped by jemalloc
+extern bool jemalloc_totals(uint64_t *allocated, uint64_t *heap_size);
+
+// Bytes allocated since the start of mysqld, freed or not: the requests of
+// each size class times its size, merged over all the arenas. The requests
+// served by the thread caches are counted when the caches are flushed.
+extern bool jemalloc_requested_bytes(uint64_t *requested);
+
+// performance_schema.profiler_jemalloc_stats: the global counters
+extern Snapshot_table jemalloc_stats_table;
+// performance_schema.profiler_jemalloc_arenas: one row per arena in use
+extern Snapshot_table jemalloc_arenas_table;
+// performance_schema.profiler_jemalloc_mutexes: the lock counters of the
+// global mutexes and of the mutexes of each arena
+extern Snapshot_table jemalloc_mutexes_table;
+
+// Reset the counters of all the mutexes (stats.mutexes.reset), returns
+// false if jemalloc was built without statistics
+extern bool reset_jemalloc_mutex_stats();
+
+#endif /* PROFILER_JEMALLOC_STATS_H */
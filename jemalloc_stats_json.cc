@@ -0,0 +1,105 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#include "jemalloc_stats_json.h"
+
+#include <jemalloc/jemalloc.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "my_rapidjson_size_t.h"
+#include <rapidjson/document.h>
+
+namespace {
+
+// The document is about 100KB per arena in use, reserving it avoids
+// growing the buffer while jemalloc writes
+const size_t STATS_JSON_RESERVE = 1024 * 1024;
+
+void append_output(void *opaque, const char *text) {
+  static_cast<std::string *>(opaque)->append(text);
+}
+
+void flatten(const rapidjson::Value& value, const std::string& path,
+             std::vector<Snapshot_row> *rows) {
+  if (value.IsObject()) {
+    for (auto member = value.MemberBegin(); member != value.MemberEnd();
+         ++member) {
+      std::string name(member->name.GetString(),
+                       member->name.GetStringLength());
+      flatten(member->value, path.empty() ? name : path + "." + name, rows);
+    }
+    return;
+  }
+  if (value.IsArray()) {
+    for (rapidjson::SizeType i = 0; i < value.Size(); i++)
+      flatten(value[i], path + "." + std::to_string(i), rows);
+    return;
+  }
+
+  Snapshot_value text;
+  if (value.IsString()) {
+    text = Snapshot_value::string(
+        std::string(value.GetString(), value.GetStringLength()));
+  } else if (value.IsBool()) {
+    text = Snapshot_value::string(value.GetBool() ? "true" : "false");
+  } else if (value.IsUint64()) {
+    text = Snapshot_value::string(std::to_string(value.GetUint64()));
+  } else if (value.IsInt64()) {
+    text = Snapshot_value::string(std::to_string(value.GetInt64()));
+  } else if (value.IsDouble()) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%g", value.GetDouble());
+    text = Snapshot_value::string(buf);
+  }
+  rows->push_back({Snapshot_value::string(path), text});
+}
+
+void fill_jemalloc_stats_json(std::vector<Snapshot_row> *rows) {
+  std::string json;
+  if (!capture_jemalloc_stats_json(&json)) return;
+
+  rapidjson::Document doc;
+  doc.Parse(json.c_str(), json.length());
+  if (doc.HasParseError() || !doc.IsObject()) return;
+  // Everything is under a single "jemalloc" object
+  if (doc.HasMember("jemalloc") && doc["jemalloc"].IsObject())
+    flatten(doc["jemalloc"], "", rows);
+  else
+    flatten(doc, "", rows);
+}
+
+}  // namespace
+
+bool capture_jemalloc_stats_json(std::string *json) {
+  json->clear();
+  json->reserve(STATS_JSON_RESERVE);
+  malloc_stats_print(append_output, json, "J");
+  return !json->empty();
+}
+
+Snapshot_table jemalloc_stats_json_table = {
+    "profiler_jemalloc_stats_json",
+    "`NAME` VARCHAR(255), `VALUE` VARCHAR(255)",
+    fill_jemalloc_stats_json, 5000, {}};
@@ -0,0 +1,39 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#ifndef PROFILER_JEMALLOC_STATS_JSON_H
+#define PROFILER_JEMALLOC_STATS_JSON_H
+
+#include "snapshot_table.h"
+
+#include <string>
+
+// Complete state of jemalloc as printed by malloc_stats_print() with the
+// JSON option, captured in memory instead of stderr
+extern bool capture_jemalloc_stats_json(std::string *json);
+
+// performance_schema.profiler_jemalloc_stats_json: the same document
+// flattened, one row per value with its path as name (e.g.
+// "stats.arenas.merged.bins.3.curslabs")
+extern Snapshot_table jemalloc_stats_json_table;
+
+#endif /* PROFILER_JEMALLOC_STATS_JSON_H */
@@ -0,0 +1,227 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#include "leak_suspects.h"
+#include "dump_io.h"
+#include "pprof_proto.h"
+#include "symbolizer.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <map>
+#include <thread>
+
+namespace {
+
+// Parsing is mostly CPU, more threads than that would only compete with the
+// server
+const unsigned int MAX_PARSE_THREADS = 8;
+
+typedef std::map<std::vector<uint64_t>, int64_t> Stack_bytes;
+
+struct Parsed_dump {
+  bool parsed = false;
+  double time = 0;
+  Stack_bytes stacks;
+  std::vector<Mapped_region> mappings;
+};
+
+void parse_dump(const std::string& path, Parsed_dump *dump) {
+  Mapped_dump_file data;
+  Profile_data profile;
+  if (!data.open(path) ||
+      !parse_heap_profile(data.data(), data.size(), &profile))
+    return;
+
+  struct stat st;
+  if (!stat_dump_file(path, &st)) return;
+  dump->time = st.st_mtim.tv_sec + st.st_mtim.tv_nsec / 1e9;
+
+  // The in-use bytes are the last value of both layouts
+  for (const Profile_sample& sample : profile.samples) {
+    if (sample.values.empty()) continue;
+    dump->stacks[sample.pcs] += sample.values.back();
+  }
+  dump->mappings.swap(profile.mappings);
+  dump->parsed = true;
+}
+
+// Least squares fit of bytes = a + slope * time
+void fit(const std::vector<double>& x, const std::vector<double>& y,
+         double *slope, double *r_squared) {
+  size_t n = x.size();
+  double mean_x = 0, mean_y = 0;
+  for (size_t i = 0; i < n; i++) {
+    mean_x += x[i];
+    mean_y += y[i];
+  }
+  mean_x /= n;
+  mean_y /= n;
+  double sxx = 0, sxy = 0, syy = 0;
+  for (size_t i = 0; i < n; i++) {
+    sxx += (x[i] - mean_x) * (x[i] - mean_x);
+    sxy += (x[i] - mean_x) * (y[i] - mean_y);
+    syy += (y[i] - mean_y) * (y[i] - mean_y);
+  }
+  *slope = sxx > 0 ? sxy / sxx : 0;
+  *r_squared = sxx > 0 && syy > 0 ? (sxy * sxy) / (sxx * syy) : 0;
+}
+
+}  // namespace
+
+bool list_dump_series(const std::string& first, const std::string& last,
+                      std::vector<std::string> *dumps, std::string *message) {
+  std::string names[2] = {strip_compression_suffix(first),
+                          strip_compression_suffix(last)};
+  std::string prefix[2];
+  unsigned long number[2];
+  size_t width = 0;
+  for (int i = 0; i < 2; i++) {
+    const std::string& name = names[i];
+    size_t end = name.rfind(".heap");
+    size_t dot = end == std::string::npos || end == 0
+                     ? std::string::npos
+                     : name.rfind('.', end - 1);
+    // The dumps of the tcmalloc component are numbered .mNNNN
+    size_t digits = dot == std::string::npos ? dot
+                    : dot + (name[dot + 1] == 'm' ? 2 : 1);
+    if (end == std::string::npos || end + 5 != name.size() ||
+        dot == std::string::npos || digits >= end ||
+        name.find_first_not_of("0123456789", digits) != end) {
+      *message = name + " is not a dump of a series (<prefix>.[m]<number>.heap).";
+      return false;
+    }
+    prefix[i] = name.substr(0, digits);
+    number[i] = strtoul(name.c_str() + digits, nullptr, 10);
+    if (i == 0) width = end - digits;
+  }
+  if (prefix[0] != prefix[1]) {
+    *message = "the dumps are not from the same series.";
+    return false;
+  }
+  if (number[0] >= number[1]) {
+    *message = "the first dump must be older than the last one.";
+    return false;
+  }
+
+  for (unsigned long i = number[0]; i <= number[1]; i++) {
+    std::string digits = std::to_string(i);
+    if (digits.size() < width) digits.insert(0, width - digits.size(), '0');
+    std::string path = prefix[0] + digits + ".heap";
+    if (dump_file_exists(path)) dumps->push_back(path);
+  }
+  return true;
+}
+
+bool find_leak_suspects(const std::vector<std::string>& dumps,
+                        double min_r_squared, Leak_analysis *analysis,
+                        std::string *message) {
+  std::vector<Parsed_dump> parsed(dumps.size());
+  std::atomic<size_t> next{0};
+  auto worker = [&]() {
+    size_t i;
+    while ((i = next.fetch_add(1)) < dumps.size())
+      parse_dump(dumps[i], &parsed[i]);
+  };
+  unsigned int count = std::min<size_t>(
+      {(size_t)std::max(1U, std::thread::hardware_concurrency()),
+       (size_t)MAX_PARSE_THREADS, dumps.size()});
+  std::vector<std::thread> threads;
+  for (unsigned int i = 1; i < count; i++) threads.emplace_back(worker);
+  worker();
+  for (std::thread& thread : threads) thread.join();
+
+  std::vector<Parsed_dump *> series;
+  for (Parsed_dump& dump : parsed)
+    if (dump.parsed) series.push_back(&dump);
+  if (series.size() < 3) {
+    *message = "at least 3 readable heap dumps are required.";
+    return false;
+  }
+  std::sort(series.begin(), series.end(),
+            [](const Parsed_dump *a, const Parsed_dump *b) {
+              return a->time < b->time;
+            });
+  double seconds = series.back()->time - series.front()->time;
+  if (seconds <= 0) {
+    *message = "the dumps were all written at the same time.";
+    return false;
+  }
+
+  // In-use bytes of every stack in each dump, 0 when it's absent
+  std::map<std::vector<uint64_t>, std::vector<double>> history;
+  for (size_t i = 0; i < series.size(); i++)
+    for (const auto& stack : series[i]->stacks) {
+      std::vector<double>& bytes = history[stack.first];
+      if (bytes.empty()) bytes.resize(series.size(), 0);
+      bytes[i] = stack.second;
+    }
+
+  std::vector<double> times;
+  for (const Parsed_dump *dump : series)
+    times.push_back(dump->time - series.front()->time);
+
+  std::vector<Mapped_region> regions = series.back()->mappings;
+  if (regions.empty()) read_self_mappings(&regions);
+
+  analysis->dumps = series.size();
+  analysis->seconds = seconds;
+  analysis->stacks = history.size();
+  for (const auto& stack : history) {
+    const std::vector<double>& bytes = stack.second;
+    if (bytes.back() <= bytes.front()) continue;
+    bool shrank = false;
+    for (size_t i = 1; i < bytes.size() && !shrank; i++)
+      shrank = bytes[i] < bytes[i - 1];
+    if (shrank) continue;
+
+    Leak_suspect suspect;
+    double slope;
+    fit(times, bytes, &slope, &suspect.r_squared);
+    if (slope <= 0 || suspect.r_squared < min_r_squared) continue;
+    suspect.bytes_per_hour = slope * 3600;
+    suspect.first_bytes = bytes.front();
+    suspect.last_bytes = bytes.back();
+
+    bool in_allocator = true;
+    for (uint64_t pc : stack.first) {
+      std::string function, filename;
+      if (!symbolize_address(regions, pc > 0 ? pc - 1 : 0, &function,
+                             &filename))
+        function = symbolize(regions, pc);
+      if (in_allocator && is_allocator_frame(filename, function)) continue;
+      if (in_allocator) suspect.top_frame = function;
+      in_allocator = false;
+      suspect.frames.push_back(function);
+    }
+    analysis->suspects.push_back(std::move(suspect));
+  }
+
+  std::sort(analysis->suspects.begin(), analysis->suspects.end(),
+            [](const Leak_suspect& a, const Leak_suspect& b) {
+              return a.bytes_per_hour > b.bytes_per_hour;
+            });
+  return true;
+}
@@ -0,0 +1,66 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#ifndef PROFILER_LEAK_SUSPECTS_H
+#define PROFILER_LEAK_SUSPECTS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// How closely the growth of a suspect must follow a line
+#define LEAK_SUSPECT_MIN_R_SQUARED 0.9
+
+// Code path whose in-use memory grew in every dump of a series
+struct Leak_suspect {
+  // Linear trend of the in-use bytes, and how well the dumps follow it (R²)
+  double bytes_per_hour = 0;
+  double r_squared = 0;
+  int64_t first_bytes = 0;
+  int64_t last_bytes = 0;
+  std::string top_frame;
+  // Symbolized frames, innermost first
+  std::vector<std::string> frames;
+};
+
+struct Leak_analysis {
+  size_t dumps = 0;
+  double seconds = 0;
+  size_t stacks = 0;
+  std::vector<Leak_suspect> suspects;
+};
+
+// Dumps of the series between first and last (<prefix>.[m]<number>.heap,
+// compressed or not), the missing numbers are skipped
+extern bool list_dump_series(const std::string& first, const std::string& last,
+                             std::vector<std::string>* dumps,
+                             std::string* message);
+
+// Parse the dumps in parallel and keep the stacks whose in-use bytes never
+// decreased and grew overall, the fastest growth first. The suspects must
+// follow a linear trend with at least min_r_squared.
+extern bool find_leak_suspects(const std::vector<std::string>& dumps,
+                               double min_r_squared, Leak_analysis* analysis,
+                               std::string* message);
+
+#endif /* PROFILER_LEAK_SUSPECTS_H */
@@ -24,9 +24,20 @@
 #define SIGNATURE_CHANGE 1
 
 #include "memory.h"
+#include "heap_dump_writer.h"
+#include "tcmalloc_stats.h"
+#include "memory_timeline.h"
+#include "tcmalloc_control.h"
+#include "tcmalloc_growth.h"
+#include "tcmalloc_lifetimes.h"
+#include "leak_suspects.h"
+#include "memory_watchdog.h"
+#include "schedule.h"
 #include <thread>
 #include <chrono>
+#include <mutex>
 #include <filesystem>
+#include <climits>
 
 REQUIRES_SERVICE_PLACEHOLDER(log_builtins);
 REQUIRES_SERVICE_PLACEHOLDER(log_builtins_string);
@@ -45,6 +56,12 @@ REQUIRES_SERVICE_PLACEHOLDER(mysql_system_variable_reader);
 #endif
 REQUIRES_SERVICE_PLACEHOLDER(profiler_var);
 REQUIRES_SERVICE_PLACEHOLDER(profiler_pfs);
+REQUIRES_SERVICE_PLACEHOLDER(profiler_dump_store);
+REQUIRES_SERVICE_PLACEHOLDER(profiler_dump_catalog);
+REQUIRES_SERVICE_PLACEHOLDER(pfs_plugin_table_v1);
+REQUIRES_SERVICE_PLACEHOLDER_AS(pfs_plugin_column_string_v2, pfs_string);
+REQUIRES_SERVICE_PLACEHOLDER_AS(pfs_plugin_column_bigint_v1, pfs_bigint);
+REQUIRES_SERVICE_PLACEHOLDER_AS(pfs_plugin_column_timestamp_v2, pfs_timestamp);
 
 
 SERVICE_TYPE(log_builtins) * log_bi;
@@ -52,6 +69,16 @@ SERVICE_TYPE(log_builtins_string) * log_bs;
 
 static char memprof_status[] = "STOPPED";
 int dump_count = 1;
+// Next dump tcmalloc writes itself every HEAP_PROFILE_*_INTERVAL
+static int interval_dump_count = 1;
+// Protects memprof_status, memprof_dump_path, the dump counts and the start and
+// stop of the heap profiler: the UDFs, the timeout thread and the schedule
+// use them concurrently
+static std::mutex memprof_mutex;
+// Incremented each time the heap profiler starts, the timeout thread and the
+// scheduled runs only stop the session they started
+static unsigned long memprof_session = 0;
+static unsigned long memprof_scheduled_session = 0;
 
 static unsigned int heap_profile_time_interval = 0;
 static unsigned int heap_profile_allocation_interval = 0;
@@ -62,6 +89,13 @@ static unsigned int heap_profile_deallocation_interval = 0;
 // Buffer for the value of the profiler.dump_path global variable
 std::string memprof_dump_path;
 
+static const char *DEFAULT_TCMALLOC_DUMP_MODE = HEAP_DUMP_MODE_SYNC;
+// Buffer for the value of the profiler.tcmalloc_dump_mode global variable
+static char *tcmalloc_dump_mode_value;
+// Dump mode of the running profiler, the variable is only read at start so
+// all the dumps of a profile are named the same way
+static bool memprof_async_dumps = false;
+
 static SHOW_VAR memprof_status_variables[] = {
   {"profiler.memory_status", (char *)&memprof_status, SHOW_CHAR,
     SHOW_SCOPE_GLOBAL},
@@ -77,6 +111,254 @@ static SHOW_VAR memprof_status_variables[] = {
     SHOW_SCOPE_UNDEF}  // null terminator required
 };
 
+/* performance_schema tables of the component */
+static PFS_engine_table_share_proxy *memory_share_list[4] = {nullptr, nullptr,
+                                                             nullptr, nullptr};
+static const unsigned int memory_share_list_count = 4;
+
+static int tcmalloc_dump_mode_check(MYSQL_THD thd,
+                                    SYS_VAR *self MY_ATTRIBUTE((unused)),
+                                    void *save,
+                                    struct st_mysql_value *value) {
+  if (!check_variable_privilege(thd, "profiler.tcmalloc_dump_mode"))
+    return (ER_SPECIFIC_ACCESS_DENIED_ERROR);
+
+  int value_len = 0;
+  const char *new_value = value->val_str(value, nullptr, &value_len);
+  if (new_value == nullptr ||
+      (strcasecmp(new_value, HEAP_DUMP_MODE_SYNC) != 0 &&
+       strcasecmp(new_value, HEAP_DUMP_MODE_ASYNC) != 0)) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "wrong value it must be 'SYNC' or 'ASYNC'.");
+    return true;
+  }
+
+  // Save the string value
+  *static_cast<const char **>(save) = new_value;
+
+  return (0);
+}
+
+static void tcmalloc_dump_mode_update(MYSQL_THD, SYS_VAR *, void *var_ptr,
+                          const void *save) {
+  *(const char **)var_ptr =
+      *(static_cast<const char **>(const_cast<void *>(save)));
+}
+
+// Value of the profiler.tcmalloc_sample_bytes global variable. Changing it
+// needs the internal FLAGS_tcmalloc_sample_parameter of gperftools, see
+// tcmalloc_control.cc: it's not exported when tcmalloc is linked statically
+// or stripped, the update fails then.
+static unsigned long long tcmalloc_sample_bytes = 0;
+// Number of the next heap sample file, protected by memprof_mutex
+static int sample_count = 1;
+
+static int tcmalloc_sample_bytes_check(MYSQL_THD thd,
+                                       SYS_VAR *self MY_ATTRIBUTE((unused)),
+                                       void *save,
+                                       struct st_mysql_value *value) {
+  if (!check_variable_privilege(thd, "profiler.tcmalloc_sample_bytes"))
+    return (ER_SPECIFIC_ACCESS_DENIED_ERROR);
+
+  long long current = 0;
+  if (!get_tcmalloc_sample_parameter(&current)) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "the sampling parameter of this tcmalloc can't be changed at runtime, use TCMALLOC_SAMPLE_PARAMETER.");
+    return true;
+  }
+
+  long long new_value = 0;
+  if (value->val_int(value, &new_value) || new_value < 0) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "wrong value it must be a positive number of bytes.");
+    return true;
+  }
+
+  *static_cast<unsigned long long *>(save) = new_value;
+
+  return (0);
+}
+
+static void tcmalloc_sample_bytes_update(MYSQL_THD, SYS_VAR *, void *var_ptr,
+                                         const void *save) {
+  *static_cast<unsigned long long *>(var_ptr) =
+      *static_cast<const unsigned long long *>(save);
+  set_tcmalloc_sample_parameter(tcmalloc_sample_bytes);
+}
+
+// Value of the profiler.tcmalloc_release_rate global variable
+static unsigned int tcmalloc_release_rate = 0;
+// Value of the profiler.tcmalloc_max_thread_cache_bytes global variable
+static unsigned long long tcmalloc_max_thread_cache_bytes = 0;
+
+static int tcmalloc_release_rate_check(MYSQL_THD thd,
+                                       SYS_VAR *self MY_ATTRIBUTE((unused)),
+                                       void *save,
+                                       struct st_mysql_value *value) {
+  if (!check_variable_privilege(thd, "profiler.tcmalloc_release_rate"))
+    return (ER_SPECIFIC_ACCESS_DENIED_ERROR);
+
+  long long new_value = 0;
+  if (value->val_int(value, &new_value) || new_value < 0 || new_value > 10) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "wrong value it must be between 0 and 10.");
+    return true;
+  }
+
+  *static_cast<unsigned int *>(save) = new_value;
+
+  return (0);
+}
+
+static void tcmalloc_release_rate_update(MYSQL_THD, SYS_VAR *, void *var_ptr,
+                                         const void *save) {
+  *static_cast<unsigned int *>(var_ptr) =
+      *static_cast<const unsigned int *>(save);
+  MallocExtension::instance()->SetMemoryReleaseRate(tcmalloc_release_rate);
+
+  char extra[100];
+  snprintf(extra, sizeof(extra), "release rate: %u", tcmalloc_release_rate);
+  mysql_service_profiler_pfs->add("memory", "tcmalloc", "configured", "", extra);
+}
+
+static int tcmalloc_max_thread_cache_bytes_check(
+    MYSQL_THD thd, SYS_VAR *self MY_ATTRIBUTE((unused)), void *save,
+    struct st_mysql_value *value) {
+  return check_unsigned_value(thd, "profiler.tcmalloc_max_thread_cache_bytes",
+                              "bytes", save, value);
+}
+
+static void tcmalloc_max_thread_cache_bytes_update(MYSQL_THD, SYS_VAR *,
+                                                   void *var_ptr,
+                                                   const void *save) {
+  *static_cast<unsigned long long *>(var_ptr) =
+      *static_cast<const unsigned long long *>(save);
+  MallocExtension::instance()->SetNumericProperty(
+      "tcmalloc.max_total_thread_cache_bytes", tcmalloc_max_thread_cache_bytes);
+
+  char extra[100];
+  snprintf(extra, sizeof(extra), "max thread cache: %llu bytes",
+           tcmalloc_max_thread_cache_bytes);
+  mysql_service_profiler_pfs->add("memory", "tcmalloc", "configured", "", extra);
+}
+
+static int tcmalloc_free_watermark_bytes_check(
+    MYSQL_THD thd, SYS_VAR *self MY_ATTRIBUTE((unused)), void *save,
+    struct st_mysql_value *value) {
+  return check_unsigned_value(thd, "profiler.tcmalloc_free_watermark_bytes",
+                              "bytes", save, value);
+}
+
+static int tcmalloc_release_step_bytes_check(
+    MYSQL_THD thd, SYS_VAR *self MY_ATTRIBUTE((unused)), void *save,
+    struct st_mysql_value *value) {
+  if (check_unsigned_value(thd, "profiler.tcmalloc_release_step_bytes",
+                           "bytes", save, value))
+    return true;
+  if (*static_cast<unsigned long long *>(save) == 0) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "wrong value it can't be 0.");
+    return true;
+  }
+  return (0);
+}
+
+// A lower watermark is applied right away
+static void tcmalloc_release_update(MYSQL_THD, SYS_VAR *, void *var_ptr,
+                                    const void *save) {
+  *static_cast<unsigned long long *>(var_ptr) =
+      *static_cast<const unsigned long long *>(save);
+  request_tcmalloc_release();
+}
+
+// Value of the profiler.tcmalloc_lifetime_sample global variable
+static unsigned long long tcmalloc_lifetime_sample = 0;
+
+static int tcmalloc_lifetime_sample_check(MYSQL_THD thd,
+                                          SYS_VAR *self MY_ATTRIBUTE((unused)),
+                                          void *save,
+                                          struct st_mysql_value *value) {
+  return check_unsigned_value(thd, "profiler.tcmalloc_lifetime_sample",
+                              "allocations", save, value);
+}
+
+static void tcmalloc_lifetime_sample_update(MYSQL_THD, SYS_VAR *,
+                                            void *var_ptr, const void *save) {
+  *static_cast<unsigned long long *>(var_ptr) =
+      *static_cast<const unsigned long long *>(save);
+  set_lifetime_sampling(tcmalloc_lifetime_sample);
+
+  char extra[100];
+  if (tcmalloc_lifetime_sample == 0)
+    snprintf(extra, sizeof(extra), "lifetime sample: off");
+  else
+    snprintf(extra, sizeof(extra), "lifetime sample: 1 in %llu",
+             tcmalloc_lifetime_sample);
+  mysql_service_profiler_pfs->add("memory", "tcmalloc", "configured", "", extra);
+}
+
+// Releases done by the background thread
+static void report_watermark_release(uint64_t released, uint64_t rss_before,
+                                     uint64_t rss_after) {
+  char extra[150];
+  snprintf(extra, sizeof(extra),
+           "watermark: %llu bytes released, rss: %llu -> %llu bytes",
+           (unsigned long long)released, (unsigned long long)rss_before,
+           (unsigned long long)rss_after);
+  mysql_service_profiler_pfs->add("memory", "tcmalloc", "released", "", extra);
+}
+
+// Called by the watchdog when profiler.memory_dump_threshold_bytes is
+// crossed. The sampled allocations don't need a profiling session, the heap
+// profile is only used when tcmalloc doesn't sample.
+static void write_threshold_dump(const char *reason) {
+  std::string profile;
+  long long sample_parameter = 0;
+  if (get_tcmalloc_sample_parameter(&sample_parameter) && sample_parameter > 0) {
+    MallocExtension::instance()->GetHeapSample(&profile);
+  } else {
+    // Not stopped between the two calls
+    std::lock_guard<std::mutex> guard(memprof_mutex);
+    char *heap = IsHeapProfilerRunning() ? GetHeapProfile() : nullptr;
+    if (heap != nullptr) {
+      profile = heap;
+      free(heap);
+    }
+  }
+
+  char variable_value[1024];
+  size_t value_length = sizeof(variable_value) - 1;
+  std::string filePath;
+  if (!profile.empty() &&
+      !mysql_service_profiler_var->get("dump_path", variable_value, &value_length)) {
+    variable_value[value_length] = '\0';
+    filePath = next_threshold_dump_name(variable_value);
+    if (!write_dump_file(filePath, profile))
+      filePath.clear();
+  }
+  if (filePath.empty()) {
+    LogComponentErr(WARNING_LEVEL, ER_LOG_PRINTF_MSG,
+                    (std::string("memory ") + reason +
+                     ", no heap dump written: set profiler.tcmalloc_sample_bytes or start the heap profiler.").c_str());
+    mysql_service_profiler_pfs->add("memory", "tcmalloc", "threshold", "", reason);
+    return;
+  }
+  mysql_service_profiler_pfs->add("memory", "tcmalloc", "sampled", filePath.c_str(), reason);
+
+  LogComponentErr(WARNING_LEVEL, ER_LOG_PRINTF_MSG,
+                  (std::string("memory ") + reason + ", heap dump written to " +
+                   filePath).c_str());
+  std::vector<std::string> lines;
+  format_heap_sites(profile, &lines);
+  for (const std::string& line : lines)
+    LogComponentErr(WARNING_LEVEL, ER_LOG_PRINTF_MSG, line.c_str());
+}
+
 class udf_list {
   typedef std::list<std::string> udf_list_t;
 
@@ -118,44 +400,164 @@ class udf_list {
   udf_list_t set;
 } *list;
 
-std::filesystem::path get_last_file_with_prefix(const std::filesystem::path& directory, const std::string& prefix) {
-    namespace fs = std::filesystem;
+// The dumps of the component are tagged with 'm': tcmalloc numbers its own
+// interval dumps (HEAP_PROFILE_*_INTERVAL) <prefix>.NNNN.heap from 1 and
+// opens them with "w", they'd overwrite ours otherwise
+static std::string heap_dump_name(int number) {
+    std::ostringstream filename;
+    filename << memprof_dump_path << ".m"  << std::setw(4) << std::setfill('0') << number << ".heap";
+    return filename.str();
+}
 
-    fs::path last_file;
-    for (const auto& entry : fs::directory_iterator(directory)) {
-        if (entry.is_regular_file() && entry.path().filename().string().find(prefix) == 0) {
-            if (last_file.empty() || entry.path().filename().string() > last_file.filename().string()) {
-                last_file = entry.path();
-            }
-        }
+static std::string interval_dump_name(int number) {
+    std::ostringstream filename;
+    filename << memprof_dump_path << "."  << std::setw(4) << std::setfill('0') << number << ".heap";
+    return filename.str();
+}
+
+// Record the interval dumps tcmalloc wrote since the last call
+static void catalog_interval_dumps() {
+    std::string filePath = interval_dump_name(interval_dump_count);
+    while (dump_file_exists(filePath)) {
+        mysql_service_profiler_pfs->add("memory", "tcmalloc", "dumped", filePath.c_str(), "tcmalloc interval");
+        filePath = interval_dump_name(++interval_dump_count);
     }
+}
 
-    return last_file;
+// Dump the heap profile and log it. In ASYNC mode the profile is only
+// collected here, the writer thread takes care of the file and logs it once
+// written. memprof_mutex must be held.
+bool heap_profiler_dump(const char *reason) {
+    catalog_interval_dumps();
+    std::string filePath = heap_dump_name(dump_count);
+    Dump_location location;
+    dump_write_location(filePath, &location);
+
+    char *profile = GetHeapProfile();
+    if (profile == nullptr) return false;
+    if (!location.in_memory() && memprof_async_dumps) {
+        char variable_value[64];
+        size_t value_length = sizeof(variable_value) - 1;
+        int compression = DUMP_COMPRESSION_NONE;
+        if (!mysql_service_profiler_var->get("dump_compression", variable_value, &value_length) &&
+            value_length < sizeof(variable_value)) {
+            variable_value[value_length] = '\0';
+            compression = std::max(parse_dump_compression(variable_value), 0);
+        }
+        if (!queue_heap_dump(filePath, profile, reason, compression)) {
+            LogComponentErr(WARNING_LEVEL, ER_LOG_PRINTF_MSG,
+                            "too many heap dumps waiting to be written, dump skipped.");
+            return false;
+        }
+    } else {
+        // Kept in memory (profiler.dump_store) or written right away
+        bool written = write_file(location.path(), profile, strlen(profile));
+        free(profile);
+        if (!written) return false;
+        mysql_service_profiler_pfs->add("memory", "tcmalloc", "dumped", filePath.c_str(), reason);
+    }
+    ++dump_count;
+    return true;
 }
 
 void startHeapProfilerWithTimeout(const std::string& dumpPath, int timeoutSeconds) {
     // Start the heap profiler
     HeapProfilerStart(dumpPath.c_str());
-    HeapProfilerDump("starting");
-    std::ostringstream filename;
-    filename << memprof_dump_path << "."  << std::setw(4) << std::setfill('0') << dump_count << ".heap";
-    std::string filePath = filename.str();
-    mysql_service_profiler_pfs->add("memory", "tcmalloc", "dumped", filePath.c_str(), "starting"); 
-    ++dump_count;
+    heap_profiler_dump("starting");
 
     // Launch a separate thread to stop the profiler after the timeout
-    std::thread([timeoutSeconds]() {
+    unsigned long session = memprof_session;
+    std::thread([timeoutSeconds, session]() {
         std::this_thread::sleep_for(std::chrono::seconds(timeoutSeconds));
-        HeapProfilerDump("timeout");
+        std::lock_guard<std::mutex> guard(memprof_mutex);
+        // Stopped, and maybe restarted, by memprof_stop() in the meantime
+        if (memprof_session != session || strcmp(memprof_status, "RUNNING") != 0)
+            return;
+        heap_profiler_dump("timeout");
         HeapProfilerStop();
         mysql_service_profiler_pfs->add("memory", "tcmalloc", "stopped", "", "");
         strcpy(memprof_status, "STOPPED");
     }).detach(); // Detach the thread to allow it to run independently
 }
 
+static bool read_profile_schedule(std::string *spec) {
+  char variable_value[1024];
+  size_t value_length = sizeof(variable_value) - 1;
+  if (mysql_service_profiler_var->get("schedule", variable_value, &value_length) ||
+      value_length >= sizeof(variable_value))
+    return false;
+  variable_value[value_length] = '\0';
+  *spec = variable_value;
+  return true;
+}
+
+// A run of profiler.schedule writes its own series of heap dumps:
+// <dump_path>.<run name>.mNNNN.heap
+static bool start_scheduled_heap_profile(Scheduled_run *run) {
+  char variable_value[1024];
+  size_t value_length = sizeof(variable_value) - 1;
+  if (mysql_service_profiler_var->get("dump_path", variable_value, &value_length))
+    return false;
+  variable_value[value_length] = '\0';
+  run->prefix = std::string(variable_value) + "." + run->name;
+
+  std::lock_guard<std::mutex> guard(memprof_mutex);
+  const char *skipped = nullptr;
+  // The component was reloaded during the minute of the run
+  if (dump_file_exists(run->prefix + ".m0001.heap") ||
+      dump_file_exists(run->prefix + ".0001.heap"))
+    skipped = "the heap dumps already exist";
+  else if (strcmp(memprof_status, "STOPPED") != 0)
+    skipped = "the tcmalloc memory profiler is already running";
+  if (skipped != nullptr) {
+    LogComponentErr(WARNING_LEVEL, ER_LOG_PRINTF_MSG,
+                    (run->extra + ", run skipped: " + skipped + ".").c_str());
+    mysql_service_profiler_pfs->add("memory", "tcmalloc", "skipped", "", run->extra.c_str());
+    return false;
+  }
+
+  memprof_dump_path = run->prefix;
+  dump_count = interval_dump_count = 1;
+  memprof_scheduled_session = ++memprof_session;
+  memprof_async_dumps = tcmalloc_dump_mode_value != nullptr &&
+      strcasecmp(tcmalloc_dump_mode_value, HEAP_DUMP_MODE_ASYNC) == 0;
+  strcpy(memprof_status, "RUNNING");
+  mysql_service_profiler_pfs->add("memory", "tcmalloc", "started", "", run->extra.c_str());
+  HeapProfilerStart(memprof_dump_path.c_str());
+  heap_profiler_dump("starting");
+  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                  (run->extra + ", heap dumps written to " + run->prefix +
+                   ".mNNNN.heap").c_str());
+  return true;
+}
+
+// Stopped or restarted by memprof_stop() and memprof_start() otherwise,
+// memprof_mutex must be held
+static bool scheduled_heap_profile_running() {
+  return strcmp(memprof_status, "RUNNING") == 0 &&
+         memprof_session == memprof_scheduled_session;
+}
+
+static void dump_scheduled_heap_profile(const Scheduled_run&) {
+  std::lock_guard<std::mutex> guard(memprof_mutex);
+  if (scheduled_heap_profile_running()) heap_profiler_dump("schedule");
+}
+
+static void stop_scheduled_heap_profile(const Scheduled_run&,
+                                        const char *reason) {
+  std::lock_guard<std::mutex> guard(memprof_mutex);
+  if (!scheduled_heap_profile_running()) return;
+  heap_profiler_dump("stopping");
+  HeapProfilerStop();
+  strcpy(memprof_status, "STOPPED");
+  mysql_service_profiler_pfs->add("memory", "tcmalloc", "stopped", "", reason);
+}
+
 int register_status_variables() {
   if (mysql_service_status_variable_registration->register_variable(
-          (SHOW_VAR *)&memprof_status_variables)) {
+          (SHOW_VAR *)&memprof_status_variables) ||
+      mysql_service_status_variable_registration->register_variable(
+          (SHOW_VAR *)&tcmalloc_stats_status_variables)) {
     LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG, "Failed to register status variable");
     return 1;
   }
@@ -166,7 +568,9 @@ int register_status_variables() {
 
 int unregister_status_variables() {
   if (mysql_service_status_variable_registration->unregister_variable(
-          (SHOW_VAR *)&memprof_status_variables)) {
+          (SHOW_VAR *)&memprof_status_variables) ||
+      mysql_service_status_variable_registration->unregister_variable(
+          (SHOW_VAR *)&tcmalloc_stats_status_variables)) {
     LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG, "Failed to unregister status variable");
     return 1;
   }
@@ -257,10 +661,10 @@ const char *memprof_start_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
     *is_null = 1;
     return 0;
   }
-  memprof_dump_path = variable_value;
-  std::string filePath = memprof_dump_path + ".0001.heap";
-  // Check if there is something already existing
-  if (fileExists(filePath)) {
+  // Check if there is something already existing, maybe compressed, from us
+  // or from tcmalloc's interval dumps
+  if (dump_file_exists(std::string(variable_value) + ".m0001.heap") ||
+      dump_file_exists(std::string(variable_value) + ".0001.heap")) {
     mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
                                     ER_UDF_ERROR, 0, "profiler",
                                     "There is already a heap dump, change the 'profiler.dump_path' value first.");
@@ -269,6 +673,7 @@ const char *memprof_start_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
     return 0;
   }
 
+  std::lock_guard<std::mutex> guard(memprof_mutex);
   if (strcmp(memprof_status, "STOPPED") != 0) {
     mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
                                     ER_UDF_ERROR, 0, "profiler",
@@ -277,22 +682,23 @@ const char *memprof_start_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
     *is_null = 1;
     return 0;
   }
+  // Only once we know it's not running, the session in progress keeps its files
+  memprof_dump_path = variable_value;
+  dump_count = interval_dump_count = 1;
+  ++memprof_session;
+  memprof_async_dumps = tcmalloc_dump_mode_value != nullptr &&
+      strcasecmp(tcmalloc_dump_mode_value, HEAP_DUMP_MODE_ASYNC) == 0;
+  strcpy(memprof_status, "RUNNING");
+  mysql_service_profiler_pfs->add("memory", "tcmalloc", "started", "", "");
   if (time > 0) {
     startHeapProfilerWithTimeout(memprof_dump_path.c_str(), time);
     snprintf(outp, 100, "memory profiling started for %d seconds", time);
   } else {
 
     HeapProfilerStart(memprof_dump_path.c_str());
-    HeapProfilerDump("starting");
-    std::ostringstream filename;
-    filename << memprof_dump_path << "."  << std::setw(4) << std::setfill('0') << dump_count << ".heap";
-    filePath = filename.str();
+    heap_profiler_dump("starting");
     strcpy(outp, "memory profiling started");
   }
-  strcpy(memprof_status, "RUNNING");
-  mysql_service_profiler_pfs->add("memory", "tcmalloc", "started", "", "");
-  mysql_service_profiler_pfs->add("memory", "tcmalloc", "dumped", filePath.c_str(), "starting"); 
-  ++dump_count;
 
   *length = strlen(outp);
 
@@ -343,7 +749,8 @@ const char *memprof_stop_udf(UDF_INIT *, UDF_ARGS *, char *outp,
     *is_null = 1;
     return 0;
   }
-  
+
+  std::lock_guard<std::mutex> guard(memprof_mutex);
   if (strcmp(memprof_status, "STOPPED") == 0) {
     mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
                                     ER_UDF_ERROR, 0, "profiler",
@@ -353,11 +760,7 @@ const char *memprof_stop_udf(UDF_INIT *, UDF_ARGS *, char *outp,
     return 0;
   }
 
-  HeapProfilerDump("stopping");
-  std::ostringstream filename;
-  filename << memprof_dump_path << "."  << std::setw(4) << std::setfill('0') << dump_count << ".heap";
-  std::string  filePath = filename.str();
-  mysql_service_profiler_pfs->add("memory", "tcmalloc", "dumped", filePath.c_str(), "stopping"); 
+  heap_profiler_dump("stopping");
 
   HeapProfilerStop();
 
@@ -429,16 +832,21 @@ const char *memprof_dump_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
           strcpy(buf, "user request");
   }
 
-
+  std::lock_guard<std::mutex> guard(memprof_mutex);
   if (IsHeapProfilerRunning()) {
   	strcpy(memprof_status, "RUNNING");
-        HeapProfilerDump(buf);
-        strcpy(outp, "memory profiling data dumped");
-        std::ostringstream filename;
-        filename << memprof_dump_path << "."  << std::setw(4) << std::setfill('0') << dump_count << ".heap";
-        std::string filePath = filename.str();
-        mysql_service_profiler_pfs->add("memory", "tcmalloc", "dumped", filePath.c_str(), buf); 
-        ++dump_count;
+        if (!heap_profiler_dump(buf)) {
+          mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                          ER_UDF_ERROR, 0, "profiler",
+                                          "the heap profile could not be collected, too many dumps are waiting to be written.");
+          *error = 1;
+          *is_null = 1;
+          return 0;
+        }
+        if (memprof_async_dumps)
+          strcpy(outp, "memory profiling data collected, the dump is written in background");
+        else
+          strcpy(outp, "memory profiling data dumped");
   } else {
   	strcpy(memprof_status, "STOPPED");
     mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
@@ -457,10 +865,10 @@ const char *memprof_dump_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
 // UDF to run pprof for memory 
 
 static bool pprof_mem_udf_init(UDF_INIT *initid, UDF_ARGS *args, char *) {
-  if (args->arg_count > 2) {
+  if (args->arg_count > 3) {
     mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
                                     ER_UDF_ERROR, 0, "profiler",
-                                    "this function requires none, 1, 2 or 3 parameters: <dump_file>, <limit>, <'text' or 'dot'> limit is 0 by default, and don't limit the output. Limit is only used for 'text'");
+                                    "this function requires none, 1, 2 or 3 parameters: <dump_file>, <limit>, <'text', 'dot' or 'pb'> limit is 0 by default, and don't limit the output. Limit is only used for 'text'");
     return true;
   }
 
@@ -503,13 +911,15 @@ const char *pprof_mem_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
   int limit = 0;  
   std::string report_file;
   std::string report_type;
-  std::string report_file_arg;
   if (args->arg_count < 1) {
-    std::filesystem::path p(memprof_dump_path);
-    auto last_file = get_last_file_with_prefix(p.parent_path(), p.filename().string());
-    if (!last_file.empty()) { 
-      report_file_arg = last_file.filename().string();
-    } else {
+    char last_dump[PATH_MAX];
+    size_t last_dump_length = sizeof(last_dump);
+    // The catalog keeps the full path, the dump may be under an older
+    // profiler.dump_path. The dumps of the previous runs are reloaded from
+    // its journal.
+    if (!mysql_service_profiler_dump_catalog->last_dump("memory", "tcmalloc", last_dump, &last_dump_length))
+      report_file = last_dump;
+    if (report_file.empty()) {
       mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
                                       ER_UDF_ERROR, 0, "profiler",
                                       "The dump file does not exist.");
@@ -518,12 +928,15 @@ const char *pprof_mem_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
       return 0;
     }
   } else {
-    report_file_arg = args->args[0];
+    std::string dump_path;
+    {
+      std::lock_guard<std::mutex> lock(memprof_mutex);
+      dump_path = memprof_dump_path;
+    }
+    std::filesystem::path p(dump_path);
+    report_file = p.parent_path().string() + "/" + args->args[0];
   }
-  std::filesystem::path p(memprof_dump_path);
-  std::filesystem::path dir = p.parent_path();
-  report_file = dir.string() + "/" + report_file_arg;
-  if (!std::filesystem::exists(report_file)) {
+  if (!dump_file_exists(report_file)) {
        mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
                        ER_UDF_ERROR, 0, "profiler",
                        "The dump file does not exist.");
@@ -543,7 +956,7 @@ const char *pprof_mem_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
       return 0;
     }
   }
-  if (args->arg_count < 2) {
+  if (args->arg_count < 3) {
       report_type = "text";
   } else {
       report_type = args->args[2];
@@ -551,16 +964,43 @@ const char *pprof_mem_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
           report_type = "text";
       } else if (strcasecmp(report_type.c_str(), "DOT") == 0) {
           report_type = "dot";
+      } else if (strcasecmp(report_type.c_str(), "PB") == 0) {
+          report_type = "pb";
       } else {
 		      mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
                               ER_UDF_ERROR, 0, "profiler",
-                              "wrong parameter it must be 'TEXT' or 'DOT'.");
+                              "wrong parameter it must be 'TEXT', 'DOT' or 'PB'.");
     		  *error = 1;
     		  *is_null = 1;
     		  return 0;
       }
   }
 
+  if (report_type == "pb") {
+    // profile.proto is written directly, neither pprof nor mysqld are needed
+    std::string buf;
+    std::string pb_file = strip_compression_suffix(report_file) + ".pb.gz";
+    if (!export_pprof(report_file, pb_file, &buf)) {
+      mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "%s", buf.c_str());
+      *error = 1;
+      *is_null = 1;
+      return 0;
+    }
+    outp = (char *)malloc(buf.length() + 1);
+    if (outp == nullptr) {
+        *error = 1;
+        *is_null = 1;
+        return nullptr;
+    }
+    mysql_service_profiler_pfs->add("memory", "tcmalloc", "report", pb_file.c_str(), report_type.c_str());
+    strcpy(outp, buf.c_str());
+    *length = strlen(outp);
+
+    return const_cast<char *>(outp);
+  }
+
 
   //if (IsHeapProfilerRunning()) {
   //  mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
@@ -597,9 +1037,20 @@ const char *pprof_mem_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
   }
 
 
+  // pprof can't read the compressed dumps
+  Plain_dump_file dump_file;
+  if (!dump_file.open(report_file)) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "could not read the dump file %s", report_file.c_str());
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
   std::string buf; 
   buf = exec_pprof((std::string(p_variable_value) + " --" +  report_type + " "
-                 + mysqld_binary + " " + report_file).c_str());
+                 + mysqld_binary + " " + dump_file.path()).c_str());
 
   if (limit > 0 && report_type == "text") {
     buf = limit_lines(buf, limit);
@@ -696,7 +1147,7 @@ const char *pprof_mem_diff_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
       }
     }
   }
-  if (!std::filesystem::exists(dump_file1)) {
+  if (!dump_file_exists(dump_file1)) {
       mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
                            ER_UDF_ERROR, 0, "profiler",
                           "The first dump file does not exist.");
@@ -704,7 +1155,7 @@ const char *pprof_mem_diff_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
       *is_null = 1;
       return 0;
   }
-  if (!std::filesystem::exists(dump_file2)) {
+  if (!dump_file_exists(dump_file2)) {
       mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
                            ER_UDF_ERROR, 0, "profiler",
                           "The second dump file does not exist.");
@@ -748,9 +1199,21 @@ const char *pprof_mem_diff_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
   }
 
 
+  // pprof can't read the compressed dumps
+  Plain_dump_file base_file;
+  Plain_dump_file diff_file;
+  if (!base_file.open(dump_file1) || !diff_file.open(dump_file2)) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "could not read the dump files.");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
   std::string buf; 
   buf = exec_pprof((std::string(p_variable_value) + " --" + report_type + " --base="
-                 + dump_file1 + " " + mysqld_binary + " " + dump_file2).c_str());
+                 + base_file.path() + " " + mysqld_binary + " " + diff_file.path()).c_str());
 
   if (limit > 0 && report_type == "text") {
     buf = limit_lines(buf, limit);
@@ -771,6 +1234,410 @@ const char *pprof_mem_diff_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
 }
 
 
+// UDF to dump the allocations sampled by tcmalloc, no profiler is needed
+
+static bool memprof_sample_udf_init(UDF_INIT *initid, UDF_ARGS *args, char *) {
+  if (args->arg_count > 0) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "this function doesn't require any parameter");
+    return true;
+  }
+  const char* name = "utf8mb4";
+  char *value = const_cast<char*>(name);
+  initid->ptr = const_cast<char *>(udf_init);
+  if (mysql_service_mysql_udf_metadata->result_set(
+          initid, "charset",
+          const_cast<char *>(value))) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG, "failed to set result charset");
+    return false;
+  }
+  return false;
+}
+
+static void memprof_sample_udf_deinit(__attribute__((unused))
+                                       UDF_INIT *initid) {
+  assert(initid->ptr == udf_init || initid->ptr == my_udf);
+}
+
+const char *memprof_sample_udf(UDF_INIT *, UDF_ARGS *, char *outp,
+                                unsigned long *length, char *is_null,
+                                char *error) {
+  *error = 0;
+  *is_null = 0;
+
+  MYSQL_THD thd;
+
+  mysql_service_mysql_current_thread_reader->get(&thd);
+  if (!have_required_privilege(thd))
+  {
+    mysql_error_service_printf(
+        ER_SPECIFIC_ACCESS_DENIED_ERROR, 0,
+        PRIVILEGE_NAME);
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  long long sample_parameter = 0;
+  if (get_tcmalloc_sample_parameter(&sample_parameter) && sample_parameter == 0) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "tcmalloc doesn't sample the allocations, set profiler.tcmalloc_sample_bytes first.");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  char variable_value[1024];
+  size_t value_length = sizeof(variable_value) - 1;
+  if (mysql_service_profiler_var->get("dump_path", variable_value, &value_length)) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "Impossible to get the value of the global variable profiler.dump_path");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+  variable_value[value_length] = '\0';
+
+  std::string sample;
+  MallocExtension::instance()->GetHeapSample(&sample);
+
+  std::string filePath;
+  bool written;
+  {
+    // Two concurrent samples would pick the same name otherwise
+    std::lock_guard<std::mutex> guard(memprof_mutex);
+    do {
+      std::ostringstream filename;
+      filename << variable_value << ".sample." << std::setw(4) << std::setfill('0') << sample_count++ << ".heap";
+      filePath = filename.str();
+    } while (dump_file_exists(filePath));
+    written = write_dump_file(filePath, sample);
+  }
+
+  if (!written) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "Impossible to write %s", filePath.c_str());
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  char extra[100];
+  snprintf(extra, sizeof(extra), "%zu bytes, sampling every %lld bytes",
+           sample.size(), sample_parameter);
+  mysql_service_profiler_pfs->add("memory", "tcmalloc", "sampled", filePath.c_str(), extra);
+
+  snprintf(outp, 255, "heap sample written to %s", filePath.c_str());
+  *length = strlen(outp);
+
+  return const_cast<char *>(outp);
+}
+
+// UDF to report the code paths that made the tcmalloc heap grow
+
+static bool memprof_growth_report_udf_init(UDF_INIT *initid, UDF_ARGS *args,
+                                           char *) {
+  if (args->arg_count > 1) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "this function requires none or 1 parameter: <limit>, limit is 0 by default and doesn't limit the output");
+    return true;
+  }
+  if (args->arg_count == 1) args->arg_type[0] = INT_RESULT;
+  const char* name = "utf8mb4";
+  char *value = const_cast<char*>(name);
+  initid->ptr = const_cast<char *>(udf_init);
+  if (mysql_service_mysql_udf_metadata->result_set(
+          initid, "charset",
+          const_cast<char *>(value))) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG, "failed to set result charset");
+    return false;
+  }
+  return false;
+}
+
+static void memprof_growth_report_udf_deinit(__attribute__((unused))
+                                              UDF_INIT *initid) {
+  assert(initid->ptr == udf_init || initid->ptr == my_udf);
+}
+
+const char *memprof_growth_report_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
+                                      unsigned long *length, char *is_null,
+                                      char *error) {
+  *error = 0;
+  *is_null = 0;
+
+  MYSQL_THD thd;
+
+  mysql_service_mysql_current_thread_reader->get(&thd);
+  if (!have_required_privilege(thd))
+  {
+    mysql_error_service_printf(
+        ER_SPECIFIC_ACCESS_DENIED_ERROR, 0,
+        PRIVILEGE_NAME);
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  long long limit = 0;
+  if (args->arg_count > 0 && args->args[0] != nullptr)
+    limit = *((long long *)args->args[0]);
+
+  std::vector<Growth_stack> stacks;
+  int64_t total = 0;
+  if (!read_heap_growth(&stacks, &total)) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "tcmalloc didn't return any heap growth stack.");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  // Same layout as pprof --text: flat, flat%, cumulative%, then the stack
+  std::ostringstream report;
+  report << "Total: " << std::fixed << std::setprecision(1)
+         << total / 1048576.0 << " MB in " << stacks.size() << " stacks\n";
+  int64_t cumulative = 0;
+  long long rank = 0;
+  for (const Growth_stack& stack : stacks) {
+    if (limit > 0 && rank++ >= limit) break;
+    cumulative += stack.bytes;
+    report << std::setw(10) << stack.bytes / 1048576.0 << " MB "
+           << std::setw(5) << (total > 0 ? 100.0 * stack.bytes / total : 0)
+           << "% " << std::setw(5)
+           << (total > 0 ? 100.0 * cumulative / total : 0) << "% "
+           << std::setw(6) << stack.count << " " << stack.top_frame << "\n";
+    for (size_t i = 1; i < stack.frames.size(); i++)
+      report << std::string(37, ' ') << stack.frames[i] << "\n";
+  }
+  std::string buf = report.str();
+
+  outp = (char *)malloc(buf.length() + 1);
+  if (outp == nullptr) {
+      *error = 1;
+      *is_null = 1;
+      return nullptr;
+  }
+
+  char extra[100];
+  snprintf(extra, sizeof(extra), "growth: %zu stacks, %lld bytes",
+           stacks.size(), (long long)total);
+  mysql_service_profiler_pfs->add("memory", "tcmalloc", "report", "", extra);
+
+  strcpy(outp, buf.c_str());
+  *length = strlen(outp);
+
+  return const_cast<char *>(outp);
+}
+
+// UDF to find the code paths that kept growing in a series of heap dumps
+
+static bool memprof_leak_suspects_udf_init(UDF_INIT *initid, UDF_ARGS *args,
+                                           char *) {
+  if (args->arg_count < 2 || args->arg_count > 3) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "this function requires 2 or 3 arguments <first_dump_file>, <last_dump_file>, <limit>");
+    return true;
+  }
+  args->arg_type[0] = STRING_RESULT;
+  args->arg_type[1] = STRING_RESULT;
+  if (args->arg_count == 3) args->arg_type[2] = INT_RESULT;
+  const char* name = "utf8mb4";
+  char *value = const_cast<char*>(name);
+  initid->ptr = const_cast<char *>(udf_init);
+  if (mysql_service_mysql_udf_metadata->result_set(
+          initid, "charset",
+          const_cast<char *>(value))) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG, "failed to set result charset");
+    return false;
+  }
+  return false;
+}
+
+static void memprof_leak_suspects_udf_deinit(__attribute__((unused))
+                                              UDF_INIT *initid) {
+  assert(initid->ptr == udf_init || initid->ptr == my_udf);
+}
+
+const char *memprof_leak_suspects_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
+                                      unsigned long *length, char *is_null,
+                                      char *error) {
+  *error = 0;
+  *is_null = 0;
+
+  MYSQL_THD thd;
+
+  mysql_service_mysql_current_thread_reader->get(&thd);
+  if (!have_required_privilege(thd))
+  {
+    mysql_error_service_printf(
+        ER_SPECIFIC_ACCESS_DENIED_ERROR, 0,
+        PRIVILEGE_NAME);
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  if (args->args[0] == nullptr || args->args[1] == nullptr) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "the first and last dump files are required.");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+  std::string first(args->args[0], args->lengths[0]);
+  std::string last(args->args[1], args->lengths[1]);
+  long long limit = 0;
+  if (args->arg_count > 2 && args->args[2] != nullptr)
+    limit = *((long long *)args->args[2]);
+
+  std::vector<std::string> dumps;
+  Leak_analysis analysis;
+  std::string message;
+  if (!list_dump_series(first, last, &dumps, &message) ||
+      !find_leak_suspects(dumps, LEAK_SUSPECT_MIN_R_SQUARED, &analysis,
+                          &message)) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler", "%s",
+                                    message.c_str());
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  std::ostringstream report;
+  report << std::fixed << std::setprecision(1) << analysis.dumps
+         << " dumps over " << analysis.seconds / 3600 << " hours, "
+         << analysis.stacks << " stacks, " << analysis.suspects.size()
+         << " leak suspects\n";
+  if (!analysis.suspects.empty())
+    report << "   MB/hour     R2   first MB    last MB\n";
+  long long rank = 0;
+  for (const Leak_suspect& suspect : analysis.suspects) {
+    if (limit > 0 && rank++ >= limit) break;
+    report << std::setprecision(1) << std::setw(10)
+           << suspect.bytes_per_hour / 1048576.0 << " " << std::setprecision(3)
+           << std::setw(6) << suspect.r_squared << " "
+           << std::setprecision(1) << std::setw(10)
+           << suspect.first_bytes / 1048576.0 << " " << std::setw(10)
+           << suspect.last_bytes / 1048576.0 << " " << suspect.top_frame
+           << "\n";
+    for (size_t i = 1; i < suspect.frames.size(); i++)
+      report << std::string(40, ' ') << suspect.frames[i] << "\n";
+  }
+  std::string buf = report.str();
+
+  outp = (char *)malloc(buf.length() + 1);
+  if (outp == nullptr) {
+      *error = 1;
+      *is_null = 1;
+      return nullptr;
+  }
+
+  char extra[100];
+  snprintf(extra, sizeof(extra), "leak suspects: %zu in %zu dumps",
+           analysis.suspects.size(), analysis.dumps);
+  mysql_service_profiler_pfs->add("memory", "tcmalloc", "report", "", extra);
+
+  strcpy(outp, buf.c_str());
+  *length = strlen(outp);
+
+  return const_cast<char *>(outp);
+}
+
+// UDF to return the free pages of tcmalloc to the system
+
+static bool memprof_release_udf_init(UDF_INIT *initid, UDF_ARGS *args,
+                                     char *) {
+  if (args->arg_count > 1) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "this function requires none or 1 parameter: <bytes>, all the free memory is released by default");
+    return true;
+  }
+  if (args->arg_count == 1) args->arg_type[0] = INT_RESULT;
+  const char* name = "utf8mb4";
+  char *value = const_cast<char*>(name);
+  initid->ptr = const_cast<char *>(udf_init);
+  if (mysql_service_mysql_udf_metadata->result_set(
+          initid, "charset",
+          const_cast<char *>(value))) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG, "failed to set result charset");
+    return false;
+  }
+  return false;
+}
+
+static void memprof_release_udf_deinit(__attribute__((unused))
+                                       UDF_INIT *initid) {
+  assert(initid->ptr == udf_init || initid->ptr == my_udf);
+}
+
+const char *memprof_release_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
+                                unsigned long *length, char *is_null,
+                                char *error) {
+  *error = 0;
+  *is_null = 0;
+
+  MYSQL_THD thd;
+
+  mysql_service_mysql_current_thread_reader->get(&thd);
+  if (!have_required_privilege(thd))
+  {
+    mysql_error_service_printf(
+        ER_SPECIFIC_ACCESS_DENIED_ERROR, 0,
+        PRIVILEGE_NAME);
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  long long bytes = 0;
+  if (args->arg_count > 0 && args->args[0] != nullptr)
+    bytes = *((long long *)args->args[0]);
+  if (bytes < 0) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "the number of bytes must be positive.");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  size_t unmapped_before = 0, unmapped_after = 0;
+  MallocExtension::instance()->GetNumericProperty(
+      "tcmalloc.pageheap_unmapped_bytes", &unmapped_before);
+  uint64_t rss_before = read_rss();
+  if (bytes == 0)
+    MallocExtension::instance()->ReleaseFreeMemory();
+  else
+    MallocExtension::instance()->ReleaseToSystem(bytes);
+  uint64_t rss_after = read_rss();
+  MallocExtension::instance()->GetNumericProperty(
+      "tcmalloc.pageheap_unmapped_bytes", &unmapped_after);
+  unsigned long long released =
+      unmapped_after > unmapped_before ? unmapped_after - unmapped_before : 0;
+
+  char extra[150];
+  snprintf(extra, sizeof(extra), "%llu bytes released, rss: %llu -> %llu bytes",
+           released, (unsigned long long)rss_before,
+           (unsigned long long)rss_after);
+  mysql_service_profiler_pfs->add("memory", "tcmalloc", "released", "", extra);
+
+  snprintf(outp, 255, "%s", extra);
+  *length = strlen(outp);
+
+  return const_cast<char *>(outp);
+}
+
 } /* namespace udf_impl */
 
 static mysql_service_status_t profiler_memory_service_init() {
@@ -779,6 +1646,8 @@ static mysql_service_status_t profiler_memory_service_init() {
   log_bi = mysql_service_log_builtins;
   log_bs = mysql_service_log_builtins_string;
 
+  init_dump_store_client();
+
   //Todo check is thre is a value already if not set the default
 
 
@@ -835,8 +1704,295 @@ static mysql_service_status_t profiler_memory_service_init() {
   }
   LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
                     "new UDF 'memprof_diff()' has been registered successfully.");
+
+  if (list->add_scalar("MEMPROF_LEAK_SUSPECTS", Item_result::STRING_RESULT,
+                       (Udf_func_any)udf_impl::memprof_leak_suspects_udf,
+                       udf_impl::memprof_leak_suspects_udf_init,
+                       udf_impl::memprof_leak_suspects_udf_deinit)) {
+    delete list;
+    return 1; /* failure: one of the UDF registrations failed */
+  }
+  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new UDF 'memprof_leak_suspects()' has been registered successfully.");
+
+  if (list->add_scalar("MEMPROF_SAMPLE", Item_result::STRING_RESULT,
+                       (Udf_func_any)udf_impl::memprof_sample_udf,
+                       udf_impl::memprof_sample_udf_init,
+                       udf_impl::memprof_sample_udf_deinit)) {
+    delete list;
+    return 1; /* failure: one of the UDF registrations failed */
+  }
+  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new UDF 'memprof_sample()' has been registered successfully.");
+
+  if (list->add_scalar("MEMPROF_GROWTH_REPORT", Item_result::STRING_RESULT,
+                       (Udf_func_any)udf_impl::memprof_growth_report_udf,
+                       udf_impl::memprof_growth_report_udf_init,
+                       udf_impl::memprof_growth_report_udf_deinit)) {
+    delete list;
+    return 1; /* failure: one of the UDF registrations failed */
+  }
+  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new UDF 'memprof_growth_report()' has been registered successfully.");
+
+  if (list->add_scalar("MEMPROF_RELEASE", Item_result::STRING_RESULT,
+                       (Udf_func_any)udf_impl::memprof_release_udf,
+                       udf_impl::memprof_release_udf_init,
+                       udf_impl::memprof_release_udf_deinit)) {
+    delete list;
+    return 1; /* failure: one of the UDF registrations failed */
+  }
+  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new UDF 'memprof_release()' has been registered successfully.");
    
   register_status_variables();
+
+  STR_CHECK_ARG(str) tcmalloc_dump_mode_arg;
+  tcmalloc_dump_mode_arg.def_val = const_cast<char*>(DEFAULT_TCMALLOC_DUMP_MODE);
+  tcmalloc_dump_mode_value = nullptr;
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "tcmalloc_dump_mode",
+          PLUGIN_VAR_STR | PLUGIN_VAR_RQCMDARG | PLUGIN_VAR_MEMALLOC,
+          "How tcmalloc heap dumps are written: SYNC by tcmalloc in the session, ASYNC by a background thread",
+          tcmalloc_dump_mode_check, tcmalloc_dump_mode_update,
+          (void *)&tcmalloc_dump_mode_arg, (void *)&tcmalloc_dump_mode_value)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.tcmalloc_dump_mode'.");
+    result = 1;
+  } else {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.tcmalloc_dump_mode' has been registered successfully.");
+  }
+
+  INTEGRAL_CHECK_ARG(uint) memory_timeline_interval_arg;
+  memory_timeline_interval_arg.def_val = DEFAULT_MEMORY_TIMELINE_INTERVAL;
+  memory_timeline_interval_arg.min_val = 0;
+  memory_timeline_interval_arg.max_val = 86400;
+  memory_timeline_interval_arg.blk_sz = 0;
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "memory_timeline_interval",
+          PLUGIN_VAR_INT | PLUGIN_VAR_UNSIGNED | PLUGIN_VAR_RQCMDARG,
+          "Seconds between two samples of profiler_memory_timeline, 0 to stop sampling",
+          memory_timeline_interval_check, memory_timeline_interval_update,
+          (void *)&memory_timeline_interval_arg, (void *)&memory_timeline_interval)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.memory_timeline_interval'.");
+    result = 1;
+  } else {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.memory_timeline_interval' has been registered successfully.");
+  }
+
+  INTEGRAL_CHECK_ARG(ulonglong) memory_dump_threshold_bytes_arg;
+  memory_dump_threshold_bytes_arg.def_val = 0;
+  memory_dump_threshold_bytes_arg.min_val = 0;
+  memory_dump_threshold_bytes_arg.max_val = ULLONG_MAX;
+  memory_dump_threshold_bytes_arg.blk_sz = 0;
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "memory_dump_threshold_bytes",
+          PLUGIN_VAR_LONGLONG | PLUGIN_VAR_UNSIGNED | PLUGIN_VAR_RQCMDARG,
+          "Memory usage triggering a heap dump and a report in the error log, 0 disables it",
+          memory_dump_threshold_bytes_check, memory_dump_threshold_bytes_update,
+          (void *)&memory_dump_threshold_bytes_arg,
+          (void *)&memory_dump_threshold_bytes)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.memory_dump_threshold_bytes'.");
+    result = 1;
+  } else {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.memory_dump_threshold_bytes' has been registered successfully.");
+  }
+
+  STR_CHECK_ARG(str) memory_dump_threshold_source_arg;
+  memory_dump_threshold_source_arg.def_val = const_cast<char*>(MEMORY_DUMP_SOURCE_RSS);
+  memory_dump_threshold_source_value = nullptr;
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "memory_dump_threshold_source",
+          PLUGIN_VAR_STR | PLUGIN_VAR_RQCMDARG | PLUGIN_VAR_MEMALLOC,
+          "Value compared to profiler.memory_dump_threshold_bytes: RSS of mysqld or ALLOCATED by tcmalloc",
+          memory_dump_threshold_source_check, memory_dump_threshold_source_update,
+          (void *)&memory_dump_threshold_source_arg,
+          (void *)&memory_dump_threshold_source_value)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.memory_dump_threshold_source'.");
+    result = 1;
+  } else {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.memory_dump_threshold_source' has been registered successfully.");
+  }
+
+  // The default is the parameter tcmalloc was started with, a value given
+  // on the command line doesn't go through the update function
+  long long sample_parameter = 0;
+  get_tcmalloc_sample_parameter(&sample_parameter);
+  INTEGRAL_CHECK_ARG(ulonglong) tcmalloc_sample_bytes_arg;
+  tcmalloc_sample_bytes_arg.def_val = sample_parameter;
+  tcmalloc_sample_bytes_arg.min_val = 0;
+  tcmalloc_sample_bytes_arg.max_val = LLONG_MAX;
+  tcmalloc_sample_bytes_arg.blk_sz = 0;
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "tcmalloc_sample_bytes",
+          PLUGIN_VAR_LONGLONG | PLUGIN_VAR_UNSIGNED | PLUGIN_VAR_RQCMDARG,
+          "Average number of bytes between two allocations sampled by tcmalloc, 0 disables the sampling",
+          tcmalloc_sample_bytes_check, tcmalloc_sample_bytes_update,
+          (void *)&tcmalloc_sample_bytes_arg, (void *)&tcmalloc_sample_bytes)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.tcmalloc_sample_bytes'.");
+    result = 1;
+  } else {
+    if ((long long)tcmalloc_sample_bytes != sample_parameter)
+      set_tcmalloc_sample_parameter(tcmalloc_sample_bytes);
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.tcmalloc_sample_bytes' has been registered successfully.");
+  }
+
+  // The defaults are the settings tcmalloc is running with
+  INTEGRAL_CHECK_ARG(uint) tcmalloc_release_rate_arg;
+  tcmalloc_release_rate_arg.def_val =
+      (unsigned int)(MallocExtension::instance()->GetMemoryReleaseRate() + 0.5);
+  tcmalloc_release_rate_arg.min_val = 0;
+  tcmalloc_release_rate_arg.max_val = 10;
+  tcmalloc_release_rate_arg.blk_sz = 0;
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "tcmalloc_release_rate",
+          PLUGIN_VAR_INT | PLUGIN_VAR_UNSIGNED | PLUGIN_VAR_RQCMDARG,
+          "Rate at which tcmalloc returns its free pages to the system, 0 never returns them",
+          tcmalloc_release_rate_check, tcmalloc_release_rate_update,
+          (void *)&tcmalloc_release_rate_arg, (void *)&tcmalloc_release_rate)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.tcmalloc_release_rate'.");
+    result = 1;
+  } else {
+    if (tcmalloc_release_rate != tcmalloc_release_rate_arg.def_val)
+      MallocExtension::instance()->SetMemoryReleaseRate(tcmalloc_release_rate);
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.tcmalloc_release_rate' has been registered successfully.");
+  }
+
+  size_t max_thread_cache = 0;
+  MallocExtension::instance()->GetNumericProperty(
+      "tcmalloc.max_total_thread_cache_bytes", &max_thread_cache);
+  INTEGRAL_CHECK_ARG(ulonglong) tcmalloc_max_thread_cache_bytes_arg;
+  tcmalloc_max_thread_cache_bytes_arg.def_val = max_thread_cache;
+  tcmalloc_max_thread_cache_bytes_arg.min_val = 0;
+  tcmalloc_max_thread_cache_bytes_arg.max_val = LLONG_MAX;
+  tcmalloc_max_thread_cache_bytes_arg.blk_sz = 0;
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "tcmalloc_max_thread_cache_bytes",
+          PLUGIN_VAR_LONGLONG | PLUGIN_VAR_UNSIGNED | PLUGIN_VAR_RQCMDARG,
+          "Limit of the memory kept in the thread caches of tcmalloc",
+          tcmalloc_max_thread_cache_bytes_check,
+          tcmalloc_max_thread_cache_bytes_update,
+          (void *)&tcmalloc_max_thread_cache_bytes_arg,
+          (void *)&tcmalloc_max_thread_cache_bytes)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.tcmalloc_max_thread_cache_bytes'.");
+    result = 1;
+  } else {
+    if (tcmalloc_max_thread_cache_bytes != max_thread_cache)
+      MallocExtension::instance()->SetNumericProperty(
+          "tcmalloc.max_total_thread_cache_bytes",
+          tcmalloc_max_thread_cache_bytes);
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.tcmalloc_max_thread_cache_bytes' has been registered successfully.");
+  }
+
+  INTEGRAL_CHECK_ARG(ulonglong) tcmalloc_free_watermark_bytes_arg;
+  tcmalloc_free_watermark_bytes_arg.def_val = 0;
+  tcmalloc_free_watermark_bytes_arg.min_val = 0;
+  tcmalloc_free_watermark_bytes_arg.max_val = LLONG_MAX;
+  tcmalloc_free_watermark_bytes_arg.blk_sz = 0;
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "tcmalloc_free_watermark_bytes",
+          PLUGIN_VAR_LONGLONG | PLUGIN_VAR_UNSIGNED | PLUGIN_VAR_RQCMDARG,
+          "Free bytes kept by tcmalloc, the pages above are returned to the system in the background, 0 disables it",
+          tcmalloc_free_watermark_bytes_check, tcmalloc_release_update,
+          (void *)&tcmalloc_free_watermark_bytes_arg,
+          (void *)&tcmalloc_free_watermark_bytes)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.tcmalloc_free_watermark_bytes'.");
+    result = 1;
+  } else {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.tcmalloc_free_watermark_bytes' has been registered successfully.");
+  }
+
+  INTEGRAL_CHECK_ARG(ulonglong) tcmalloc_release_step_bytes_arg;
+  tcmalloc_release_step_bytes_arg.def_val = DEFAULT_TCMALLOC_RELEASE_STEP_BYTES;
+  tcmalloc_release_step_bytes_arg.min_val = 1;
+  tcmalloc_release_step_bytes_arg.max_val = LLONG_MAX;
+  tcmalloc_release_step_bytes_arg.blk_sz = 0;
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "tcmalloc_release_step_bytes",
+          PLUGIN_VAR_LONGLONG | PLUGIN_VAR_UNSIGNED | PLUGIN_VAR_RQCMDARG,
+          "Bytes returned to the system at once when going down to profiler.tcmalloc_free_watermark_bytes",
+          tcmalloc_release_step_bytes_check, tcmalloc_release_update,
+          (void *)&tcmalloc_release_step_bytes_arg,
+          (void *)&tcmalloc_release_step_bytes)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.tcmalloc_release_step_bytes'.");
+    result = 1;
+  } else {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.tcmalloc_release_step_bytes' has been registered successfully.");
+  }
+
+  INTEGRAL_CHECK_ARG(ulonglong) tcmalloc_lifetime_sample_arg;
+  tcmalloc_lifetime_sample_arg.def_val = 0;
+  tcmalloc_lifetime_sample_arg.min_val = 0;
+  tcmalloc_lifetime_sample_arg.max_val = UINT_MAX;
+  tcmalloc_lifetime_sample_arg.blk_sz = 0;
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "tcmalloc_lifetime_sample",
+          PLUGIN_VAR_LONGLONG | PLUGIN_VAR_UNSIGNED | PLUGIN_VAR_RQCMDARG,
+          "Follow 1 in N allocations until they are freed for profiler_alloc_lifetimes, 0 disables the hooks",
+          tcmalloc_lifetime_sample_check, tcmalloc_lifetime_sample_update,
+          (void *)&tcmalloc_lifetime_sample_arg,
+          (void *)&tcmalloc_lifetime_sample)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.tcmalloc_lifetime_sample'.");
+    result = 1;
+  } else {
+    // Set in my.cnf or persisted
+    if (tcmalloc_lifetime_sample > 0)
+      set_lifetime_sampling(tcmalloc_lifetime_sample);
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.tcmalloc_lifetime_sample' has been registered successfully.");
+  }
+
+  init_heap_dump_writer();
+  init_memory_timeline("tcmalloc", tcmalloc_totals);
+  init_tcmalloc_release(report_watermark_release);
+  init_memory_watchdog(tcmalloc_totals, write_threshold_dump);
+  init_profile_scheduler(PROFILE_SCHEDULE_MEMORY, read_profile_schedule,
+                         start_scheduled_heap_profile,
+                         dump_scheduled_heap_profile,
+                         stop_scheduled_heap_profile);
+
+  memory_share_list[0] = init_snapshot_share<&tcmalloc_stats_table>();
+  memory_share_list[1] = init_snapshot_share<&memory_timeline_table>();
+  memory_share_list[2] = init_snapshot_share<&tcmalloc_growth_table>();
+  memory_share_list[3] = init_snapshot_share<&alloc_lifetimes_table>();
+  if (mysql_service_pfs_plugin_table_v1->add_tables(&memory_share_list[0],
+                                                    memory_share_list_count)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "PFS tables have NOT been registered successfully!");
+    result = 1;
+  } else {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "PFS tables have been registered successfully.");
+  }
+
   heap_profile_time_interval = std::getenv("HEAP_PROFILE_TIME_INTERVAL") 
         ? std::stoi(std::getenv("HEAP_PROFILE_TIME_INTERVAL")) 
         : 0;
@@ -860,7 +2016,54 @@ static mysql_service_status_t profiler_memory_service_deinit() {
 
   delete list;
 
+  // The last dump of a scheduled run goes through the writer
+  deinit_profile_scheduler();
+  // Pending heap dumps are written before leaving
+  deinit_heap_dump_writer();
+  deinit_memory_timeline();
+  deinit_memory_watchdog();
+  deinit_tcmalloc_release();
+  deinit_lifetime_sampling();
+
+  if (mysql_service_pfs_plugin_table_v1->delete_tables(&memory_share_list[0],
+                                                       memory_share_list_count)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "Error while trying to remove PFS tables");
+  } else {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "PFS tables have been removed successfully.");
+  }
+
   unregister_status_variables();
+  if (mysql_service_component_sys_variable_unregister->unregister_variable(
+              "profiler", "tcmalloc_dump_mode")) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+              "could not unregister variable 'profiler.tcmalloc_dump_mode'.");
+  } else {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+              "variable 'profiler.tcmalloc_dump_mode' is now unregistered successfully.");
+  }
+
+  tcmalloc_dump_mode_value = nullptr;
+
+  for (const char *variable :
+       {"memory_timeline_interval", "memory_dump_threshold_bytes",
+        "memory_dump_threshold_source", "tcmalloc_sample_bytes",
+        "tcmalloc_release_rate", "tcmalloc_max_thread_cache_bytes",
+        "tcmalloc_free_watermark_bytes", "tcmalloc_release_step_bytes",
+        "tcmalloc_lifetime_sample"}) {
+    if (mysql_service_component_sys_variable_unregister->unregister_variable(
+                "profiler", variable)) {
+      LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                (std::string("could not unregister variable 'profiler.") + variable + "'.").c_str());
+    } else {
+      LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                (std::string("variable 'profiler.") + variable + "' is now unregistered successfully.").c_str());
+    }
+  }
+  memory_dump_threshold_source_value = nullptr;
+
+  deinit_dump_store_client();
 
   LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG, "uninstalled.");
 
@@ -888,6 +2091,12 @@ BEGIN_COMPONENT_REQUIRES(profiler_memory_service)
 #endif
     REQUIRES_SERVICE(profiler_var),
     REQUIRES_SERVICE(profiler_pfs),
+    REQUIRES_SERVICE(profiler_dump_store),
+    REQUIRES_SERVICE(profiler_dump_catalog),
+    REQUIRES_SERVICE(pfs_plugin_table_v1),
+    REQUIRES_SERVICE_AS(pfs_plugin_column_string_v2, pfs_string),
+    REQUIRES_SERVICE_AS(pfs_plugin_column_bigint_v1, pfs_bigint),
+    REQUIRES_SERVICE_AS(pfs_plugin_column_timestamp_v2, pfs_timestamp),
 END_COMPONENT_REQUIRES();
 
 /* A list of metadata to describe the Component. */
@@ -24,4 +24,11 @@
 
 #include "common.h"
 #include <gperftools/heap-profiler.h>
+#include <gperftools/malloc_extension.h>
 #include "profiler_service.h"
+#include "pprof_proto.h"
+#include "dump_io.h"
+#include "dump_store_client.h"
+
+extern REQUIRES_SERVICE_PLACEHOLDER(profiler_var);
+extern REQUIRES_SERVICE_PLACEHOLDER(profiler_pfs);
@@ -0,0 +1,202 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#include "memory_timeline.h"
+
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+unsigned int memory_timeline_interval = DEFAULT_MEMORY_TIMELINE_INTERVAL;
+
+namespace {
+
+// One array per column, a sample only costs a few stores
+struct Timeline_ring {
+  uint64_t timestamp[MEMORY_TIMELINE_CAPACITY];  // microseconds
+  uint64_t allocated[MEMORY_TIMELINE_CAPACITY];
+  uint64_t heap_size[MEMORY_TIMELINE_CAPACITY];
+  uint64_t rss[MEMORY_TIMELINE_CAPACITY];
+  uint64_t minor_faults[MEMORY_TIMELINE_CAPACITY];
+  uint64_t major_faults[MEMORY_TIMELINE_CAPACITY];
+  // Total number of samples taken, the ring holds the last ones
+  uint64_t count = 0;
+};
+
+std::mutex timeline_mutex;
+std::condition_variable timeline_cond;
+Timeline_ring *timeline = nullptr;
+std::thread timeline_sampler;
+bool timeline_stopping = false;
+const char *timeline_allocator = "";
+Allocator_totals_reader timeline_reader = nullptr;
+
+void take_sample() {
+  uint64_t allocated = 0, heap_size = 0;
+  if (timeline_reader != nullptr) timeline_reader(&allocated, &heap_size);
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  uint64_t rss = read_rss();
+  uint64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::chrono::system_clock::now().time_since_epoch())
+                     .count();
+
+  std::lock_guard<std::mutex> guard(timeline_mutex);
+  size_t slot = timeline->count % MEMORY_TIMELINE_CAPACITY;
+  timeline->timestamp[slot] = now;
+  timeline->allocated[slot] = allocated;
+  timeline->heap_size[slot] = heap_size;
+  timeline->rss[slot] = rss;
+  timeline->minor_faults[slot] = usage.ru_minflt;
+  timeline->major_faults[slot] = usage.ru_majflt;
+  timeline->count++;
+}
+
+void timeline_sampler_run() {
+  std::unique_lock<std::mutex> lock(timeline_mutex);
+  while (!timeline_stopping) {
+    unsigned int interval = memory_timeline_interval;
+    if (interval == 0) {
+      timeline_cond.wait(lock);
+      continue;
+    }
+    lock.unlock();
+    take_sample();
+    lock.lock();
+    // Woken up early when the interval changes
+    timeline_cond.wait_for(lock, std::chrono::seconds(interval), [interval] {
+      return timeline_stopping || memory_timeline_interval != interval;
+    });
+  }
+}
+
+Snapshot_value delta(uint64_t current, uint64_t previous) {
+  return Snapshot_value::number((long long)(current - previous));
+}
+
+// Per second
+Snapshot_value rate(uint64_t current, uint64_t previous, uint64_t micros) {
+  if (micros == 0) return Snapshot_value::null();
+  return Snapshot_value::number((long long)(current - previous) * 1000000LL /
+                                (long long)micros);
+}
+
+void fill_memory_timeline(std::vector<Snapshot_row> *rows) {
+  std::lock_guard<std::mutex> guard(timeline_mutex);
+  if (timeline == nullptr) return;
+  uint64_t count = timeline->count;
+  uint64_t first =
+      count > MEMORY_TIMELINE_CAPACITY ? count - MEMORY_TIMELINE_CAPACITY : 0;
+  rows->reserve(count - first);
+  for (uint64_t i = first; i < count; i++) {
+    size_t slot = i % MEMORY_TIMELINE_CAPACITY;
+    Snapshot_row row = {
+        Snapshot_value::timestamp(timeline->timestamp[slot]),
+        Snapshot_value::string(timeline_allocator),
+        Snapshot_value::unsigned_number(timeline->allocated[slot]),
+        Snapshot_value::null(), Snapshot_value::null(),
+        Snapshot_value::unsigned_number(timeline->heap_size[slot]),
+        Snapshot_value::unsigned_number(timeline->rss[slot]),
+        Snapshot_value::null(), Snapshot_value::null(),
+        Snapshot_value::null(), Snapshot_value::null()};
+    if (i > first) {
+      size_t prev = (i - 1) % MEMORY_TIMELINE_CAPACITY;
+      uint64_t elapsed = timeline->timestamp[slot] - timeline->timestamp[prev];
+      row[3] = delta(timeline->allocated[slot], timeline->allocated[prev]);
+      row[4] = rate(timeline->allocated[slot], timeline->allocated[prev], elapsed);
+      row[7] = delta(timeline->rss[slot], timeline->rss[prev]);
+      row[8] = rate(timeline->rss[slot], timeline->rss[prev], elapsed);
+      row[9] = delta(timeline->minor_faults[slot], timeline->minor_faults[prev]);
+      row[10] = delta(timeline->major_faults[slot], timeline->major_faults[prev]);
+    }
+    rows->push_back(std::move(row));
+  }
+}
+
+}  // namespace
+
+Snapshot_table memory_timeline_table = {
+    "profiler_memory_timeline",
+    "`TIMESTAMP` timestamp(6), `ALLOCATOR` VARCHAR(10), "
+    "`ALLOCATED` BIGINT unsigned, `ALLOCATED_DELTA` BIGINT, "
+    "`ALLOCATED_RATE` BIGINT, `HEAP_SIZE` BIGINT unsigned, "
+    "`RSS` BIGINT unsigned, `RSS_DELTA` BIGINT, `RSS_RATE` BIGINT, "
+    "`MINOR_FAULTS` BIGINT, `MAJOR_FAULTS` BIGINT",
+    fill_memory_timeline, MEMORY_TIMELINE_CAPACITY, {}};
+
+void init_memory_timeline(const char *allocator,
+                          Allocator_totals_reader reader) {
+  std::lock_guard<std::mutex> guard(timeline_mutex);
+  timeline = new Timeline_ring();
+  timeline_allocator = allocator;
+  timeline_reader = reader;
+  timeline_stopping = false;
+  timeline_sampler = std::thread(timeline_sampler_run);
+}
+
+void deinit_memory_timeline() {
+  {
+    std::lock_guard<std::mutex> guard(timeline_mutex);
+    timeline_stopping = true;
+  }
+  timeline_cond.notify_all();
+  if (timeline_sampler.joinable()) timeline_sampler.join();
+  std::lock_guard<std::mutex> guard(timeline_mutex);
+  delete timeline;
+  timeline = nullptr;
+}
+
+int memory_timeline_interval_check(MYSQL_THD thd,
+                                   SYS_VAR *self MY_ATTRIBUTE((unused)),
+                                   void *save, struct st_mysql_value *value) {
+  if (!check_variable_privilege(thd, "profiler.memory_timeline_interval"))
+    return (ER_SPECIFIC_ACCESS_DENIED_ERROR);
+
+  long long new_value = 0;
+  if (value->val_int(value, &new_value) || new_value < 0 ||
+      new_value > 86400) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "wrong value it must be a number of seconds between 0 and 86400.");
+    return true;
+  }
+
+  *static_cast<unsigned int *>(save) = new_value;
+
+  return (0);
+}
+
+void memory_timeline_interval_update(MYSQL_THD, SYS_VAR *, void *var_ptr,
+                                     const void *save) {
+  {
+    std::lock_guard<std::mutex> guard(timeline_mutex);
+    *static_cast<unsigned int *>(var_ptr) =
+        *static_cast<const unsigned int *>(save);
+  }
+  timeline_cond.notify_all();
+}
@@ -0,0 +1,57 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#ifndef PROFILER_MEMORY_TIMELINE_H
+#define PROFILER_MEMORY_TIMELINE_H
+
+#include "common.h"
+#include "snapshot_table.h"
+
+#include <cstdint>
+
+// Number of samples kept, a week with the default interval
+#define MEMORY_TIMELINE_CAPACITY 10080
+#define DEFAULT_MEMORY_TIMELINE_INTERVAL 60
+
+// Totals of the allocator in use, returns false when they can't be read
+typedef bool (*Allocator_totals_reader)(uint64_t *allocated,
+                                        uint64_t *heap_size);
+
+// Value of profiler.memory_timeline_interval in seconds, 0 stops sampling
+extern unsigned int memory_timeline_interval;
+
+// performance_schema.profiler_memory_timeline: the samples taken by the
+// background thread of the memory components, the deltas and rates are
+// computed when the table is read
+extern Snapshot_table memory_timeline_table;
+
+extern void init_memory_timeline(const char *allocator,
+                                 Allocator_totals_reader reader);
+extern void deinit_memory_timeline();
+
+extern int memory_timeline_interval_check(MYSQL_THD thd, SYS_VAR *self,
+                                          void *save,
+                                          struct st_mysql_value *value);
+extern void memory_timeline_interval_update(MYSQL_THD thd, SYS_VAR *self,
+                                            void *var_ptr, const void *save);
+
+#endif /* PROFILER_MEMORY_TIMELINE_H */
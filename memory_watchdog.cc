@@ -0,0 +1,206 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#include "memory_watchdog.h"
+#include "dump_io.h"
+#include "pprof_proto.h"
+
+#include <strings.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+
+unsigned long long memory_dump_threshold_bytes = 0;
+char *memory_dump_threshold_source_value = nullptr;
+
+namespace {
+
+// The memory can grow by several GB in a few seconds before the OOM killer
+// steps in, reading the RSS or the allocator totals is cheap
+const std::chrono::milliseconds watchdog_interval(250);
+// Crossing the threshold again only counts once the value went under this
+// percentage of the threshold
+const unsigned long long REARM_PERCENT = 90;
+
+std::mutex watchdog_mutex;
+std::condition_variable watchdog_cond;
+std::thread watchdog_thread;
+bool watchdog_stopping = false;
+Allocator_totals_reader watchdog_reader = nullptr;
+Threshold_dump_writer watchdog_writer = nullptr;
+std::atomic<bool> watchdog_allocated{false};
+std::atomic<bool> watchdog_armed{true};
+std::atomic<int> threshold_dump_count{1};
+
+void check_threshold(unsigned long long threshold) {
+  bool allocated_source = watchdog_allocated.load();
+  uint64_t value = 0;
+  if (allocated_source) {
+    uint64_t heap_size = 0;
+    if (watchdog_reader == nullptr || !watchdog_reader(&value, &heap_size))
+      return;
+  } else {
+    value = read_rss();
+    if (value == 0) return;
+  }
+
+  if (!watchdog_armed.load()) {
+    if (value < threshold / 100 * REARM_PERCENT) watchdog_armed = true;
+    return;
+  }
+  if (value < threshold) return;
+  watchdog_armed = false;
+
+  char reason[128];
+  snprintf(reason, sizeof(reason), "threshold: %s %llu >= %llu bytes",
+           allocated_source ? "allocated" : "rss", (unsigned long long)value,
+           threshold);
+  watchdog_writer(reason);
+}
+
+void watchdog_run() {
+  std::unique_lock<std::mutex> lock(watchdog_mutex);
+  while (!watchdog_stopping) {
+    unsigned long long threshold = memory_dump_threshold_bytes;
+    if (threshold == 0) {
+      watchdog_cond.wait(lock);
+      continue;
+    }
+    lock.unlock();
+    check_threshold(threshold);
+    lock.lock();
+    // Woken up early when the threshold changes
+    watchdog_cond.wait_for(lock, watchdog_interval, [threshold] {
+      return watchdog_stopping || memory_dump_threshold_bytes != threshold;
+    });
+  }
+}
+
+}  // namespace
+
+void init_memory_watchdog(Allocator_totals_reader reader,
+                          Threshold_dump_writer writer) {
+  std::lock_guard<std::mutex> guard(watchdog_mutex);
+  watchdog_reader = reader;
+  watchdog_writer = writer;
+  watchdog_allocated =
+      memory_dump_threshold_source_value != nullptr &&
+      strcasecmp(memory_dump_threshold_source_value,
+                 MEMORY_DUMP_SOURCE_ALLOCATED) == 0;
+  watchdog_armed = true;
+  watchdog_stopping = false;
+  watchdog_thread = std::thread(watchdog_run);
+}
+
+void deinit_memory_watchdog() {
+  {
+    std::lock_guard<std::mutex> guard(watchdog_mutex);
+    watchdog_stopping = true;
+  }
+  watchdog_cond.notify_all();
+  if (watchdog_thread.joinable()) watchdog_thread.join();
+}
+
+std::string next_threshold_dump_name(const std::string& dump_path) {
+  std::string filePath;
+  do {
+    std::ostringstream filename;
+    filename << dump_path << ".threshold." << std::setw(4)
+             << std::setfill('0') << threshold_dump_count++ << ".heap";
+    filePath = filename.str();
+  } while (dump_file_exists(filePath));
+  return filePath;
+}
+
+bool format_heap_sites(const std::string& profile,
+                       std::vector<std::string> *lines) {
+  Profile_data data;
+  if (!parse_heap_profile(profile.data(), profile.size(), &data)) return false;
+  std::vector<Heap_site> sites;
+  summarize_heap_sites(data, MEMORY_DUMP_LOGGED_SITES, &sites);
+  for (size_t i = 0; i < sites.size(); i++) {
+    char line[512];
+    snprintf(line, sizeof(line), "#%zu %lld bytes in %lld objects: %s", i + 1,
+             (long long)sites[i].bytes, (long long)sites[i].objects,
+             sites[i].site.c_str());
+    lines->push_back(line);
+  }
+  return true;
+}
+
+int memory_dump_threshold_bytes_check(MYSQL_THD thd,
+                                      SYS_VAR *self MY_ATTRIBUTE((unused)),
+                                      void *save,
+                                      struct st_mysql_value *value) {
+  return check_unsigned_value(thd, "profiler.memory_dump_threshold_bytes",
+                              "bytes", save, value);
+}
+
+void memory_dump_threshold_bytes_update(MYSQL_THD, SYS_VAR *, void *var_ptr,
+                                        const void *save) {
+  {
+    std::lock_guard<std::mutex> guard(watchdog_mutex);
+    *static_cast<unsigned long long *>(var_ptr) =
+        *static_cast<const unsigned long long *>(save);
+    watchdog_armed = true;
+  }
+  watchdog_cond.notify_all();
+}
+
+int memory_dump_threshold_source_check(MYSQL_THD thd,
+                                       SYS_VAR *self MY_ATTRIBUTE((unused)),
+                                       void *save,
+                                       struct st_mysql_value *value) {
+  if (!check_variable_privilege(thd, "profiler.memory_dump_threshold_source"))
+    return (ER_SPECIFIC_ACCESS_DENIED_ERROR);
+
+  int value_len = 0;
+  const char *new_value = value->val_str(value, nullptr, &value_len);
+  if (new_value == nullptr ||
+      (strcasecmp(new_value, MEMORY_DUMP_SOURCE_RSS) != 0 &&
+       strcasecmp(new_value, MEMORY_DUMP_SOURCE_ALLOCATED) != 0)) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "wrong value it must be 'RSS' or 'ALLOCATED'.");
+    return true;
+  }
+
+  // Save the string value
+  *static_cast<const char **>(save) = new_value;
+
+  return (0);
+}
+
+void memory_dump_threshold_source_update(MYSQL_THD, SYS_VAR *, void *var_ptr,
+                                         const void *save) {
+  const char *new_value =
+      *(static_cast<const char **>(const_cast<void *>(save)));
+  *(const char **)var_ptr = new_value;
+  watchdog_allocated =
+      strcasecmp(new_value, MEMORY_DUMP_SOURCE_ALLOCATED) == 0;
+  watchdog_armed = true;
+}
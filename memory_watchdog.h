@@ -0,0 +1,74 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#ifndef PROFILER_MEMORY_WATCHDOG_H
+#define PROFILER_MEMORY_WATCHDOG_H
+
+#include "common.h"
+#include "memory_timeline.h"
+
+#include <string>
+#include <vector>
+
+#define MEMORY_DUMP_SOURCE_RSS "RSS"
+#define MEMORY_DUMP_SOURCE_ALLOCATED "ALLOCATED"
+// Number of allocation sites written to the error log with the dump
+#define MEMORY_DUMP_LOGGED_SITES 20
+
+// Take a heap dump now, reason tells which value crossed the threshold
+typedef void (*Threshold_dump_writer)(const char *reason);
+
+// Value of profiler.memory_dump_threshold_bytes, 0 disables the watchdog
+extern unsigned long long memory_dump_threshold_bytes;
+// Value of profiler.memory_dump_threshold_source: RSS or ALLOCATED
+extern char *memory_dump_threshold_source_value;
+
+// Background thread of the memory components comparing the RSS of mysqld or
+// the bytes allocated through the allocator to the threshold. A single dump
+// is taken when the threshold is crossed, the next one only after the value
+// went back under 90% of the threshold.
+extern void init_memory_watchdog(Allocator_totals_reader reader,
+                                 Threshold_dump_writer writer);
+extern void deinit_memory_watchdog();
+
+// Name of the next dump taken outside of a profiling session:
+// <dump_path>.threshold.NNNN.heap
+extern std::string next_threshold_dump_name(const std::string& dump_path);
+// The largest allocation sites of a heap profile, one line each for the
+// error log. Returns false if the profile can't be parsed.
+extern bool format_heap_sites(const std::string& profile,
+                              std::vector<std::string>* lines);
+
+extern int memory_dump_threshold_bytes_check(MYSQL_THD thd, SYS_VAR *self,
+                                             void *save,
+                                             struct st_mysql_value *value);
+extern void memory_dump_threshold_bytes_update(MYSQL_THD thd, SYS_VAR *self,
+                                               void *var_ptr,
+                                               const void *save);
+extern int memory_dump_threshold_source_check(MYSQL_THD thd, SYS_VAR *self,
+                                              void *save,
+                                              struct st_mysql_value *value);
+extern void memory_dump_threshold_source_update(MYSQL_THD thd, SYS_VAR *self,
+                                                void *var_ptr,
+                                                const void *save);
+
+#endif /* PROFILER_MEMORY_WATCHDOG_H */
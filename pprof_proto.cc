@@ -0,0 +1,506 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#include "pprof_proto.h"
+#include "dump_io.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <unordered_map>
+
+namespace {
+
+// Minimal protocol buffers encoder, only what profile.proto needs
+class Proto_writer {
+ public:
+  void varint(uint64_t value) {
+    while (value >= 0x80) {
+      m_data += static_cast<char>((value & 0x7f) | 0x80);
+      value >>= 7;
+    }
+    m_data += static_cast<char>(value);
+  }
+
+  void tag(int field, int wire_type) {
+    varint((static_cast<uint64_t>(field) << 3) | wire_type);
+  }
+
+  void uint64(int field, uint64_t value) {
+    if (value == 0) return;
+    tag(field, 0);
+    varint(value);
+  }
+
+  void int64(int field, int64_t value) {
+    uint64(field, static_cast<uint64_t>(value));
+  }
+
+  void boolean(int field, bool value) {
+    if (!value) return;
+    tag(field, 0);
+    varint(1);
+  }
+
+  void bytes(int field, const std::string& value) {
+    tag(field, 2);
+    varint(value.size());
+    m_data += value;
+  }
+
+  void message(int field, const Proto_writer& value) {
+    bytes(field, value.m_data);
+  }
+
+  template <typename T>
+  void packed(int field, const std::vector<T>& values) {
+    if (values.empty()) return;
+    Proto_writer p;
+    for (T value : values) p.varint(static_cast<uint64_t>(value));
+    message(field, p);
+  }
+
+  std::string& data() { return m_data; }
+
+ private:
+  std::string m_data;
+};
+
+class String_table {
+ public:
+  String_table() { index(""); }
+
+  int64_t index(const std::string& s) {
+    auto it = m_index.find(s);
+    if (it != m_index.end()) return it->second;
+    int64_t i = m_strings.size();
+    m_index[s] = i;
+    m_strings.push_back(s);
+    return i;
+  }
+
+  const std::vector<std::string>& strings() const { return m_strings; }
+
+ private:
+  std::unordered_map<std::string, int64_t> m_index;
+  std::vector<std::string> m_strings;
+};
+
+// profile.proto field numbers
+enum {
+  PROFILE_SAMPLE_TYPE = 1,
+  PROFILE_SAMPLE = 2,
+  PROFILE_MAPPING = 3,
+  PROFILE_LOCATION = 4,
+  PROFILE_FUNCTION = 5,
+  PROFILE_STRING_TABLE = 6,
+  PROFILE_TIME_NANOS = 9,
+  PROFILE_PERIOD_TYPE = 11,
+  PROFILE_PERIOD = 12
+};
+
+// Sampled heap profiles only contain a fraction of the allocations, scale
+// the values back the same way pprof does
+void unsample(int64_t rate, int64_t *count, int64_t *bytes) {
+  if (rate <= 1 || *count <= 0 || *bytes <= 0) return;
+  double average = static_cast<double>(*bytes) / *count;
+  double scale = 1.0 / (1.0 - exp(-average / rate));
+  *count = static_cast<int64_t>(*count * scale);
+  *bytes = static_cast<int64_t>(*bytes * scale);
+}
+
+void parse_pcs(const char *s, std::vector<uint64_t> *pcs) {
+  char *end;
+  while (*s != '\0') {
+    while (*s == ' ' || *s == '\t') s++;
+    if (*s == '\0' || *s == '\n') break;
+    uint64_t pc = strtoull(s, &end, 16);
+    if (end == s) break;
+    pcs->push_back(pc);
+    s = end;
+  }
+}
+
+}  // namespace
+
+bool parse_cpu_profile(const char *data, size_t length, Profile_data *profile) {
+  const size_t word = sizeof(uintptr_t);
+  const size_t nwords = length / word;
+  auto w = [&](size_t i) {
+    uintptr_t v;
+    memcpy(&v, data + i * word, word);
+    return static_cast<uint64_t>(v);
+  };
+
+  // header: 0, header words (3), version (0), sampling period (us), padding
+  if (nwords < 5 || w(0) != 0 || w(1) != 3 || w(2) != 0) return false;
+  const int64_t period_ns = static_cast<int64_t>(w(3)) * 1000;
+
+  profile->kind = "cpu";
+  profile->sample_types = {{"samples", "count"}, {"cpu", "nanoseconds"}};
+  profile->period_type = "cpu";
+  profile->period_unit = "nanoseconds";
+  profile->period = period_ns;
+
+  size_t i = 2 + w(1);
+  while (i + 2 <= nwords) {
+    uint64_t count = w(i);
+    uint64_t depth = w(i + 1);
+    // trailer: 0, 1, 0
+    if (count == 0 && depth == 1 && i + 2 < nwords && w(i + 2) == 0) {
+      i += 3;
+      break;
+    }
+    if (depth > nwords - i - 2) return false;
+    Profile_sample sample;
+    for (uint64_t d = 0; d < depth; d++) sample.pcs.push_back(w(i + 2 + d));
+    sample.values = {static_cast<int64_t>(count),
+                     static_cast<int64_t>(count) * period_ns};
+    profile->samples.push_back(std::move(sample));
+    i += 2 + depth;
+  }
+
+  // The memory map of the process follows the binary data
+  if (i * word < length)
+    parse_mapped_libraries(std::string(data + i * word, length - i * word),
+                           &profile->mappings);
+  return true;
+}
+
+bool parse_heap_profile(const char *data, size_t length,
+                        Profile_data *profile) {
+  std::istringstream stream(std::string(data, length));
+  std::string line;
+  if (!std::getline(stream, line)) return false;
+
+  profile->kind = "memory";
+  int64_t rate = 0;
+  bool jemalloc = false;
+  bool full = false;  // heap profiler dumps carry in-use and total values
+
+  if (line.compare(0, 8, "heap_v2/") == 0) {
+    jemalloc = true;
+    full = true;
+    rate = strtoll(line.c_str() + 8, nullptr, 10);
+  } else if (line.compare(0, 13, "heap profile:") == 0) {
+    size_t at = line.find('@');
+    std::string label = at == std::string::npos ? "" : line.substr(at + 1);
+    label.erase(0, label.find_first_not_of(' '));
+    if (label.compare(0, 8, "heap_v2/") == 0)
+      rate = strtoll(label.c_str() + 8, nullptr, 10);
+    else if (label.compare(0, 11, "heapprofile") == 0)
+      full = true;
+  } else {
+    return false;
+  }
+
+  if (full) {
+    profile->sample_types = {{"alloc_objects", "count"},
+                             {"alloc_space", "bytes"},
+                             {"inuse_objects", "count"},
+                             {"inuse_space", "bytes"}};
+  } else {
+    profile->sample_types = {{"inuse_objects", "count"},
+                             {"inuse_space", "bytes"}};
+  }
+  profile->period_type = "space";
+  profile->period_unit = "bytes";
+  profile->period = rate;
+
+  std::string maps;
+  bool in_maps = false;
+  Profile_sample *current = nullptr;
+  while (std::getline(stream, line)) {
+    if (in_maps) {
+      maps += line;
+      maps += '\n';
+      continue;
+    }
+    if (line.compare(0, 17, "MAPPED_LIBRARIES:") == 0 ||
+        line.compare(0, 20, "--- Memory map: ---") == 0) {
+      in_maps = true;
+      continue;
+    }
+
+    long long inuse_count, inuse_bytes, alloc_count, alloc_bytes;
+    if (jemalloc) {
+      if (line.compare(0, 1, "@") == 0) {
+        profile->samples.emplace_back();
+        current = &profile->samples.back();
+        parse_pcs(line.c_str() + 1, &current->pcs);
+      } else if (current != nullptr &&
+                 sscanf(line.c_str(), " t*: %lld: %lld [%lld: %lld]",
+                        &inuse_count, &inuse_bytes, &alloc_count,
+                        &alloc_bytes) == 4) {
+        int64_t ic = inuse_count, ib = inuse_bytes;
+        int64_t ac = alloc_count, ab = alloc_bytes;
+        unsample(rate, &ic, &ib);
+        unsample(rate, &ac, &ab);
+        current->values = {ac, ab, ic, ib};
+        current = nullptr;
+      }
+      continue;
+    }
+
+    int pcs_pos = 0;
+    if (sscanf(line.c_str(), " %lld: %lld [ %lld: %lld] @%n", &inuse_count,
+               &inuse_bytes, &alloc_count, &alloc_bytes, &pcs_pos) < 4 ||
+        pcs_pos == 0)
+      continue;
+    Profile_sample sample;
+    parse_pcs(line.c_str() + pcs_pos, &sample.pcs);
+    int64_t ic = inuse_count, ib = inuse_bytes;
+    if (full) {
+      sample.values = {alloc_count, alloc_bytes, ic, ib};
+    } else {
+      unsample(rate, &ic, &ib);
+      sample.values = {ic, ib};
+    }
+    profile->samples.push_back(std::move(sample));
+  }
+
+  // jemalloc stacks without any per-stack counters are dropped
+  if (jemalloc) {
+    std::vector<Profile_sample> kept;
+    for (auto& sample : profile->samples)
+      if (!sample.values.empty()) kept.push_back(std::move(sample));
+    profile->samples.swap(kept);
+  }
+
+  parse_mapped_libraries(maps, &profile->mappings);
+  return true;
+}
+
+bool parse_profile(const char *data, size_t length, Profile_data *profile) {
+  if (length >= 2 * sizeof(uintptr_t)) {
+    uintptr_t header[2];
+    memcpy(header, data, sizeof(header));
+    if (header[0] == 0 && header[1] == 3)
+      return parse_cpu_profile(data, length, profile);
+  }
+  return parse_heap_profile(data, length, profile);
+}
+
+void encode_pprof_proto(const Profile_data& profile, std::string *output) {
+  Proto_writer out;
+  String_table strings;
+
+  for (const auto& type : profile.sample_types) {
+    Proto_writer value_type;
+    value_type.int64(1, strings.index(type.first));
+    value_type.int64(2, strings.index(type.second));
+    out.message(PROFILE_SAMPLE_TYPE, value_type);
+  }
+
+  // Mappings: ids follow the order of the regions
+  for (size_t i = 0; i < profile.mappings.size(); i++) {
+    const Mapped_region& region = profile.mappings[i];
+    Proto_writer mapping;
+    mapping.uint64(1, i + 1);
+    mapping.uint64(2, region.start);
+    mapping.uint64(3, region.limit);
+    mapping.uint64(4, region.offset);
+    mapping.int64(5, strings.index(region.filename));
+    mapping.int64(6, strings.index(get_build_id(region.filename)));
+    mapping.boolean(7, !region.filename.empty() && region.filename[0] == '/');
+    out.message(PROFILE_MAPPING, mapping);
+  }
+
+  // Locations and functions, one location per distinct address. The first
+  // frame of a cpu sample is the interrupted instruction, the others are
+  // return addresses whose call is the instruction before: the same address
+  // can need both.
+  std::unordered_map<uint64_t, uint64_t> location_ids;
+  std::unordered_map<uint64_t, uint64_t> leaf_location_ids;
+  std::unordered_map<std::string, uint64_t> function_ids;
+  Proto_writer locations;
+  Proto_writer functions;
+
+  for (const Profile_sample& sample : profile.samples) {
+    std::vector<uint64_t> ids;
+    for (size_t frame = 0; frame < sample.pcs.size(); frame++) {
+      uint64_t pc = sample.pcs[frame];
+      bool leaf = frame == 0 && profile.kind == "cpu";
+      std::unordered_map<uint64_t, uint64_t>& ids_by_pc =
+          leaf ? leaf_location_ids : location_ids;
+      auto it = ids_by_pc.find(pc);
+      if (it != ids_by_pc.end()) {
+        ids.push_back(it->second);
+        continue;
+      }
+      uint64_t location_id = location_ids.size() + leaf_location_ids.size() + 1;
+      ids_by_pc[pc] = location_id;
+      ids.push_back(location_id);
+
+      Proto_writer location;
+      location.uint64(1, location_id);
+      for (size_t m = 0; m < profile.mappings.size(); m++) {
+        if (pc >= profile.mappings[m].start && pc < profile.mappings[m].limit) {
+          location.uint64(2, m + 1);
+          break;
+        }
+      }
+      location.uint64(3, pc);
+
+      std::string name, filename;
+      if (symbolize_address(profile.mappings, leaf || pc == 0 ? pc : pc - 1,
+                            &name, &filename)) {
+        auto fit = function_ids.find(name);
+        uint64_t function_id;
+        if (fit == function_ids.end()) {
+          function_id = function_ids.size() + 1;
+          function_ids[name] = function_id;
+          Proto_writer function;
+          function.uint64(1, function_id);
+          function.int64(2, strings.index(name));
+          function.int64(3, strings.index(name));
+          function.int64(4, strings.index(filename));
+          functions.message(PROFILE_FUNCTION, function);
+        } else {
+          function_id = fit->second;
+        }
+        Proto_writer line;
+        line.uint64(1, function_id);
+        location.message(4, line);
+      }
+      locations.message(PROFILE_LOCATION, location);
+    }
+
+    Proto_writer s;
+    s.packed(1, ids);
+    s.packed(2, sample.values);
+    out.message(PROFILE_SAMPLE, s);
+  }
+
+  out.data() += locations.data();
+  out.data() += functions.data();
+
+  for (const std::string& s : strings.strings()) out.bytes(PROFILE_STRING_TABLE, s);
+
+  out.int64(PROFILE_TIME_NANOS, profile.time_nanos);
+  Proto_writer period_type;
+  period_type.int64(1, strings.index(profile.period_type));
+  period_type.int64(2, strings.index(profile.period_unit));
+  out.message(PROFILE_PERIOD_TYPE, period_type);
+  out.int64(PROFILE_PERIOD, profile.period);
+
+  output->swap(out.data());
+}
+
+bool export_pprof(const std::string& dump_file, const std::string& output_file,
+                  std::string *message) {
+  Mapped_dump_file data;
+  if (!data.open(dump_file)) {
+    *message = "could not read " + dump_file;
+    return false;
+  }
+
+  Profile_data profile;
+  if (!parse_profile(data.data(), data.size(), &profile)) {
+    *message = dump_file + " is not a cpu or heap profile.";
+    return false;
+  }
+  // Dumps always come from this server, use our own memory map if the dump
+  // doesn't have one
+  if (profile.mappings.empty()) read_self_mappings(&profile.mappings);
+
+  struct stat st;
+  if (stat_dump_file(dump_file, &st))
+    profile.time_nanos = static_cast<int64_t>(st.st_mtime) * 1000000000LL;
+
+  std::string proto, compressed;
+  encode_pprof_proto(profile, &proto);
+  if (!gzip_buffer(proto, &compressed)) {
+    *message = "could not compress the profile.";
+    return false;
+  }
+  if (!write_dump_file(output_file, compressed)) {
+    *message = "could not write " + output_file;
+    return false;
+  }
+
+  std::ostringstream summary;
+  summary << profile.kind << " profile exported to " << output_file << " ("
+          << profile.samples.size() << " samples, " << compressed.size()
+          << " bytes)";
+  *message = summary.str();
+  return true;
+}
+
+void summarize_heap_sites(const Profile_data& profile, size_t max_sites,
+                          std::vector<Heap_site> *sites) {
+  std::vector<Mapped_region> regions = profile.mappings;
+  if (regions.empty()) read_self_mappings(&regions);
+
+  // The same addresses come back in most stacks, the allocator frames are
+  // cached as empty names
+  std::map<uint64_t, std::string> frames;
+  std::map<std::string, Heap_site> by_site;
+  for (const Profile_sample& sample : profile.samples) {
+    if (sample.values.size() < 2) continue;
+    std::string site;
+    for (uint64_t pc : sample.pcs) {
+      auto it = frames.find(pc);
+      if (it == frames.end()) {
+        std::string function, filename;
+        if (!symbolize_address(regions, pc > 0 ? pc - 1 : 0, &function,
+                               &filename))
+          function = symbolize(regions, pc);
+        if (is_allocator_frame(filename, function)) function.clear();
+        it = frames.emplace(pc, function).first;
+      }
+      if (!it->second.empty()) {
+        site = it->second;
+        break;
+      }
+    }
+    if (site.empty()) site = "(unknown)";
+    // The in-use objects and bytes are the last two values of both layouts
+    Heap_site& usage = by_site[site];
+    usage.site = site;
+    usage.objects += sample.values[sample.values.size() - 2];
+    usage.bytes += sample.values.back();
+  }
+
+  size_t first = sites->size();
+  for (auto& site : by_site) sites->push_back(std::move(site.second));
+  std::sort(sites->begin() + first, sites->end(),
+            [](const Heap_site& a, const Heap_site& b) {
+              return a.bytes > b.bytes;
+            });
+  if (sites->size() - first > max_sites) {
+    Heap_site other;
+    other.site = "(other)";
+    for (size_t i = first + max_sites; i < sites->size(); i++) {
+      other.bytes += (*sites)[i].bytes;
+      other.objects += (*sites)[i].objects;
+    }
+    sites->resize(first + max_sites);
+    sites->push_back(other);
+  }
+}
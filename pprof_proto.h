@@ -0,0 +1,84 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#ifndef PROFILER_PPROF_PROTO_H
+#define PROFILER_PPROF_PROTO_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "symbolizer.h"
+
+struct Profile_sample {
+  std::vector<uint64_t> pcs;
+  std::vector<int64_t> values;
+};
+
+// Content of a legacy gperftools/jemalloc dump, allocator independent
+struct Profile_data {
+  std::string kind;  // "cpu" or "memory"
+  // (type, unit) of each value of the samples
+  std::vector<std::pair<std::string, std::string>> sample_types;
+  std::string period_type;
+  std::string period_unit;
+  int64_t period = 0;
+  int64_t time_nanos = 0;
+  std::vector<Profile_sample> samples;
+  std::vector<Mapped_region> mappings;
+};
+
+// Legacy binary CPU profile written by ProfilerStart()/ProfilerStop()
+extern bool parse_cpu_profile(const char* data, size_t length,
+                              Profile_data* profile);
+// Text heap profile written by tcmalloc (heap profiler, heap sample, growth
+// stacks) or by jemalloc (heap_v2)
+extern bool parse_heap_profile(const char* data, size_t length,
+                               Profile_data* profile);
+// Detect the format and parse the dump
+extern bool parse_profile(const char* data, size_t length,
+                          Profile_data* profile);
+
+// In-use memory of an allocation site: the first frame of the stacks outside
+// of the allocator
+struct Heap_site {
+  std::string site;
+  int64_t bytes = 0;
+  int64_t objects = 0;
+};
+
+// Sum the in-use memory of a heap profile by site, largest first. Past
+// max_sites the smaller ones are summed in a last "(other)" site.
+extern void summarize_heap_sites(const Profile_data& profile, size_t max_sites,
+                                 std::vector<Heap_site>* sites);
+
+// Serialize a profile in the profile.proto format used by pprof, with the
+// mappings, locations and functions embedded
+extern void encode_pprof_proto(const Profile_data& profile,
+                               std::string* output);
+
+// Convert a dump file into a gzipped profile.proto file, message contains the
+// error or a summary of what was written
+extern bool export_pprof(const std::string& dump_file,
+                         const std::string& output_file, std::string* message);
+
+#endif /* PROFILER_PPROF_PROTO_H */
@@ -26,6 +26,17 @@
 #include "profiler.h"
 #include "profiler_pfs.h"
 #include "profiler_service.h"
+#include "profiler_dumps.h"
+#include "profiler_dump_files.h"
+#include "dump_catalog.h"
+#include "dump_store.h"
+#include "dump_io.h"
+#include "heap_timeline.h"
+#include "schedule.h"
+
+#include <cerrno>
+#include <climits>
+#include <vector>
 
 REQUIRES_SERVICE_PLACEHOLDER(log_builtins);
 REQUIRES_SERVICE_PLACEHOLDER(log_builtins_string);
@@ -59,6 +70,14 @@ static const char *DEFAULT_PPROF_PATH = "/usr/bin/pprof";
 static char *memprof_dump_path_value;
 // Buffer for the value of the memprof.pprof_path global variable
 static char *pprof_path_value;
+static const char *DEFAULT_DUMP_COMPRESSION = "NONE";
+// Buffer for the value of the profiler.dump_compression global variable
+static char *dump_compression_value;
+static const char *DEFAULT_DUMP_STORE = DUMP_STORE_DISK;
+// Buffer for the value of the profiler.dump_store global variable
+static char *dump_store_value;
+// Buffer for the value of the profiler.schedule global variable
+static char *schedule_value;
 
 class udf_list {
   typedef std::list<std::string> udf_list_t;
@@ -101,24 +120,6 @@ class udf_list {
   udf_list_t set;
 } *list;
 
-bool remove_files_with_prefix(const std::string& directory, const std::string& prefix) {
-    namespace fs = std::filesystem;
-
-    try {
-        for (const auto& entry : fs::directory_iterator(directory)) {
-            if (entry.is_regular_file() && entry.path().filename().string().find(prefix) == 0) {
-                fs::remove(entry.path());
-            }
-        }
-    } catch (const fs::filesystem_error& e) {
-        mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
-                                    ER_UDF_ERROR, 0, "profiler",
-                                    "Error while deleting files.");
-        return false; 
-    }
-    return true;
-}
-
 static int memprof_dump_path_check(MYSQL_THD thd,
                                        SYS_VAR *self MY_ATTRIBUTE((unused)),
                                        void *save,
@@ -167,6 +168,9 @@ static void memprof_dump_path_update(MYSQL_THD, SYS_VAR *, void *var_ptr,
                           const void *save) {
   *(const char **)var_ptr =
       *(static_cast<const char **>(const_cast<void *>(save)));
+  // The dumps of the new prefix written by the previous runs
+  if (memprof_dump_path_value)
+    dump_catalog_open_journal(memprof_dump_path_value);
 }
 
 static int pprof_path_check(MYSQL_THD thd,
@@ -219,6 +223,134 @@ static void pprof_path_update(MYSQL_THD, SYS_VAR *, void *var_ptr,
       *(static_cast<const char **>(const_cast<void *>(save)));
 }
 
+static int dump_compression_check(MYSQL_THD thd,
+                                  SYS_VAR *self MY_ATTRIBUTE((unused)),
+                                  void *save,
+                                  struct st_mysql_value *value) {
+  if (!check_variable_privilege(thd, "profiler.dump_compression"))
+    return (ER_SPECIFIC_ACCESS_DENIED_ERROR);
+
+  int value_len = 0;
+  const char *new_value = value->val_str(value, nullptr, &value_len);
+  if (parse_dump_compression(new_value) < 0) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "wrong value it must be 'NONE', 'GZIP' or 'ZLIB'.");
+    return true;
+  }
+
+  // Save the string value
+  *static_cast<const char **>(save) = new_value;
+
+  return (0);
+}
+
+static void dump_compression_update(MYSQL_THD, SYS_VAR *, void *var_ptr,
+                          const void *save) {
+  *(const char **)var_ptr =
+      *(static_cast<const char **>(const_cast<void *>(save)));
+  dump_compression.store(parse_dump_compression(*(const char **)var_ptr));
+}
+
+static int dump_store_check(MYSQL_THD thd,
+                            SYS_VAR *self MY_ATTRIBUTE((unused)),
+                            void *save,
+                            struct st_mysql_value *value) {
+  if (!check_variable_privilege(thd, "profiler.dump_store"))
+    return (ER_SPECIFIC_ACCESS_DENIED_ERROR);
+
+  int value_len = 0;
+  const char *new_value = value->val_str(value, nullptr, &value_len);
+  if (new_value == nullptr ||
+      (strcasecmp(new_value, DUMP_STORE_DISK) != 0 &&
+       strcasecmp(new_value, DUMP_STORE_MEMORY) != 0)) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "wrong value it must be 'DISK' or 'MEMORY'.");
+    return true;
+  }
+
+  // Save the string value
+  *static_cast<const char **>(save) = new_value;
+
+  return (0);
+}
+
+static void dump_store_update(MYSQL_THD, SYS_VAR *, void *var_ptr,
+                          const void *save) {
+  *(const char **)var_ptr =
+      *(static_cast<const char **>(const_cast<void *>(save)));
+  dump_store_in_memory.store(
+      strcasecmp(*(const char **)var_ptr, DUMP_STORE_MEMORY) == 0);
+}
+
+static int dump_store_max_bytes_check(MYSQL_THD thd,
+                                      SYS_VAR *self MY_ATTRIBUTE((unused)),
+                                      void *save,
+                                      struct st_mysql_value *value) {
+  return check_unsigned_value(thd, "profiler.dump_store_max_bytes", "bytes",
+                              save, value);
+}
+
+static void dump_store_max_bytes_update(MYSQL_THD, SYS_VAR *, void *var_ptr,
+                          const void *save) {
+  *static_cast<unsigned long long *>(var_ptr) =
+      *static_cast<const unsigned long long *>(save);
+}
+
+static int dump_max_bytes_check(MYSQL_THD thd,
+                                SYS_VAR *self MY_ATTRIBUTE((unused)),
+                                void *save, struct st_mysql_value *value) {
+  return check_unsigned_value(thd, "profiler.dump_max_bytes", "bytes", save,
+                              value);
+}
+
+static int dump_max_files_check(MYSQL_THD thd,
+                                SYS_VAR *self MY_ATTRIBUTE((unused)),
+                                void *save, struct st_mysql_value *value) {
+  return check_unsigned_value(thd, "profiler.dump_max_files", "files", save,
+                              value);
+}
+
+// The new quota is applied right away
+static void dump_quota_update(MYSQL_THD, SYS_VAR *, void *var_ptr,
+                              const void *save) {
+  *static_cast<unsigned long long *>(var_ptr) =
+      *static_cast<const unsigned long long *>(save);
+  request_dump_retention();
+}
+
+// The runs are started by the cpu and memory components, only the syntax is
+// checked here
+static int schedule_check(MYSQL_THD thd, SYS_VAR *self MY_ATTRIBUTE((unused)),
+                          void *save, struct st_mysql_value *value) {
+  if (!check_variable_privilege(thd, "profiler.schedule"))
+    return (ER_SPECIFIC_ACCESS_DENIED_ERROR);
+
+  int value_len = 0;
+  const char *new_value = value->val_str(value, nullptr, &value_len);
+  std::vector<Profile_schedule_entry> entries;
+  std::string error;
+  if (new_value == nullptr) error = "wrong value, use '' to disable the schedule.";
+  if (!error.empty() || !parse_profile_schedule(new_value, &entries, &error)) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler", "%s",
+                                    error.c_str());
+    return true;
+  }
+
+  // Save the string value
+  *static_cast<const char **>(save) = new_value;
+
+  return (0);
+}
+
+static void schedule_update(MYSQL_THD, SYS_VAR *, void *var_ptr,
+                            const void *save) {
+  *(const char **)var_ptr =
+      *(static_cast<const char **>(const_cast<void *>(save)));
+}
+
 namespace udf_impl {
 
 const char *udf_init = "udf_init", *my_udf = "my_udf",
@@ -248,11 +380,27 @@ const char *profiler_cleanup_udf(UDF_INIT *, UDF_ARGS *, char *outp,
   
   *error = 0;
   *is_null = 0;
-  std::filesystem::path p(memprof_dump_path_value);
-  if(remove_files_with_prefix(p.parent_path().string(), p.filename().string())) {
-    strcpy(outp, "Profiling data matching has been cleaned up.");
-    snprintf(outp, 500, "Profiling data matching %s prefix has been cleaned up.", memprof_dump_path_value);
+  // The catalog knows the dumps of the previous runs from its journal, the
+  // directory isn't scanned
+  std::vector<std::string> paths;
+  dump_catalog_remove_prefix(memprof_dump_path_value, &paths);
+  dump_store_remove_prefix(memprof_dump_path_value);
+  bool removed = true;
+  for (const std::string& path : paths) {
+    remove_heap_timeline(path);
+    for (int compression : {DUMP_COMPRESSION_NONE, DUMP_COMPRESSION_GZIP,
+                            DUMP_COMPRESSION_ZLIB}) {
+      std::string file = path + dump_compression_suffix(compression);
+      if (unlink(file.c_str()) != 0 && errno != ENOENT) removed = false;
+    }
+  }
+  if (removed) {
+    snprintf(outp, 500, "Profiling data matching %s prefix has been cleaned up (%zu files).",
+             memprof_dump_path_value, paths.size());
   } else {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "Error while deleting files.");
     strcpy(outp, "Error while cleaning up profiling data.");
   }
 
@@ -261,6 +409,215 @@ const char *profiler_cleanup_udf(UDF_INIT *, UDF_ARGS *, char *outp,
   return const_cast<char *>(outp);
 }
 
+// UDF to convert a dump into a gzipped profile.proto file
+
+static bool profiler_export_udf_init(UDF_INIT *initid, UDF_ARGS *args, char *) {
+  if (args->arg_count != 2 || args->arg_type[0] != STRING_RESULT ||
+      args->arg_type[1] != STRING_RESULT) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "this function requires 2 parameters: <dump_file>, <'pb'>");
+    return true;
+  }
+  const char* name = "utf8mb4";
+  char *value = const_cast<char*>(name);
+  initid->ptr = const_cast<char *>(udf_init);
+  if (mysql_service_mysql_udf_metadata->result_set(
+          initid, "charset",
+          const_cast<char *>(value))) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG, "failed to set result charset");
+    return false;
+  }
+  return false;
+}
+
+static void profiler_export_udf_deinit(__attribute__((unused))
+                                       UDF_INIT *initid) {
+  assert(initid->ptr == udf_init || initid->ptr == my_udf);
+}
+
+const char *profiler_export_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
+                                unsigned long *length, char *is_null,
+                                char *error) {
+  *error = 0;
+  *is_null = 0;
+
+  MYSQL_THD thd;
+
+  mysql_service_mysql_current_thread_reader->get(&thd);
+  if (!have_required_privilege(thd))
+  {
+    mysql_error_service_printf(
+        ER_SPECIFIC_ACCESS_DENIED_ERROR, 0,
+        PRIVILEGE_NAME);
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  if (args->args[0] == nullptr || args->args[1] == nullptr) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "this function requires 2 parameters: <dump_file>, <'pb'>");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  std::string format(args->args[1], args->lengths[1]);
+  if (strcasecmp(format.c_str(), "PB") != 0) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "wrong parameter it must be 'PB'.");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  // A file name without directory is looked up where the dumps are written
+  std::string dump_file(args->args[0], args->lengths[0]);
+  if (dump_file.find('/') == std::string::npos) {
+    std::filesystem::path p(memprof_dump_path_value);
+    dump_file = (p.parent_path() / dump_file).string();
+  }
+  if (!dump_file_exists(dump_file)) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "The dump file does not exist.");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  std::string buf;
+  std::string output_file = strip_compression_suffix(dump_file) + ".pb.gz";
+  if (!export_pprof(dump_file, output_file, &buf)) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "%s", buf.c_str());
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  outp = (char *)malloc(buf.length() + 1);
+  if (outp == nullptr) {
+      *error = 1;
+      *is_null = 1;
+      return nullptr;
+  }
+  addProfiler_element(time(nullptr), output_file, "profile", "profiler",
+                      "exported", "pb");
+  dump_catalog_event("profile", "profiler", "exported", output_file);
+  dump_store_complete(output_file, "profile", "profiler");
+
+  strcpy(outp, buf.c_str());
+  *length = strlen(outp);
+
+  return const_cast<char *>(outp);
+}
+
+// UDF to copy a dump kept in memory to a file
+
+static bool profiler_persist_udf_init(UDF_INIT *initid, UDF_ARGS *args, char *) {
+  if (args->arg_count != 2 || args->arg_type[0] != STRING_RESULT ||
+      args->arg_type[1] != STRING_RESULT) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "this function requires 2 parameters: <dump_file>, <destination>");
+    return true;
+  }
+  const char* name = "utf8mb4";
+  char *value = const_cast<char*>(name);
+  initid->ptr = const_cast<char *>(udf_init);
+  if (mysql_service_mysql_udf_metadata->result_set(
+          initid, "charset",
+          const_cast<char *>(value))) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG, "failed to set result charset");
+    return false;
+  }
+  return false;
+}
+
+static void profiler_persist_udf_deinit(__attribute__((unused))
+                                       UDF_INIT *initid) {
+  assert(initid->ptr == udf_init || initid->ptr == my_udf);
+}
+
+const char *profiler_persist_udf(UDF_INIT *, UDF_ARGS *args, char *outp,
+                                unsigned long *length, char *is_null,
+                                char *error) {
+  *error = 0;
+  *is_null = 0;
+
+  MYSQL_THD thd;
+
+  mysql_service_mysql_current_thread_reader->get(&thd);
+  if (!have_required_privilege(thd))
+  {
+    mysql_error_service_printf(
+        ER_SPECIFIC_ACCESS_DENIED_ERROR, 0,
+        PRIVILEGE_NAME);
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  if (args->args[0] == nullptr || args->args[1] == nullptr) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "this function requires 2 parameters: <dump_file>, <destination>");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  // A file name without directory is looked up where the dumps are written
+  std::string dump_file(args->args[0], args->lengths[0]);
+  if (dump_file.find('/') == std::string::npos) {
+    std::filesystem::path p(memprof_dump_path_value);
+    dump_file = (p.parent_path() / dump_file).string();
+  }
+  std::string destination(args->args[1], args->lengths[1]);
+  if (!parentDirectoryExists(destination)) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "we don't have access to write in that folder.");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  uint64_t size = 0;
+  if (!dump_store_contains(dump_file)) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "The dump file is not kept in memory.");
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+  if (!dump_store_persist(dump_file, destination, &size)) {
+    mysql_error_service_emit_printf(mysql_service_mysql_runtime_error,
+                                    ER_UDF_ERROR, 0, "profiler",
+                                    "could not write %s", destination.c_str());
+    *error = 1;
+    *is_null = 1;
+    return 0;
+  }
+
+  char extra[100];
+  snprintf(extra, sizeof(extra), "%llu bytes", (unsigned long long)size);
+  addProfiler_element(time(nullptr), destination, "profile", "profiler",
+                      "persist", extra);
+  dump_catalog_event("profile", "profiler", "persist", destination);
+
+  snprintf(outp, 255, "%llu bytes persisted", (unsigned long long)size);
+  *length = strlen(outp);
+
+  return const_cast<char *>(outp);
+}
+
 } /* namespace udf_impl */
 
 static mysql_service_status_t profiler_service_init() {
@@ -271,11 +628,35 @@ static mysql_service_status_t profiler_service_init() {
 
   STR_CHECK_ARG(str) memprof_dump_path_arg;
   STR_CHECK_ARG(str1) pprof_path_arg;
+  STR_CHECK_ARG(str2) dump_compression_arg;
+  STR_CHECK_ARG(str3) dump_store_arg;
+  STR_CHECK_ARG(str4) schedule_arg;
+  INTEGRAL_CHECK_ARG(ulonglong) dump_store_max_bytes_arg;
+  INTEGRAL_CHECK_ARG(ulonglong) dump_max_bytes_arg;
+  INTEGRAL_CHECK_ARG(ulonglong) dump_max_files_arg;
 
   memprof_dump_path_arg.def_val = const_cast<char*>(DEFAULT_MEMPROF_DUMP_PATH);
   memprof_dump_path_value = nullptr;
   pprof_path_arg.def_val = const_cast<char*>(DEFAULT_PPROF_PATH);
   pprof_path_value = nullptr;
+  dump_compression_arg.def_val = const_cast<char*>(DEFAULT_DUMP_COMPRESSION);
+  dump_compression_value = nullptr;
+  dump_store_arg.def_val = const_cast<char*>(DEFAULT_DUMP_STORE);
+  dump_store_value = nullptr;
+  schedule_arg.def_val = const_cast<char*>("");
+  schedule_value = nullptr;
+  dump_store_max_bytes_arg.def_val = 256ULL * 1024 * 1024;
+  dump_store_max_bytes_arg.min_val = 0;
+  dump_store_max_bytes_arg.max_val = ULLONG_MAX;
+  dump_store_max_bytes_arg.blk_sz = 0;
+  dump_max_bytes_arg.def_val = 0;
+  dump_max_bytes_arg.min_val = 0;
+  dump_max_bytes_arg.max_val = ULLONG_MAX;
+  dump_max_bytes_arg.blk_sz = 0;
+  dump_max_files_arg.def_val = 0;
+  dump_max_files_arg.min_val = 0;
+  dump_max_files_arg.max_val = ULLONG_MAX;
+  dump_max_files_arg.blk_sz = 0;
 
   //Todo check is thre is a value already if not set the default
 
@@ -293,6 +674,26 @@ static mysql_service_status_t profiler_service_init() {
   LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
                     "new UDF 'profiler_cleanup()' has been registered successfully.");
 
+  if (list->add_scalar("PROFILER_EXPORT", Item_result::STRING_RESULT,
+                       (Udf_func_any)udf_impl::profiler_export_udf,
+                       udf_impl::profiler_export_udf_init,
+                       udf_impl::profiler_export_udf_deinit)) {
+    delete list;
+    return 1; /* failure: one of the UDF registrations failed */
+  }
+  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new UDF 'profiler_export()' has been registered successfully.");
+
+  if (list->add_scalar("PROFILER_PERSIST", Item_result::STRING_RESULT,
+                       (Udf_func_any)udf_impl::profiler_persist_udf,
+                       udf_impl::profiler_persist_udf_init,
+                       udf_impl::profiler_persist_udf_deinit)) {
+    delete list;
+    return 1; /* failure: one of the UDF registrations failed */
+  }
+  LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new UDF 'profiler_persist()' has been registered successfully.");
+
 
   // Registration of the global system variable
   if (mysql_service_component_sys_variable_register->register_variable(
@@ -323,10 +724,114 @@ static mysql_service_status_t profiler_service_init() {
                     "new variable 'profiler.pprof_binary' has been registered successfully.");
   }
 
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "dump_compression",
+          PLUGIN_VAR_STR | PLUGIN_VAR_RQCMDARG | PLUGIN_VAR_MEMALLOC,
+          "Compression of the finished dump files: NONE, GZIP or ZLIB",
+          dump_compression_check, dump_compression_update,
+          (void *)&dump_compression_arg, (void *)&dump_compression_value)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.dump_compression'.");
+    result = 1;
+  } else {
+    // The value may come from the command line, bypassing the update function
+    int compression = parse_dump_compression(dump_compression_value);
+    dump_compression.store(compression < 0 ? DUMP_COMPRESSION_NONE : compression);
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.dump_compression' has been registered successfully.");
+  }
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "dump_store",
+          PLUGIN_VAR_STR | PLUGIN_VAR_RQCMDARG | PLUGIN_VAR_MEMALLOC,
+          "Where the dumps are written: DISK under profiler.dump_path or MEMORY",
+          dump_store_check, dump_store_update,
+          (void *)&dump_store_arg, (void *)&dump_store_value)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.dump_store'.");
+    result = 1;
+  } else {
+    dump_store_in_memory.store(dump_store_value != nullptr &&
+                               strcasecmp(dump_store_value, DUMP_STORE_MEMORY) == 0);
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.dump_store' has been registered successfully.");
+  }
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "dump_store_max_bytes",
+          PLUGIN_VAR_LONGLONG | PLUGIN_VAR_UNSIGNED | PLUGIN_VAR_RQCMDARG,
+          "Memory used by the dumps kept in memory, the least recently used are evicted",
+          dump_store_max_bytes_check, dump_store_max_bytes_update,
+          (void *)&dump_store_max_bytes_arg, (void *)&dump_store_max_bytes)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.dump_store_max_bytes'.");
+    result = 1;
+  } else {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.dump_store_max_bytes' has been registered successfully.");
+  }
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "dump_max_bytes",
+          PLUGIN_VAR_LONGLONG | PLUGIN_VAR_UNSIGNED | PLUGIN_VAR_RQCMDARG,
+          "Disk space used by the finished dumps, the oldest are evicted (0 = unlimited)",
+          dump_max_bytes_check, dump_quota_update,
+          (void *)&dump_max_bytes_arg, (void *)&dump_max_bytes)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.dump_max_bytes'.");
+    result = 1;
+  } else {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.dump_max_bytes' has been registered successfully.");
+  }
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "dump_max_files",
+          PLUGIN_VAR_LONGLONG | PLUGIN_VAR_UNSIGNED | PLUGIN_VAR_RQCMDARG,
+          "Number of finished dumps kept, the oldest are evicted (0 = unlimited)",
+          dump_max_files_check, dump_quota_update,
+          (void *)&dump_max_files_arg, (void *)&dump_max_files)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.dump_max_files'.");
+    result = 1;
+  } else {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.dump_max_files' has been registered successfully.");
+  }
+
+  if (mysql_service_component_sys_variable_register->register_variable(
+          "profiler", "schedule",
+          PLUGIN_VAR_STR | PLUGIN_VAR_RQCMDARG | PLUGIN_VAR_MEMALLOC,
+          "Daily profiling runs: [days] HH:MM duration cpu|memory [every=interval], separated by ';'",
+          schedule_check, schedule_update,
+          (void *)&schedule_arg, (void *)&schedule_value)) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                    "could not register new variable 'profiler.schedule'.");
+    result = 1;
+  } else {
+    // The value may come from the configuration file, bypassing the check
+    std::vector<Profile_schedule_entry> entries;
+    std::string error;
+    if (!parse_profile_schedule(schedule_value, &entries, &error))
+      LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                      ("profiler.schedule is ignored, " + error).c_str());
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                    "new variable 'profiler.schedule' has been registered successfully.");
+  }
+
+  set_dump_store_locators(dump_store_open, dump_store_create);
+
+  init_dump_catalog();
+  if (memprof_dump_path_value) dump_catalog_open_journal(memprof_dump_path_value);
+  init_dump_worker();
+
   mysql_mutex_init(key_mutex_profiler_data, &LOCK_profiler_data, nullptr);
   init_profiler_share(&profiler_st_share);
   init_profiler_data();
+  init_dump_files_share(&dump_files_st_share);
   share_list[0] = &profiler_st_share;
+  share_list[1] = &dump_files_st_share;
+  share_list[2] = init_snapshot_share<&heap_timeline_table>();
   if (mysql_service_pfs_plugin_table_v1->add_tables(&share_list[0], 
                                                  share_list_count)) {
     LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
@@ -344,10 +849,15 @@ static mysql_service_status_t profiler_service_init() {
 static mysql_service_status_t profiler_service_deinit() {
   mysql_service_status_t result = 0;
 
-  cleanup_profiler_data();
-
   if (list->unregister()) return 1; /* failure: some UDFs still in use */
 
+  deinit_dump_worker();
+  set_dump_store_locators(nullptr, nullptr);
+  dump_store_clear();
+  dump_catalog_clear();
+  clear_heap_timeline();
+  cleanup_profiler_data();
+
   delete list;
 
   if (mysql_service_component_sys_variable_unregister->unregister_variable(
@@ -369,6 +879,30 @@ static mysql_service_status_t profiler_service_deinit() {
               "variable 'profiler.pprof_binary' is now unregistered successfully.");
   }
 
+  if (mysql_service_component_sys_variable_unregister->unregister_variable(
+              "profiler", "dump_compression")) {
+    LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+              "could not unregister variable 'profiler.dump_compression'.");
+    return 1;
+  } else {
+    LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+              "variable 'profiler.dump_compression' is now unregistered successfully.");
+  }
+
+  for (const char *variable : {"dump_store", "dump_store_max_bytes",
+                               "dump_max_bytes", "dump_max_files",
+                               "schedule"}) {
+    if (mysql_service_component_sys_variable_unregister->unregister_variable(
+                "profiler", variable)) {
+      LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
+                (std::string("could not unregister variable 'profiler.") + variable + "'.").c_str());
+      return 1;
+    } else {
+      LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG,
+                (std::string("variable 'profiler.") + variable + "' is now unregistered successfully.").c_str());
+    }
+  }
+
   if (mysql_service_pfs_plugin_table_v1->delete_tables(&share_list[0],
                                                     share_list_count)) {
     LogComponentErr(ERROR_LEVEL, ER_LOG_PRINTF_MSG,
@@ -381,6 +915,9 @@ static mysql_service_status_t profiler_service_deinit() {
 
   memprof_dump_path_value = nullptr;
   pprof_path_value = nullptr;
+  dump_compression_value = nullptr;
+  dump_store_value = nullptr;
+  schedule_value = nullptr;
 
   LogComponentErr(INFORMATION_LEVEL, ER_LOG_PRINTF_MSG, "uninstalled.");
 
@@ -417,19 +954,62 @@ DEFINE_BOOL_METHOD(add, (const char* profiler_type, const char* profiler_allocat
 
   addProfiler_element(time(nullptr), profiler_filename, profiler_type,
                           profiler_allocator, profiler_action, profiler_extra);
+
+  // Heap dumps are complete once reported, cpu profiles when stopped
+  if (dump_catalog_event(profiler_type, profiler_allocator, profiler_action,
+                         profiler_filename))
+    queue_finished_dump(profiler_filename, profiler_type, profiler_allocator);
+
+  // Dumps kept in memory can only be evicted once the profiler is done
+  if (strcmp(profiler_action, "started") != 0)
+    dump_store_complete(profiler_filename, profiler_type, profiler_allocator);
+
+  return false;
+}
+
+static bool copy_location(const std::string& location, char *szOutLocation,
+                          size_t *inoutSize) {
+  if (location.empty() || *inoutSize < location.length() + 1) return true;
+  strcpy(szOutLocation, location.c_str());
+  *inoutSize = location.length();
   return false;
 }
 
+DEFINE_BOOL_METHOD(create_dump, (const char *szPath, int *outFd)) {
+  *outFd = dump_store_create(szPath);
+  return *outFd < 0;
+}
+
+DEFINE_BOOL_METHOD(find_dump, (const char *szPath, int *outFd)) {
+  *outFd = dump_store_open(szPath);
+  return *outFd < 0;
+}
+
 BEGIN_SERVICE_IMPLEMENTATION(profiler, profiler_var)
 get, END_SERVICE_IMPLEMENTATION();
 
 BEGIN_SERVICE_IMPLEMENTATION(profiler, profiler_pfs)
 add, END_SERVICE_IMPLEMENTATION();
 
+DEFINE_BOOL_METHOD(last_dump, (const char *szType, const char *szAllocator,
+                               char *szOutPath, size_t *inoutSize)) {
+  std::string path;
+  if (!dump_catalog_last(szType, szAllocator, &path)) return true;
+  return copy_location(path, szOutPath, inoutSize);
+}
+
+BEGIN_SERVICE_IMPLEMENTATION(profiler, profiler_dump_store)
+create_dump, find_dump, END_SERVICE_IMPLEMENTATION();
+
+BEGIN_SERVICE_IMPLEMENTATION(profiler, profiler_dump_catalog)
+last_dump, END_SERVICE_IMPLEMENTATION();
+
 
 BEGIN_COMPONENT_PROVIDES(profiler_service)
   PROVIDES_SERVICE(profiler, profiler_var),
   PROVIDES_SERVICE(profiler, profiler_pfs),
+  PROVIDES_SERVICE(profiler, profiler_dump_store),
+  PROVIDES_SERVICE(profiler, profiler_dump_catalog),
 END_COMPONENT_PROVIDES();
 
 BEGIN_COMPONENT_REQUIRES(profiler_service)
@@ -447,6 +1027,7 @@ BEGIN_COMPONENT_REQUIRES(profiler_service)
     REQUIRES_SERVICE(udf_registration),
     REQUIRES_SERVICE_AS(pfs_plugin_column_string_v2, pfs_string),
     REQUIRES_SERVICE_AS(pfs_plugin_column_timestamp_v2, pfs_timestamp),
+    REQUIRES_SERVICE_AS(pfs_plugin_column_bigint_v1, pfs_bigint),
 #if MYSQL_VERSION_ID >= 90000
     REQUIRES_SERVICE(mysql_system_variable_reader),
 #endif
@@ -24,6 +24,7 @@
 
 #include <mysql/components/services/pfs_plugin_table_service.h>
 #include "common.h"
+#include "pprof_proto.h"
 
 
 extern REQUIRES_SERVICE_PLACEHOLDER(pfs_plugin_table_v1);
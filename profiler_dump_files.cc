@@ -0,0 +1,140 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#include "profiler.h"
+#include "profiler_pfs.h"
+#include "profiler_dump_files.h"
+#include "dump_catalog.h"
+
+REQUIRES_SERVICE_PLACEHOLDER_AS(pfs_plugin_column_bigint_v1, pfs_bigint);
+
+/* Global share pointer for the table */
+PFS_engine_table_share_proxy dump_files_st_share;
+
+PSI_table_handle *dump_files_open_table(PSI_pos **pos) {
+  Dump_files_Table_Handle *temp = new Dump_files_Table_Handle();
+  dump_catalog_list(&temp->rows);
+  *pos = (PSI_pos *)(&temp->m_pos);
+  return (PSI_table_handle *)temp;
+}
+
+void dump_files_close_table(PSI_table_handle *handle) {
+  Dump_files_Table_Handle *temp = (Dump_files_Table_Handle *)handle;
+  delete temp;
+}
+
+int dump_files_rnd_next(PSI_table_handle *handle) {
+  Dump_files_Table_Handle *h = (Dump_files_Table_Handle *)handle;
+  h->m_pos.set_at(&h->m_next_pos);
+  size_t index = h->m_pos.get_index();
+
+  if (index < h->rows.size()) {
+    h->m_next_pos.set_after(&h->m_pos);
+    return 0;
+  }
+
+  return PFS_HA_ERR_END_OF_FILE;
+}
+
+int dump_files_rnd_init(PSI_table_handle *, bool) { return 0; }
+
+int dump_files_rnd_pos(PSI_table_handle *) { return 0; }
+
+void dump_files_reset_position(PSI_table_handle *handle) {
+  Dump_files_Table_Handle *h = (Dump_files_Table_Handle *)handle;
+  h->m_pos.reset();
+  h->m_next_pos.reset();
+}
+
+int dump_files_read_column_value(PSI_table_handle *handle, PSI_field *field,
+                                 unsigned int index) {
+  Dump_files_Table_Handle *h = (Dump_files_Table_Handle *)handle;
+  const Dump_entry& row = h->rows[h->m_pos.get_index()];
+
+  switch (index) {
+    case 0: /* FILENAME */
+      pfs_string->set_varchar_utf8mb4(field, row.path.c_str());
+      break;
+    case 1: /* STORE */
+      pfs_string->set_varchar_utf8mb4(field, row.in_memory ? "memory" : "disk");
+      break;
+    case 2: /* LOCATION */
+      pfs_string->set_varchar_utf8mb4(field, row.location.c_str());
+      break;
+    case 3: /* TYPE */
+      pfs_string->set_varchar_utf8mb4(field, row.type.c_str());
+      break;
+    case 4: /* ALLOCATOR */
+      pfs_string->set_varchar_utf8mb4(field, row.allocator.c_str());
+      break;
+    case 5: /* SIZE */
+      pfs_bigint->set_unsigned(field, {row.size, false});
+      break;
+    case 6: /* SAMPLES */
+      pfs_bigint->set(field, {row.samples, row.samples < 0});
+      break;
+    case 7: /* STARTED */
+      pfs_timestamp->set2(field, (row.started * 1000000));
+      break;
+    case 8: /* ENDED */
+      pfs_timestamp->set2(field, (row.ended * 1000000));
+      break;
+    case 9: /* BUILD_ID */
+      pfs_string->set_varchar_utf8mb4(field, row.build_id.c_str());
+      break;
+    default: /* We should never reach here */
+      assert(0);
+      break;
+  }
+  return 0;
+}
+
+unsigned long long dump_files_get_row_count(void) {
+  return dump_catalog_count();
+}
+
+void init_dump_files_share(PFS_engine_table_share_proxy *share) {
+  share->m_table_name = "profiler_dump_files";
+  share->m_table_name_length = 19;
+  share->m_table_definition =
+      "`FILENAME` VARCHAR(255), `STORE` VARCHAR(8), `LOCATION` VARCHAR(255), "
+      "`TYPE` VARCHAR(8), `ALLOCATOR` VARCHAR(10), `SIZE` BIGINT unsigned, "
+      "`SAMPLES` BIGINT, `STARTED` timestamp, `ENDED` timestamp, "
+      "`BUILD_ID` VARCHAR(40)";
+  share->m_ref_length = sizeof(Profiler_POS);
+  share->m_acl = READONLY;
+  share->get_row_count = dump_files_get_row_count;
+  share->delete_all_rows = nullptr; /* READONLY TABLE */
+
+  share->m_proxy_engine_table = {dump_files_rnd_next, dump_files_rnd_init,
+                                 dump_files_rnd_pos,
+                                 nullptr, nullptr, nullptr,
+                                 dump_files_read_column_value,
+                                 dump_files_reset_position,
+                                 /* READONLY TABLE */
+                                 nullptr, /* write_column_value */
+                                 nullptr, /* write_row_values */
+                                 nullptr, /* update_column_value */
+                                 nullptr, /* update_row_values */
+                                 nullptr, /* delete_row_values */
+                                 dump_files_open_table, dump_files_close_table};
+}
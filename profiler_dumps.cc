@@ -0,0 +1,277 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#define LOG_COMPONENT_TAG "profiler"
+
+#include "profiler.h"
+#include "profiler_dumps.h"
+#include "profiler_pfs.h"
+#include "dump_catalog.h"
+#include "dump_io.h"
+#include "heap_timeline.h"
+#include "pprof_proto.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+std::atomic<int> dump_compression{DUMP_COMPRESSION_NONE};
+unsigned long long dump_max_bytes = 0;
+unsigned long long dump_max_files = 0;
+
+// The quotas are also checked regularly, dumps can grow or be restored
+// behind our back
+static const std::chrono::seconds retention_interval(10);
+
+struct Dump_job {
+  std::string path;
+  std::string type;
+  std::string allocator;
+};
+
+static std::mutex dump_worker_mutex;
+static std::condition_variable dump_worker_cond;
+static std::deque<Dump_job> dump_jobs;
+static bool dump_worker_stopping = false;
+static bool dump_retention_requested = false;
+static std::thread dump_worker;
+
+// The catalog shows the number of samples and the heap dumps are summarized
+// for profiler_heap_timeline, the dump is read once here
+static void count_samples(const Dump_job& job) {
+  Mapped_dump_file dump;
+  Profile_data profile;
+  if (!dump.open(job.path) || !parse_profile(dump.data(), dump.size(), &profile))
+    return;
+  dump_catalog_set_samples(job.path, profile.samples.size());
+  if (profile.kind == "memory") index_heap_dump(job.path, profile);
+}
+
+// Returns the number of bytes saved
+static uint64_t compress_dump(const Dump_job& job) {
+  int compression = dump_compression.load();
+  if (compression == DUMP_COMPRESSION_NONE) return 0;
+  // Already compressed by the writer (asynchronous tcmalloc dumps)
+  if (strip_compression_suffix(job.path) != job.path) return 0;
+
+  std::string compressed_path;
+  uint64_t original_size = 0, compressed_size = 0;
+  if (!compress_dump_file(job.path, compression, &compressed_path,
+                          &original_size, &compressed_size)) {
+    LogComponentErr(WARNING_LEVEL, ER_LOG_PRINTF_MSG,
+                    ("failed to compress " + job.path).c_str());
+    return 0;
+  }
+
+  char extra[100];
+  snprintf(extra, sizeof(extra), "%s: %llu -> %llu bytes",
+           compression == DUMP_COMPRESSION_GZIP ? "gzip" : "zlib",
+           (unsigned long long)original_size,
+           (unsigned long long)compressed_size);
+  addProfiler_element(time(nullptr), compressed_path, job.type, job.allocator,
+                      "compress", extra);
+  return original_size > compressed_size ? original_size - compressed_size : 0;
+}
+
+// Uncataloged dumps modified more recently may still be written by
+// tcmalloc itself (HEAP_PROFILE_*_INTERVAL)
+static const int uncataloged_min_age = 2;
+
+// Keep the finished dumps on disk within profiler.dump_max_bytes and
+// profiler.dump_max_files. The finished dumps matching the profiler.dump_path
+// prefix are counted, with the ones left by a previous run, and the
+// cataloged dumps written under another prefix. The oldest are compressed
+// first when profiler.dump_compression is set, then deleted.
+static void enforce_dump_retention() {
+  unsigned long long max_bytes = dump_max_bytes;
+  unsigned long long max_files = dump_max_files;
+  if (max_bytes == 0 && max_files == 0) return;
+
+  std::vector<Dump_entry> all;
+  dump_catalog_list(&all);
+  std::map<std::string, Dump_entry> cataloged;
+  for (const Dump_entry& entry : all) cataloged[entry.path] = entry;
+
+  std::string prefix;
+  std::vector<std::string> files;
+  if (!get_profiler_variable("dump_path", &prefix))
+    list_files_with_prefix(prefix, &files);
+  for (const Dump_entry& entry : all) {
+    if (!entry.in_memory) files.push_back(entry.location);
+  }
+
+  struct Retained_dump {
+    Dump_entry entry;
+    time_t mtime;
+  };
+  std::vector<Retained_dump> dumps;
+  std::set<std::string> seen;
+  unsigned long long total = 0;
+  time_t now = time(nullptr);
+  for (const std::string& file : files) {
+    std::string path = strip_compression_suffix(file);
+    if (!seen.insert(path).second) continue;
+    Dump_entry entry;
+    struct stat st;
+    if (stat(file.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) continue;
+    auto it = cataloged.find(path);
+    if (it != cataloged.end()) {
+      // Running profilers are still writing, the in-memory dumps have their
+      // own limit (profiler.dump_store_max_bytes)
+      if (it->second.in_memory || it->second.ended == 0) continue;
+      entry = it->second;
+    } else {
+      // Temporary files, exports, .sites summaries and jemalloc's own dumps
+      // are left alone
+      if (!is_dump_file_name(prefix, file) ||
+          st.st_mtime > now - uncataloged_min_age)
+        continue;
+      entry.path = path;
+      entry.location = file;
+      bool heap = path.size() > 5 &&
+                  path.compare(path.size() - 5, 5, ".heap") == 0;
+      entry.type = heap ? "memory" : "cpu";
+      entry.allocator = heap ? "" : "profiler";
+    }
+    entry.size = st.st_size;
+    dumps.push_back({entry, st.st_mtime});
+    total += entry.size;
+  }
+  std::stable_sort(dumps.begin(), dumps.end(),
+                   [](const Retained_dump& a, const Retained_dump& b) {
+                     return a.mtime < b.mtime;
+                   });
+
+  auto over_quota = [&](size_t count) {
+    return (max_bytes > 0 && total > max_bytes) ||
+           (max_files > 0 && count > max_files);
+  };
+  if (!over_quota(dumps.size())) return;
+
+  if (max_bytes > 0 && dump_compression.load() != DUMP_COMPRESSION_NONE) {
+    for (const Retained_dump& dump : dumps) {
+      if (total <= max_bytes) break;
+      if (dump.entry.location != dump.entry.path) continue;
+      uint64_t saved = compress_dump(
+          {dump.entry.path, dump.entry.type, dump.entry.allocator});
+      total -= std::min<unsigned long long>(saved, total);
+    }
+  }
+
+  size_t count = dumps.size();
+  for (const Retained_dump& dump : dumps) {
+    const Dump_entry& entry = dump.entry;
+    if (!over_quota(count)) break;
+    // The size may have changed if it was compressed just above
+    Dump_location location;
+    bool found = find_dump_file(entry.path, &location);
+    if (found && location.in_memory()) continue;
+    struct stat st;
+    uint64_t size = (found && location.stat(&st)) ? st.st_size : 0;
+    if (found && unlink(location.path().c_str()) != 0) {
+      LogComponentErr(WARNING_LEVEL, ER_LOG_PRINTF_MSG,
+                      ("failed to remove " + location.path()).c_str());
+      continue;
+    }
+    dump_catalog_remove(entry.path);
+    remove_heap_timeline(entry.path);
+    total -= std::min<unsigned long long>(size, total);
+    count--;
+
+    char extra[100];
+    snprintf(extra, sizeof(extra), "retention: %llu bytes",
+             (unsigned long long)size);
+    addProfiler_element(time(nullptr), entry.path, entry.type, entry.allocator,
+                        "evicted", extra);
+  }
+}
+
+static void dump_worker_run() {
+  std::unique_lock<std::mutex> lock(dump_worker_mutex);
+  while (true) {
+    dump_worker_cond.wait_for(lock, retention_interval, [] {
+      return dump_worker_stopping || dump_retention_requested ||
+             !dump_jobs.empty();
+    });
+    // Pending dumps are left uncompressed, uninstall must not wait for them
+    if (dump_worker_stopping) break;
+    while (!dump_jobs.empty() && !dump_worker_stopping) {
+      Dump_job job = dump_jobs.front();
+      dump_jobs.pop_front();
+      lock.unlock();
+      // The name of the dump is sometimes predicted, skip it if it's not there
+      if (dump_file_exists(job.path)) {
+        count_samples(job);
+        compress_dump(job);
+      }
+      lock.lock();
+    }
+    dump_retention_requested = false;
+    lock.unlock();
+    enforce_dump_retention();
+    lock.lock();
+  }
+}
+
+void init_dump_worker() {
+  std::lock_guard<std::mutex> guard(dump_worker_mutex);
+  dump_worker_stopping = false;
+  dump_retention_requested = false;
+  dump_jobs.clear();
+  dump_worker = std::thread(dump_worker_run);
+}
+
+void deinit_dump_worker() {
+  {
+    std::lock_guard<std::mutex> guard(dump_worker_mutex);
+    dump_worker_stopping = true;
+  }
+  dump_worker_cond.notify_all();
+  if (dump_worker.joinable()) dump_worker.join();
+}
+
+void queue_finished_dump(const std::string& path, const std::string& type,
+                         const std::string& allocator) {
+  if (path.empty()) return;
+  {
+    std::lock_guard<std::mutex> guard(dump_worker_mutex);
+    if (dump_worker_stopping) return;
+    dump_jobs.push_back({path, type, allocator});
+  }
+  dump_worker_cond.notify_one();
+}
+
+void request_dump_retention() {
+  {
+    std::lock_guard<std::mutex> guard(dump_worker_mutex);
+    dump_retention_requested = true;
+  }
+  dump_worker_cond.notify_one();
+}
@@ -0,0 +1,50 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#ifndef PROFILER_DUMPS_H
+#define PROFILER_DUMPS_H
+
+#include <atomic>
+#include <string>
+
+// Value of profiler.dump_compression (Dump_compression)
+extern std::atomic<int> dump_compression;
+// Values of profiler.dump_max_bytes and profiler.dump_max_files, 0 means
+// unlimited
+extern unsigned long long dump_max_bytes;
+extern unsigned long long dump_max_files;
+
+// Background thread of the profiler component working on finished dumps
+extern void init_dump_worker();
+extern void deinit_dump_worker();
+
+// Called for every closed dump file: its samples are counted for the catalog
+// and it is compressed when profiler.dump_compression asks for it
+extern void queue_finished_dump(const std::string& path,
+                                const std::string& type,
+                                const std::string& allocator);
+
+// Check the quotas without waiting for the next dump, the dumps over them
+// are compressed or deleted from the background thread
+extern void request_dump_retention();
+
+#endif /* PROFILER_DUMPS_H */
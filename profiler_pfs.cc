@@ -74,8 +74,8 @@ void addProfiler_element(time_t profiler_timestamp,
 */
 
 /* Collection of table shares to be added to performance schema */
-PFS_engine_table_share_proxy *share_list[1] = {nullptr};
-unsigned int share_list_count = 1;
+PFS_engine_table_share_proxy *share_list[3] = {nullptr, nullptr, nullptr};
+unsigned int share_list_count = 3;
 
 /* Global share pointer for a table */
 PFS_engine_table_share_proxy profiler_st_share;
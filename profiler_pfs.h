@@ -1,3 +1,6 @@
+#ifndef PROFILER_PFS_H
+#define PROFILER_PFS_H
+
 #include <mysql/components/services/pfs_plugin_table_service.h>
 #include "profiler_mutex.h"
 
@@ -73,3 +76,5 @@ extern PFS_engine_table_share_proxy profiler_st_share;
 
 extern PFS_engine_table_share_proxy *share_list[];
 extern unsigned int share_list_count;
+
+#endif /* PROFILER_PFS_H */
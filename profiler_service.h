@@ -15,4 +15,18 @@ DECLARE_BOOL_METHOD(add, (const char* profiler_type, const char* profiler_alloca
                                 const char* profiler_extra));
 END_SERVICE_DEFINITION(profiler_pfs)
 
+// Dumps kept in memory when profiler.dump_store is MEMORY. Both methods return
+// a new descriptor on the in-memory file, the caller closes it once done. They
+// fail when the dump has to be on disk.
+BEGIN_SERVICE_DEFINITION(profiler_dump_store)
+DECLARE_BOOL_METHOD(create_dump, (const char *szPath, int *outFd));
+DECLARE_BOOL_METHOD(find_dump, (const char *szPath, int *outFd));
+END_SERVICE_DEFINITION(profiler_dump_store)
+
+// Dumps produced since the profiler component was loaded
+BEGIN_SERVICE_DEFINITION(profiler_dump_catalog)
+DECLARE_BOOL_METHOD(last_dump, (const char *szType, const char *szAllocator,
+                                char *szOutPath, size_t *inoutSize));
+END_SERVICE_DEFINITION(profiler_dump_catalog)
+
 #endif /* PROFILER_SERVICE_H */
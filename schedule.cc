@@ -0,0 +1,301 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#include "schedule.h"
+
+#include <strings.h>
+#include <time.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const std::chrono::seconds schedule_interval(1);
+const char *DAY_NAMES[] = {"sun", "mon", "tue", "wed", "thu", "fri", "sat"};
+
+std::mutex schedule_mutex;
+std::condition_variable schedule_cond;
+std::thread schedule_thread;
+bool schedule_stopping = false;
+std::string schedule_type;
+Schedule_reader schedule_reader = nullptr;
+Scheduled_run_start schedule_start = nullptr;
+Scheduled_run_dump schedule_dump = nullptr;
+Scheduled_run_stop schedule_stop = nullptr;
+
+struct Scheduler_state {
+  std::string spec;
+  std::vector<Profile_schedule_entry> entries;
+  // Minute (seconds since the epoch / 60) each entry was last due, an entry
+  // starts once even if it's checked several times during its minute
+  std::map<std::string, time_t> last_due;
+
+  bool running = false;
+  Scheduled_run run;
+  Clock::time_point run_end;
+  Clock::time_point next_dump;
+} state;
+
+std::string trim(const std::string& s) {
+  size_t begin = s.find_first_not_of(" \t\r\n");
+  if (begin == std::string::npos) return "";
+  size_t end = s.find_last_not_of(" \t\r\n");
+  return s.substr(begin, end - begin + 1);
+}
+
+int parse_day(const std::string& name) {
+  for (int i = 0; i < 7; i++)
+    if (strcasecmp(name.c_str(), DAY_NAMES[i]) == 0) return i;
+  return -1;
+}
+
+// *, mon-fri, sat,sun... ranges may wrap around: fri-mon
+bool parse_days(const std::string& token, unsigned int *days) {
+  if (token == "*") {
+    *days = 0x7f;
+    return true;
+  }
+  *days = 0;
+  std::istringstream items(token);
+  std::string item;
+  while (std::getline(items, item, ',')) {
+    size_t dash = item.find('-');
+    int first = parse_day(item.substr(0, dash));
+    int last = dash == std::string::npos ? first
+                                         : parse_day(item.substr(dash + 1));
+    if (first < 0 || last < 0) return false;
+    for (int day = first;; day = (day + 1) % 7) {
+      *days |= 1U << day;
+      if (day == last) break;
+    }
+  }
+  return *days != 0;
+}
+
+bool parse_time(const std::string& token, unsigned int *hour,
+                unsigned int *minute) {
+  unsigned int h, m;
+  int length = 0;
+  if (sscanf(token.c_str(), "%2u:%2u%n", &h, &m, &length) != 2 ||
+      (size_t)length != token.size() || h > 23 || m > 59)
+    return false;
+  *hour = h;
+  *minute = m;
+  return true;
+}
+
+// Number of seconds with an optional unit: 90, 90s, 15m, 2h
+bool parse_duration(const std::string& token, unsigned int *seconds) {
+  if (token.empty() || token[0] < '0' || token[0] > '9') return false;
+  char *end = nullptr;
+  unsigned long long value = strtoull(token.c_str(), &end, 10);
+  std::string unit(end);
+  if (unit == "h")
+    value *= 3600;
+  else if (unit == "m")
+    value *= 60;
+  else if (!unit.empty() && unit != "s")
+    return false;
+  if (value == 0 || value > PROFILE_SCHEDULE_MAX_DURATION) return false;
+  *seconds = value;
+  return true;
+}
+
+bool parse_entry(const std::string& text, Profile_schedule_entry *entry,
+                 std::string *error) {
+  std::istringstream stream(text);
+  std::vector<std::string> tokens;
+  std::string token;
+  while (stream >> token) tokens.push_back(token);
+
+  size_t i = 0;
+  entry->text = text;
+  if (tokens[0].find(':') == std::string::npos) {
+    if (!parse_days(tokens[0], &entry->days)) {
+      *error = "wrong days '" + tokens[0] + "' in '" + text + "', use * or mon..sun, mon-fri, sat,sun.";
+      return false;
+    }
+    i++;
+  }
+  if (tokens.size() < i + 3) {
+    *error = "wrong entry '" + text + "', it must be '[days] HH:MM duration cpu|memory [every=interval]'.";
+    return false;
+  }
+  if (!parse_time(tokens[i], &entry->hour, &entry->minute)) {
+    *error = "wrong start time '" + tokens[i] + "' in '" + text + "', it must be HH:MM.";
+    return false;
+  }
+  if (!parse_duration(tokens[i + 1], &entry->duration)) {
+    *error = "wrong duration '" + tokens[i + 1] + "' in '" + text + "', it must be between 1s and 24h.";
+    return false;
+  }
+  entry->type = tokens[i + 2];
+  if (entry->type != PROFILE_SCHEDULE_CPU &&
+      entry->type != PROFILE_SCHEDULE_MEMORY) {
+    *error = "wrong profile type '" + entry->type + "' in '" + text + "', it must be cpu or memory.";
+    return false;
+  }
+  for (i += 3; i < tokens.size(); i++) {
+    if (tokens[i].compare(0, 6, "every=") == 0 &&
+        entry->type == PROFILE_SCHEDULE_MEMORY &&
+        parse_duration(tokens[i].substr(6), &entry->every) &&
+        entry->every < entry->duration)
+      continue;
+    *error = "wrong option '" + tokens[i] + "' in '" + text + "', only memory runs have one: every=interval, shorter than the run.";
+    return false;
+  }
+  return true;
+}
+
+std::string run_name(const struct tm& local) {
+  char name[32];
+  strftime(name, sizeof(name), "schedule.%Y%m%d-%H%M", &local);
+  return name;
+}
+
+void start_run(const Profile_schedule_entry& entry, const struct tm& local) {
+  Scheduled_run run;
+  run.entry = entry;
+  run.name = run_name(local);
+  // EXTRA is a VARCHAR(100)
+  run.extra = ("schedule: " + entry.text).substr(0, 100);
+  if (!schedule_start(&run)) return;
+  // A run stopped from SQL before its end is replaced
+  state.running = true;
+  state.run = run;
+  Clock::time_point now = Clock::now();
+  state.run_end = now + std::chrono::seconds(entry.duration);
+  state.next_dump = now + std::chrono::seconds(entry.every);
+}
+
+void check_schedule() {
+  std::string spec;
+  if (schedule_reader(&spec) && spec != state.spec) {
+    std::vector<Profile_schedule_entry> entries;
+    std::string error;
+    // An invalid value can only come from the configuration file, the
+    // profiler component reports it
+    if (!parse_profile_schedule(spec.c_str(), &entries, &error))
+      entries.clear();
+    state.spec = spec;
+    state.entries.swap(entries);
+  }
+
+  if (state.running) {
+    Clock::time_point now = Clock::now();
+    if (now >= state.run_end) {
+      schedule_stop(state.run, "schedule: completed");
+      state.running = false;
+    } else if (schedule_dump != nullptr && state.run.entry.every > 0 &&
+               now >= state.next_dump) {
+      schedule_dump(state.run);
+      state.next_dump += std::chrono::seconds(state.run.entry.every);
+    }
+  }
+
+  time_t now = time(nullptr);
+  struct tm local;
+  localtime_r(&now, &local);
+  time_t minute = now / 60;
+  for (const Profile_schedule_entry& entry : state.entries) {
+    if (entry.type != schedule_type || !(entry.days & (1U << local.tm_wday)) ||
+        entry.hour != (unsigned int)local.tm_hour ||
+        entry.minute != (unsigned int)local.tm_min)
+      continue;
+    time_t& last_due = state.last_due[entry.text];
+    if (last_due == minute) continue;
+    last_due = minute;
+    start_run(entry, local);
+  }
+}
+
+void schedule_thread_run() {
+  std::unique_lock<std::mutex> lock(schedule_mutex);
+  while (!schedule_stopping) {
+    schedule_cond.wait_for(lock, schedule_interval,
+                           [] { return schedule_stopping; });
+    if (schedule_stopping) break;
+    lock.unlock();
+    check_schedule();
+    lock.lock();
+  }
+}
+
+}  // namespace
+
+bool parse_profile_schedule(const char *spec,
+                            std::vector<Profile_schedule_entry>* entries,
+                            std::string* error) {
+  entries->clear();
+  if (spec == nullptr) return true;
+  if (strlen(spec) > PROFILE_SCHEDULE_MAX_LENGTH) {
+    *error = "the schedule can't be longer than " +
+             std::to_string(PROFILE_SCHEDULE_MAX_LENGTH) + " characters.";
+    return false;
+  }
+  std::istringstream stream(spec);
+  std::string text;
+  while (std::getline(stream, text, ';')) {
+    text = trim(text);
+    if (text.empty()) continue;
+    Profile_schedule_entry entry;
+    if (!parse_entry(text, &entry, error)) return false;
+    entries->push_back(entry);
+  }
+  return true;
+}
+
+void init_profile_scheduler(const char *type, Schedule_reader reader,
+                            Scheduled_run_start start, Scheduled_run_dump dump,
+                            Scheduled_run_stop stop) {
+  std::lock_guard<std::mutex> guard(schedule_mutex);
+  state = Scheduler_state();
+  schedule_type = type;
+  schedule_reader = reader;
+  schedule_start = start;
+  schedule_dump = dump;
+  schedule_stop = stop;
+  schedule_stopping = false;
+  schedule_thread = std::thread(schedule_thread_run);
+}
+
+void deinit_profile_scheduler() {
+  {
+    std::lock_guard<std::mutex> guard(schedule_mutex);
+    schedule_stopping = true;
+  }
+  schedule_cond.notify_all();
+  if (schedule_thread.joinable()) schedule_thread.join();
+  // The run would never be completed
+  if (state.running) schedule_stop(state.run, "schedule: uninstalled");
+  state = Scheduler_state();
+}
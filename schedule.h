@@ -0,0 +1,92 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#ifndef PROFILER_SCHEDULE_H
+#define PROFILER_SCHEDULE_H
+
+#include <string>
+#include <vector>
+
+#define PROFILE_SCHEDULE_CPU "cpu"
+#define PROFILE_SCHEDULE_MEMORY "memory"
+// Longest value of profiler.schedule, it's read through a 1KB buffer
+#define PROFILE_SCHEDULE_MAX_LENGTH 1000
+#define PROFILE_SCHEDULE_MAX_DURATION (24 * 3600)
+
+// One entry of profiler.schedule:
+//   [days] HH:MM duration cpu|memory [every=interval]
+struct Profile_schedule_entry {
+  // Days of the week the run starts, bit 0 is Sunday like tm_wday
+  unsigned int days = 0x7f;
+  unsigned int hour = 0;
+  unsigned int minute = 0;
+  // Length of the run in seconds
+  unsigned int duration = 0;
+  // PROFILE_SCHEDULE_CPU or PROFILE_SCHEDULE_MEMORY
+  std::string type;
+  // Seconds between the heap dumps taken during a memory run, 0 only dumps
+  // when it starts and stops
+  unsigned int every = 0;
+  // The entry as written, used in the logs and in profiler_actions
+  std::string text;
+};
+
+struct Scheduled_run {
+  Profile_schedule_entry entry;
+  // Unique part of the name of the dumps: schedule.YYYYMMDD-HHMM, the dumps
+  // of the run are <dump_path>.<name>.prof or <dump_path>.<name>.NNNN.heap
+  std::string name;
+  // Value for the EXTRA column of profiler_actions
+  std::string extra;
+  // Set by the component when the run starts: <dump_path>.<name>, so
+  // changing profiler.dump_path during the run doesn't matter
+  std::string prefix;
+};
+
+// Current value of profiler.schedule
+typedef bool (*Schedule_reader)(std::string *spec);
+// Start the profiler for the run, false when it's skipped (the profiler is
+// already running...), the component logs why
+typedef bool (*Scheduled_run_start)(Scheduled_run *run);
+// Heap dump requested by every= during a memory run, may be null for cpu
+typedef void (*Scheduled_run_dump)(const Scheduled_run& run);
+// Stop the profiler if it's still running for this run
+typedef void (*Scheduled_run_stop)(const Scheduled_run& run,
+                                   const char *reason);
+
+// Parse a value of profiler.schedule, entries are separated by ';'. Returns
+// false with a message in error when the value is invalid.
+extern bool parse_profile_schedule(const char *spec,
+                                   std::vector<Profile_schedule_entry>* entries,
+                                   std::string* error);
+
+// Background thread of the cpu and memory components starting the runs of
+// their type when their time comes, the schedule is read every second. Only
+// one run at a time, an entry due while the profiler is running is skipped.
+extern void init_profile_scheduler(const char *type, Schedule_reader reader,
+                                   Scheduled_run_start start,
+                                   Scheduled_run_dump dump,
+                                   Scheduled_run_stop stop);
+// A run in progress is stopped
+extern void deinit_profile_scheduler();
+
+#endif /* PROFILER_SCHEDULE_H */
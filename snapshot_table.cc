@@ -0,0 +1,159 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#include "snapshot_table.h"
+
+#include <strings.h>
+
+#include <cassert>
+#include <cstring>
+#include <sstream>
+
+namespace {
+
+struct Snapshot_table_handle {
+  const Snapshot_table *table = nullptr;
+  /* Current position */
+  unsigned int m_pos = 0;
+  /* Next position */
+  unsigned int m_next_pos = 0;
+
+  std::vector<Snapshot_row> rows;
+};
+
+bool starts_with_word(const std::string& word, const char *prefix) {
+  return strncasecmp(word.c_str(), prefix, strlen(prefix)) == 0;
+}
+
+// The NULL value of the column's own setter, a TIMESTAMP can't be NULL and
+// is set to 0
+void set_null_value(const Snapshot_table_handle *h, PSI_field *field,
+                    unsigned int index) {
+  Snapshot_value::Type type = index < h->table->columns.size()
+                                  ? h->table->columns[index]
+                                  : Snapshot_value::STRING;
+  switch (type) {
+    case Snapshot_value::SIGNED:
+      pfs_bigint->set(field, {0, true});
+      break;
+    case Snapshot_value::UNSIGNED:
+      pfs_bigint->set_unsigned(field, {0, true});
+      break;
+    case Snapshot_value::TIMESTAMP:
+      pfs_timestamp->set2(field, 0);
+      break;
+    default:
+      pfs_string->set_varchar_utf8mb4(field, nullptr);
+      break;
+  }
+}
+
+}  // namespace
+
+void snapshot_init_columns(Snapshot_table *table) {
+  table->columns.clear();
+  std::istringstream definition(table->definition);
+  std::string column;
+  while (std::getline(definition, column, ',')) {
+    // `NAME` TYPE [unsigned], the tables don't use DECIMAL(M,D) and the like
+    std::istringstream words(column);
+    std::string name, type, option;
+    words >> name >> type >> option;
+    if (starts_with_word(type, "TIMESTAMP"))
+      table->columns.push_back(Snapshot_value::TIMESTAMP);
+    else if (starts_with_word(type, "BIGINT") || starts_with_word(type, "INT"))
+      table->columns.push_back(starts_with_word(option, "UNSIGNED")
+                                   ? Snapshot_value::UNSIGNED
+                                   : Snapshot_value::SIGNED);
+    else
+      table->columns.push_back(Snapshot_value::STRING);
+  }
+}
+
+PSI_table_handle *snapshot_open_table(Snapshot_table *table, PSI_pos **pos) {
+  Snapshot_table_handle *handle = new Snapshot_table_handle();
+  handle->table = table;
+  table->fill(&handle->rows);
+  *pos = (PSI_pos *)(&handle->m_pos);
+  return (PSI_table_handle *)handle;
+}
+
+void snapshot_close_table(PSI_table_handle *handle) {
+  delete (Snapshot_table_handle *)handle;
+}
+
+int snapshot_rnd_next(PSI_table_handle *handle) {
+  Snapshot_table_handle *h = (Snapshot_table_handle *)handle;
+  h->m_pos = h->m_next_pos;
+  if (h->m_pos < h->rows.size()) {
+    h->m_next_pos = h->m_pos + 1;
+    return 0;
+  }
+  return PFS_HA_ERR_END_OF_FILE;
+}
+
+int snapshot_rnd_init(PSI_table_handle *, bool) { return 0; }
+
+int snapshot_rnd_pos(PSI_table_handle *handle) {
+  Snapshot_table_handle *h = (Snapshot_table_handle *)handle;
+  return h->m_pos < h->rows.size() ? 0 : PFS_HA_ERR_END_OF_FILE;
+}
+
+void snapshot_reset_position(PSI_table_handle *handle) {
+  Snapshot_table_handle *h = (Snapshot_table_handle *)handle;
+  h->m_pos = 0;
+  h->m_next_pos = 0;
+}
+
+int snapshot_read_column_value(PSI_table_handle *handle, PSI_field *field,
+                               unsigned int index) {
+  Snapshot_table_handle *h = (Snapshot_table_handle *)handle;
+  const Snapshot_row& row = h->rows[h->m_pos];
+  // Missing trailing values are NULL
+  if (index >= row.size()) {
+    set_null_value(h, field, index);
+    return 0;
+  }
+
+  const Snapshot_value& value = row[index];
+  switch (value.type) {
+    case Snapshot_value::NULL_VALUE:
+      set_null_value(h, field, index);
+      break;
+    case Snapshot_value::STRING:
+      pfs_string->set_varchar_utf8mb4(field, value.str.c_str());
+      break;
+    case Snapshot_value::SIGNED:
+      pfs_bigint->set(field, {value.sval, false});
+      break;
+    case Snapshot_value::UNSIGNED:
+      pfs_bigint->set_unsigned(field, {value.uval, false});
+      break;
+    case Snapshot_value::TIMESTAMP:
+      pfs_timestamp->set2(field, value.uval);
+      break;
+    default: /* We should never reach here */
+      assert(0);
+      break;
+  }
+  return 0;
+}
@@ -0,0 +1,140 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#ifndef PROFILER_SNAPSHOT_TABLE_H
+#define PROFILER_SNAPSHOT_TABLE_H
+
+#include <mysql/components/services/pfs_plugin_table_service.h>
+
+#include <string>
+#include <vector>
+
+extern REQUIRES_SERVICE_PLACEHOLDER(pfs_plugin_table_v1);
+extern REQUIRES_SERVICE_PLACEHOLDER_AS(pfs_plugin_column_string_v2, pfs_string);
+extern REQUIRES_SERVICE_PLACEHOLDER_AS(pfs_plugin_column_bigint_v1, pfs_bigint);
+extern REQUIRES_SERVICE_PLACEHOLDER_AS(pfs_plugin_column_timestamp_v2, pfs_timestamp);
+
+// Read-only performance_schema tables of the profiler sub-components. The
+// rows are built when the table is opened, the allocators are only queried
+// once per SELECT.
+struct Snapshot_value {
+  enum Type { NULL_VALUE, STRING, SIGNED, UNSIGNED, TIMESTAMP };
+
+  Type type = NULL_VALUE;
+  std::string str;
+  long long sval = 0;
+  unsigned long long uval = 0;
+
+  static Snapshot_value null() { return Snapshot_value(); }
+  static Snapshot_value string(const std::string& value) {
+    Snapshot_value v;
+    v.type = STRING;
+    v.str = value;
+    return v;
+  }
+  static Snapshot_value number(long long value) {
+    Snapshot_value v;
+    v.type = SIGNED;
+    v.sval = value;
+    return v;
+  }
+  static Snapshot_value unsigned_number(unsigned long long value) {
+    Snapshot_value v;
+    v.type = UNSIGNED;
+    v.uval = value;
+    return v;
+  }
+  // Microseconds since the epoch
+  static Snapshot_value timestamp(unsigned long long micros) {
+    Snapshot_value v;
+    v.type = TIMESTAMP;
+    v.uval = micros;
+    return v;
+  }
+};
+
+typedef std::vector<Snapshot_value> Snapshot_row;
+
+struct Snapshot_table {
+  const char *name;
+  const char *definition;
+  void (*fill)(std::vector<Snapshot_row> *rows);
+  // Estimate given to the optimizer
+  unsigned long long row_count;
+  PFS_engine_table_share_proxy share;
+  // Type of each column, from the definition: the NULL values are set with
+  // the setter of the column
+  std::vector<Snapshot_value::Type> columns;
+};
+
+extern void snapshot_init_columns(Snapshot_table *table);
+
+extern PSI_table_handle *snapshot_open_table(Snapshot_table *table,
+                                             PSI_pos **pos);
+extern void snapshot_close_table(PSI_table_handle *handle);
+extern int snapshot_rnd_next(PSI_table_handle *handle);
+extern int snapshot_rnd_init(PSI_table_handle *handle, bool scan);
+extern int snapshot_rnd_pos(PSI_table_handle *handle);
+extern void snapshot_reset_position(PSI_table_handle *handle);
+extern int snapshot_read_column_value(PSI_table_handle *handle,
+                                      PSI_field *field, unsigned int index);
+
+// The performance_schema callbacks don't tell which table they are called
+// for, open_table and get_row_count are instantiated for each table
+template <Snapshot_table *table>
+PSI_table_handle *snapshot_open(PSI_pos **pos) {
+  return snapshot_open_table(table, pos);
+}
+
+template <Snapshot_table *table>
+unsigned long long snapshot_row_count() {
+  return table->row_count;
+}
+
+template <Snapshot_table *table>
+PFS_engine_table_share_proxy *init_snapshot_share() {
+  snapshot_init_columns(table);
+  PFS_engine_table_share_proxy *share = &table->share;
+  share->m_table_name = table->name;
+  share->m_table_name_length = strlen(table->name);
+  share->m_table_definition = table->definition;
+  share->m_ref_length = sizeof(unsigned int);
+  share->m_acl = READONLY;
+  share->get_row_count = snapshot_row_count<table>;
+  share->delete_all_rows = nullptr; /* READONLY TABLE */
+
+  share->m_proxy_engine_table = {snapshot_rnd_next, snapshot_rnd_init,
+                                 snapshot_rnd_pos,
+                                 nullptr, nullptr, nullptr,
+                                 snapshot_read_column_value,
+                                 snapshot_reset_position,
+                                 /* READONLY TABLE */
+                                 nullptr, /* write_column_value */
+                                 nullptr, /* write_row_values */
+                                 nullptr, /* update_column_value */
+                                 nullptr, /* update_row_values */
+                                 nullptr, /* delete_row_values */
+                                 snapshot_open<table>, snapshot_close_table};
+  return share;
+}
+
+#endif /* PROFILER_SNAPSHOT_TABLE_H */
@@ -0,0 +1,279 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#include "symbolizer.h"
+
+#include <cxxabi.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+namespace {
+
+struct Elf_symbol {
+  uint64_t address;
+  uint64_t size;
+  const char *name;
+};
+
+// Read-only view of an ELF file kept mapped as long as the component is
+// loaded: the symbol names point directly into the mapping.
+class Elf_image {
+ public:
+  ~Elf_image() {
+    if (m_data != nullptr) munmap(m_data, m_length);
+  }
+
+  bool load(const std::string& filename) {
+    int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Elf64_Ehdr)) {
+      close(fd);
+      return false;
+    }
+    void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+    m_data = static_cast<char *>(data);
+    m_length = st.st_size;
+
+    const Elf64_Ehdr *ehdr = reinterpret_cast<const Elf64_Ehdr *>(m_data);
+    if (memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 ||
+        ehdr->e_ident[EI_CLASS] != ELFCLASS64)
+      return false;
+
+    if (in_bounds(ehdr->e_phoff, (uint64_t)ehdr->e_phnum * sizeof(Elf64_Phdr))) {
+      const Elf64_Phdr *phdr =
+          reinterpret_cast<const Elf64_Phdr *>(m_data + ehdr->e_phoff);
+      for (int i = 0; i < ehdr->e_phnum; i++) {
+        if (phdr[i].p_type == PT_LOAD) m_loads.push_back(phdr[i]);
+        if (phdr[i].p_type == PT_NOTE && m_build_id.empty())
+          read_build_id(phdr[i].p_offset, phdr[i].p_filesz);
+      }
+    }
+
+    if (!in_bounds(ehdr->e_shoff, (uint64_t)ehdr->e_shnum * sizeof(Elf64_Shdr)))
+      return true;
+    const Elf64_Shdr *shdr =
+        reinterpret_cast<const Elf64_Shdr *>(m_data + ehdr->e_shoff);
+
+    // Prefer the full symbol table, the dynamic one only has exported symbols
+    for (uint32_t wanted : {(uint32_t)SHT_SYMTAB, (uint32_t)SHT_DYNSYM}) {
+      for (int i = 0; i < ehdr->e_shnum; i++) {
+        if (shdr[i].sh_type != wanted || shdr[i].sh_link >= ehdr->e_shnum)
+          continue;
+        const Elf64_Shdr& strtab = shdr[shdr[i].sh_link];
+        if (!in_bounds(shdr[i].sh_offset, shdr[i].sh_size) ||
+            !in_bounds(strtab.sh_offset, strtab.sh_size))
+          continue;
+        const Elf64_Sym *sym =
+            reinterpret_cast<const Elf64_Sym *>(m_data + shdr[i].sh_offset);
+        size_t count = shdr[i].sh_size / sizeof(Elf64_Sym);
+        for (size_t j = 0; j < count; j++) {
+          if (ELF64_ST_TYPE(sym[j].st_info) != STT_FUNC ||
+              sym[j].st_value == 0 || sym[j].st_name >= strtab.sh_size)
+            continue;
+          m_symbols.push_back({sym[j].st_value, sym[j].st_size,
+                               m_data + strtab.sh_offset + sym[j].st_name});
+        }
+      }
+      if (!m_symbols.empty()) break;
+    }
+    std::sort(m_symbols.begin(), m_symbols.end(),
+              [](const Elf_symbol& a, const Elf_symbol& b) {
+                return a.address < b.address;
+              });
+    return true;
+  }
+
+  const std::string& build_id() const { return m_build_id; }
+
+  // Translate an offset in the file into the virtual address used by the
+  // symbol table
+  uint64_t file_offset_to_address(uint64_t offset) const {
+    for (const Elf64_Phdr& load : m_loads) {
+      if (offset >= load.p_offset && offset < load.p_offset + load.p_filesz)
+        return load.p_vaddr + (offset - load.p_offset);
+    }
+    return offset;
+  }
+
+  const Elf_symbol *lookup(uint64_t address) const {
+    auto it = std::upper_bound(
+        m_symbols.begin(), m_symbols.end(), address,
+        [](uint64_t a, const Elf_symbol& s) { return a < s.address; });
+    if (it == m_symbols.begin()) return nullptr;
+    --it;
+    // Symbols without size (hand written assembly) match up to the next one
+    if (it->size != 0 && address >= it->address + it->size) return nullptr;
+    return &*it;
+  }
+
+ private:
+  bool in_bounds(uint64_t offset, uint64_t length) const {
+    return offset <= m_length && length <= m_length - offset;
+  }
+
+  void read_build_id(uint64_t offset, uint64_t length) {
+    if (!in_bounds(offset, length)) return;
+    uint64_t pos = offset;
+    while (pos + sizeof(Elf64_Nhdr) <= offset + length) {
+      const Elf64_Nhdr *note = reinterpret_cast<const Elf64_Nhdr *>(m_data + pos);
+      uint64_t name_pos = pos + sizeof(Elf64_Nhdr);
+      uint64_t desc_pos = name_pos + ((note->n_namesz + 3) & ~3ULL);
+      uint64_t next = desc_pos + ((note->n_descsz + 3) & ~3ULL);
+      if (next > offset + length) return;
+      if (note->n_type == NT_GNU_BUILD_ID && note->n_namesz == 4 &&
+          memcmp(m_data + name_pos, "GNU", 4) == 0) {
+        static const char hex[] = "0123456789abcdef";
+        for (uint32_t i = 0; i < note->n_descsz; i++) {
+          unsigned char c = m_data[desc_pos + i];
+          m_build_id += hex[c >> 4];
+          m_build_id += hex[c & 0xf];
+        }
+        return;
+      }
+      pos = next;
+    }
+  }
+
+  char *m_data = nullptr;
+  size_t m_length = 0;
+  std::vector<Elf64_Phdr> m_loads;
+  std::vector<Elf_symbol> m_symbols;
+  std::string m_build_id;
+};
+
+std::mutex elf_cache_mutex;
+std::map<std::string, std::shared_ptr<Elf_image>> elf_cache;
+
+std::shared_ptr<Elf_image> get_elf_image(const std::string& filename) {
+  std::lock_guard<std::mutex> guard(elf_cache_mutex);
+  auto it = elf_cache.find(filename);
+  if (it != elf_cache.end()) return it->second;
+
+  auto image = std::make_shared<Elf_image>();
+  if (!image->load(filename)) image.reset();
+  // Failures are cached too, we don't want to retry on every address
+  elf_cache[filename] = image;
+  return image;
+}
+
+std::string demangle(const char *name) {
+  int status = 0;
+  char *demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+  if (status != 0 || demangled == nullptr) return name;
+  std::string result(demangled);
+  free(demangled);
+  return result;
+}
+
+}  // namespace
+
+void parse_mapped_libraries(const std::string& maps,
+                            std::vector<Mapped_region> *regions) {
+  std::istringstream stream(maps);
+  std::string line;
+  while (std::getline(stream, line)) {
+    unsigned long long start, limit, offset;
+    char perms[8];
+    int path_pos = 0;
+    if (sscanf(line.c_str(), "%llx-%llx %7s %llx %*s %*s %n", &start, &limit,
+               perms, &offset, &path_pos) < 4)
+      continue;
+    if (strchr(perms, 'x') == nullptr) continue;
+    Mapped_region region;
+    region.start = start;
+    region.limit = limit;
+    region.offset = offset;
+    if (path_pos > 0 && (size_t)path_pos < line.size())
+      region.filename = line.substr(path_pos);
+    regions->push_back(region);
+  }
+}
+
+void read_self_mappings(std::vector<Mapped_region> *regions) {
+  std::ifstream f("/proc/self/maps");
+  std::stringstream maps;
+  maps << f.rdbuf();
+  parse_mapped_libraries(maps.str(), regions);
+}
+
+std::string get_build_id(const std::string& filename) {
+  if (filename.empty() || filename[0] != '/') return "";
+  auto image = get_elf_image(filename);
+  return image ? image->build_id() : "";
+}
+
+bool symbolize_address(const std::vector<Mapped_region>& regions,
+                       uint64_t address, std::string *function,
+                       std::string *filename) {
+  for (const Mapped_region& region : regions) {
+    if (address < region.start || address >= region.limit) continue;
+    if (filename != nullptr) *filename = region.filename;
+    if (region.filename.empty() || region.filename[0] != '/') return false;
+    auto image = get_elf_image(region.filename);
+    if (!image) return false;
+    uint64_t file_offset = address - region.start + region.offset;
+    const Elf_symbol *sym =
+        image->lookup(image->file_offset_to_address(file_offset));
+    if (sym == nullptr) return false;
+    *function = demangle(sym->name);
+    return true;
+  }
+  return false;
+}
+
+std::string symbolize(const std::vector<Mapped_region>& regions,
+                      uint64_t address) {
+  std::string function;
+  // Stacks contain return addresses, look at the call instruction instead
+  if (symbolize_address(regions, address > 0 ? address - 1 : 0, &function,
+                        nullptr))
+    return function;
+  char buf[32];
+  snprintf(buf, sizeof(buf), "0x%llx", (unsigned long long)address);
+  return buf;
+}
+
+bool is_allocator_frame(const std::string& filename,
+                        const std::string& function) {
+  return filename.find("libtcmalloc") != std::string::npos ||
+         filename.find("libjemalloc") != std::string::npos ||
+         function.compare(0, 10, "tcmalloc::") == 0 ||
+         function.compare(0, 3, "tc_") == 0 ||
+         function.compare(0, 3, "je_") == 0 ||
+         function.compare(0, 5, "prof_") == 0;
+}
@@ -0,0 +1,59 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#ifndef PROFILER_SYMBOLIZER_H
+#define PROFILER_SYMBOLIZER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One executable region of a /proc/<pid>/maps listing
+struct Mapped_region {
+  uint64_t start = 0;
+  uint64_t limit = 0;
+  uint64_t offset = 0;
+  std::string filename;
+};
+
+// Parse a /proc/<pid>/maps listing (as appended to the dumps by gperftools
+// and jemalloc), keeping only the executable regions
+extern void parse_mapped_libraries(const std::string& maps,
+                                   std::vector<Mapped_region>* regions);
+// Executable regions of the running mysqld
+extern void read_self_mappings(std::vector<Mapped_region>* regions);
+// GNU build-id of an ELF file as an hex string, empty if there is none
+extern std::string get_build_id(const std::string& filename);
+// Resolve an address using the ELF symbol tables of the mapped files, the
+// name is demangled. Returns false when the address can't be resolved.
+extern bool symbolize_address(const std::vector<Mapped_region>& regions,
+                              uint64_t address, std::string* function,
+                              std::string* filename);
+// Same as above but always returns something printable
+extern std::string symbolize(const std::vector<Mapped_region>& regions,
+                             uint64_t address);
+// Frames of tcmalloc or jemalloc themselves, skipped at the top of the
+// allocation stacks
+extern bool is_allocator_frame(const std::string& filename,
+                               const std::string& function);
+
+#endif /* PROFILER_SYMBOLIZER_H */
@@ -0,0 +1,160 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#include "tcmalloc_control.h"
+
+#include "common.h"
+
+#include <dlfcn.h>
+#include <gperftools/malloc_extension.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+unsigned long long tcmalloc_free_watermark_bytes = 0;
+unsigned long long tcmalloc_release_step_bytes =
+    DEFAULT_TCMALLOC_RELEASE_STEP_BYTES;
+
+namespace {
+
+// DEFINE_int64(tcmalloc_sample_parameter, ...) in gperftools' sampler.cc,
+// the sampler reads it each time it picks the next sampled allocation. It's
+// an internal symbol, not an API: it's only found when tcmalloc is a shared
+// library exporting it. A tcmalloc linked statically into mysqld without
+// -rdynamic, a stripped library or a gperftools release renaming the flag
+// namespace leave it unresolved, profiler.tcmalloc_sample_bytes can't change
+// the sampling then.
+const char *SAMPLE_PARAMETER_SYMBOL =
+    "_ZN61FLAG__namespace_do_not_use_directly_use_DECLARE_int64_instead"
+    "31FLAGS_tcmalloc_sample_parameterE";
+
+std::atomic<long long> *sample_parameter() {
+  static void *flag = dlsym(RTLD_DEFAULT, SAMPLE_PARAMETER_SYMBOL);
+  // Aligned 64 bits integer, stores are atomic on the supported platforms
+  return reinterpret_cast<std::atomic<long long> *>(flag);
+}
+
+// The watermark is checked every second
+const std::chrono::seconds release_interval(1);
+// Pause between two steps, the page heap lock is held while releasing
+const std::chrono::milliseconds release_pause(10);
+
+std::mutex release_mutex;
+std::condition_variable release_cond;
+std::thread release_thread;
+bool release_stopping = false;
+bool release_requested = false;
+Release_reporter release_reporter = nullptr;
+
+uint64_t pageheap_free_bytes() {
+  size_t value = 0;
+  MallocExtension::instance()->GetNumericProperty(
+      "tcmalloc.pageheap_free_bytes", &value);
+  return value;
+}
+
+// Release the free pages above the watermark step by step, the lock is
+// held by the caller and released during the pauses
+void release_above_watermark(std::unique_lock<std::mutex>& lock) {
+  uint64_t free_bytes = pageheap_free_bytes();
+  if (tcmalloc_free_watermark_bytes == 0 ||
+      free_bytes <= tcmalloc_free_watermark_bytes)
+    return;
+
+  uint64_t rss_before = read_rss();
+  uint64_t released = 0;
+  while (!release_stopping && tcmalloc_free_watermark_bytes > 0 &&
+         free_bytes > tcmalloc_free_watermark_bytes) {
+    size_t step = std::min<uint64_t>(
+        std::max<uint64_t>(tcmalloc_release_step_bytes, 1),
+        free_bytes - tcmalloc_free_watermark_bytes);
+    MallocExtension::instance()->ReleaseToSystem(step);
+    uint64_t remaining = pageheap_free_bytes();
+    // Nothing left that can be released (or allocated again meanwhile)
+    if (remaining >= free_bytes) break;
+    released += free_bytes - remaining;
+    free_bytes = remaining;
+    release_cond.wait_for(lock, release_pause,
+                          [] { return release_stopping; });
+  }
+  if (released > 0 && release_reporter != nullptr) {
+    Release_reporter reporter = release_reporter;
+    lock.unlock();
+    reporter(released, rss_before, read_rss());
+    lock.lock();
+  }
+}
+
+void release_thread_run() {
+  std::unique_lock<std::mutex> lock(release_mutex);
+  while (!release_stopping) {
+    release_cond.wait_for(lock, release_interval, [] {
+      return release_stopping || release_requested;
+    });
+    release_requested = false;
+    if (!release_stopping) release_above_watermark(lock);
+  }
+}
+
+}  // namespace
+
+bool get_tcmalloc_sample_parameter(long long *bytes) {
+  std::atomic<long long> *flag = sample_parameter();
+  if (flag == nullptr) return false;
+  *bytes = flag->load(std::memory_order_relaxed);
+  return true;
+}
+
+bool set_tcmalloc_sample_parameter(long long bytes) {
+  std::atomic<long long> *flag = sample_parameter();
+  if (flag == nullptr) return false;
+  flag->store(bytes, std::memory_order_relaxed);
+  return true;
+}
+
+void init_tcmalloc_release(Release_reporter reporter) {
+  std::lock_guard<std::mutex> guard(release_mutex);
+  release_reporter = reporter;
+  release_stopping = false;
+  release_thread = std::thread(release_thread_run);
+}
+
+void deinit_tcmalloc_release() {
+  {
+    std::lock_guard<std::mutex> guard(release_mutex);
+    release_stopping = true;
+  }
+  release_cond.notify_all();
+  if (release_thread.joinable()) release_thread.join();
+}
+
+void request_tcmalloc_release() {
+  {
+    std::lock_guard<std::mutex> guard(release_mutex);
+    release_requested = true;
+  }
+  release_cond.notify_all();
+}
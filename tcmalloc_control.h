@@ -0,0 +1,53 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#ifndef PROFILER_TCMALLOC_CONTROL_H
+#define PROFILER_TCMALLOC_CONTROL_H
+
+#include <cstdint>
+
+// Average number of bytes between two allocations sampled by tcmalloc
+// (TCMALLOC_SAMPLE_PARAMETER), 0 disables the sampling. gperftools has no
+// API for it: the flag read by its sampler is looked up in the process,
+// these functions return false when it can't be found.
+extern bool get_tcmalloc_sample_parameter(long long *bytes);
+extern bool set_tcmalloc_sample_parameter(long long bytes);
+
+#define DEFAULT_TCMALLOC_RELEASE_STEP_BYTES (16ULL * 1024 * 1024)
+
+// Called after the free pages were returned to the system
+typedef void (*Release_reporter)(uint64_t released, uint64_t rss_before,
+                                 uint64_t rss_after);
+
+// Value of profiler.tcmalloc_free_watermark_bytes: the background thread
+// returns the free pages of the page heap above it, 0 disables it
+extern unsigned long long tcmalloc_free_watermark_bytes;
+// Value of profiler.tcmalloc_release_step_bytes: the background thread
+// releases at most this much at once, with a pause between two steps
+extern unsigned long long tcmalloc_release_step_bytes;
+
+extern void init_tcmalloc_release(Release_reporter reporter);
+extern void deinit_tcmalloc_release();
+// Wake up the background thread, after a change of the watermark
+extern void request_tcmalloc_release();
+
+#endif /* PROFILER_TCMALLOC_CONTROL_H */
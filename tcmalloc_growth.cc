@@ -0,0 +1,106 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#include "tcmalloc_growth.h"
+#include "pprof_proto.h"
+#include "symbolizer.h"
+
+#include <gperftools/malloc_extension.h>
+
+#include <algorithm>
+#include <map>
+
+namespace {
+
+void fill_tcmalloc_growth(std::vector<Snapshot_row> *rows) {
+  std::vector<Growth_stack> stacks;
+  int64_t total;
+  if (!read_heap_growth(&stacks, &total)) return;
+  long long rank = 0;
+  for (const Growth_stack& stack : stacks) {
+    std::string frames;
+    for (const std::string& frame : stack.frames) {
+      if (!frames.empty()) frames += "; ";
+      frames += frame;
+    }
+    if (frames.size() > 1024) frames.resize(1024);
+    rows->push_back({Snapshot_value::unsigned_number(++rank),
+                     Snapshot_value::number(stack.bytes),
+                     Snapshot_value::number(stack.count),
+                     Snapshot_value::string(stack.top_frame),
+                     Snapshot_value::string(frames)});
+  }
+}
+
+}  // namespace
+
+bool read_heap_growth(std::vector<Growth_stack> *stacks, int64_t *total_bytes) {
+  std::string growth;
+  MallocExtension::instance()->GetHeapGrowthStacks(&growth);
+  Profile_data profile;
+  if (growth.empty() ||
+      !parse_heap_profile(growth.data(), growth.size(), &profile))
+    return false;
+
+  std::vector<Mapped_region> regions = profile.mappings;
+  if (regions.empty()) read_self_mappings(&regions);
+
+  // The same code path can be reached through different return addresses
+  std::map<std::vector<std::string>, Growth_stack> aggregated;
+  *total_bytes = 0;
+  for (const Profile_sample& sample : profile.samples) {
+    if (sample.values.size() < 2) continue;
+    Growth_stack stack;
+    bool in_allocator = true;
+    for (uint64_t pc : sample.pcs) {
+      std::string function, filename;
+      if (!symbolize_address(regions, pc > 0 ? pc - 1 : 0, &function,
+                             &filename))
+        function = symbolize(regions, pc);
+      if (in_allocator && is_allocator_frame(filename, function)) continue;
+      if (in_allocator) stack.top_frame = function;
+      in_allocator = false;
+      stack.frames.push_back(function);
+    }
+    Growth_stack& entry = aggregated[stack.frames];
+    if (entry.frames.empty()) {
+      entry.frames = stack.frames;
+      entry.top_frame = stack.top_frame;
+    }
+    entry.count += sample.values[0];
+    entry.bytes += sample.values[1];
+    *total_bytes += sample.values[1];
+  }
+
+  for (auto& entry : aggregated) stacks->push_back(std::move(entry.second));
+  std::sort(stacks->begin(), stacks->end(),
+            [](const Growth_stack& a, const Growth_stack& b) {
+              return a.bytes > b.bytes;
+            });
+  return true;
+}
+
+Snapshot_table tcmalloc_growth_table = {
+    "profiler_tcmalloc_growth",
+    "`RANK` BIGINT unsigned, `GROWTH_BYTES` BIGINT, `GROWTH_COUNT` BIGINT, "
+    "`TOP_FRAME` VARCHAR(255), `STACK` VARCHAR(1024)",
+    fill_tcmalloc_growth, 100, {}};
@@ -0,0 +1,51 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#ifndef PROFILER_TCMALLOC_GROWTH_H
+#define PROFILER_TCMALLOC_GROWTH_H
+
+#include "snapshot_table.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Code path that made tcmalloc grow its page heap
+struct Growth_stack {
+  int64_t bytes = 0;
+  int64_t count = 0;
+  // First frame outside of tcmalloc
+  std::string top_frame;
+  // Symbolized frames, innermost first
+  std::vector<std::string> frames;
+};
+
+// MallocExtension::GetHeapGrowthStacks() symbolized and aggregated by
+// stack, the largest growth first. Returns false if tcmalloc doesn't record
+// them.
+extern bool read_heap_growth(std::vector<Growth_stack>* stacks,
+                             int64_t* total_bytes);
+
+// performance_schema.profiler_tcmalloc_growth
+extern Snapshot_table tcmalloc_growth_table;
+
+#endif /* PROFILER_TCMALLOC_GROWTH_H */
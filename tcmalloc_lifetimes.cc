@@ -0,0 +1,623 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+#include "tcmalloc_lifetimes.h"
+#include "symbolizer.h"
+
+#include <gperftools/malloc_hook.h>
+#include <linux/membarrier.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+// The hooks never lock, never call malloc and never call into the
+// symbolizer. Each thread writes in a buffer of its own, the buffers are
+// merged by a background thread and when the table is read.
+const size_t SITE_COUNT = 1 << 12;
+const size_t MAX_SITE_PROBES = 64;
+const size_t MAX_THREAD_BUFFERS = 4096;
+const size_t BUFFER_SLOTS = 1 << 11;
+const size_t BUFFER_EVENTS = 1 << 11;
+const size_t MAX_PROBES = 16;
+const size_t FILTER_SIZE = 1 << 20;
+const int MAX_FRAMES = 16;
+const int BUCKET_COUNT = 64;
+const std::chrono::milliseconds MERGE_INTERVAL(100);
+
+// Values of Slot::address that are not addresses
+const uintptr_t EMPTY = 0;
+const uintptr_t DELETED = 1;
+const uintptr_t BUSY = 2;
+
+// One sampled allocation not freed yet, keyed by its address. The slot is
+// filled by the thread owning the buffer, any thread freeing the address
+// takes it back.
+struct Slot {
+  std::atomic<uintptr_t> address;
+  uint32_t site;
+  uint32_t size;
+  uint64_t allocated_ns;
+};
+
+// A sampled allocation or the free of one, for the merge
+struct Event {
+  uint32_t site;
+  uint32_t size;
+  // log2 of the size for an allocation, of the lifetime in nanoseconds for
+  // a free
+  uint8_t bucket;
+  bool freed;
+};
+
+struct Thread_buffer {
+  // The owner is in a hook using the buffers, see remove_hooks()
+  std::atomic<bool> active;
+  // Used by a running thread, released when it exits
+  std::atomic<bool> owned;
+  Slot slots[BUFFER_SLOTS];
+  // Single producer (the owner), single consumer (the merge)
+  std::atomic<uint32_t> head;
+  std::atomic<uint32_t> tail;
+  Event events[BUFFER_EVENTS];
+};
+
+// Registered stacks, only written when a new one is seen
+struct Site {
+  // Hash of the stack, 0 for a free entry
+  std::atomic<uint64_t> hash;
+  // The frames are written before ready is set
+  std::atomic<bool> ready;
+  int depth;
+  void *frames[MAX_FRAMES];
+};
+
+// Merged results, only touched with tables_mutex held
+struct Site_stats {
+  uint64_t sampled;
+  uint64_t freed;
+  uint64_t bytes;
+  uint64_t sizes[BUCKET_COUNT];
+  uint64_t lifetimes[BUCKET_COUNT];
+};
+
+Site *sites = nullptr;
+Site_stats *stats = nullptr;
+std::atomic<Thread_buffer *> buffers[MAX_THREAD_BUFFERS];
+std::atomic<size_t> buffer_count{0};
+// Number of sampled allocations alive per hash of their address, 255 is
+// sticky. A free looks for its address only when its counter isn't 0: the
+// frees of the allocations not sampled read one byte.
+std::atomic<uint8_t> live_filter[FILTER_SIZE];
+std::atomic<unsigned int> sample_one_in{0};
+// Without membarrier() the hooks pay a full fence
+bool expedited_barrier = false;
+pthread_key_t buffer_key;
+bool buffer_key_created = false;
+
+// Protects sites, stats, the merge and hooks_installed against the readers
+// of the table and the changes of profiler.tcmalloc_lifetime_sample
+std::mutex tables_mutex;
+bool hooks_installed = false;
+
+std::mutex merge_mutex;
+std::condition_variable merge_cond;
+bool merge_stopping = false;
+std::thread merge_thread;
+
+// The countdown is private to each thread, the unsampled allocations don't
+// touch any shared cache line. It's 0 until the first allocation of the
+// thread. initial-exec avoids __tls_get_addr, which can allocate on the
+// first access of a thread.
+__thread unsigned int countdown __attribute__((tls_model("initial-exec")));
+__thread bool in_hook __attribute__((tls_model("initial-exec")));
+__thread Thread_buffer *thread_buffer __attribute__((tls_model("initial-exec")));
+// No buffer was left for this thread
+__thread bool no_buffer __attribute__((tls_model("initial-exec")));
+
+inline uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// The first sample of a thread is anywhere in its first one_in allocations,
+// not always the first one
+unsigned int first_countdown(unsigned int one_in) {
+  uint64_t seed = (now_ns() ^ (uintptr_t)&countdown) * 0x9E3779B97F4A7C15ULL;
+  return 1 + (seed >> 32) % one_in;
+}
+
+inline int log2_bucket(uint64_t value) {
+  return value == 0 ? 0 : 63 - __builtin_clzll(value);
+}
+
+inline uint64_t mix_address(uintptr_t address) {
+  // Allocations are at least 8 bytes aligned
+  return (address >> 3) * 0x9E3779B97F4A7C15ULL;
+}
+
+inline size_t slot_index(uintptr_t address) {
+  return mix_address(address) >> 53;
+}
+
+inline size_t filter_index(uintptr_t address) {
+  return mix_address(address) >> 44;
+}
+
+void filter_add(uintptr_t address) {
+  std::atomic<uint8_t>& counter = live_filter[filter_index(address)];
+  uint8_t current = counter.load(std::memory_order_relaxed);
+  while (current != 255 &&
+         !counter.compare_exchange_weak(current, current + 1,
+                                        std::memory_order_relaxed)) {
+  }
+}
+
+void filter_remove(uintptr_t address) {
+  std::atomic<uint8_t>& counter = live_filter[filter_index(address)];
+  uint8_t current = counter.load(std::memory_order_relaxed);
+  while (current != 255 && current != 0 &&
+         !counter.compare_exchange_weak(current, current - 1,
+                                        std::memory_order_relaxed)) {
+  }
+}
+
+void release_buffer(void *buffer) {
+  static_cast<Thread_buffer *>(buffer)->owned.store(
+      false, std::memory_order_release);
+}
+
+// The buffer of the calling thread: one left by an exited thread or a new
+// one. nullptr when MAX_THREAD_BUFFERS are in use.
+Thread_buffer *get_thread_buffer() {
+  if (thread_buffer != nullptr || no_buffer) return thread_buffer;
+  size_t count = std::min(buffer_count.load(std::memory_order_acquire),
+                          MAX_THREAD_BUFFERS);
+  for (size_t i = 0; i < count; i++) {
+    Thread_buffer *buffer = buffers[i].load(std::memory_order_acquire);
+    bool owned = false;
+    if (buffer != nullptr &&
+        buffer->owned.compare_exchange_strong(owned, true,
+                                              std::memory_order_acquire)) {
+      thread_buffer = buffer;
+      break;
+    }
+  }
+  if (thread_buffer == nullptr) {
+    size_t index = buffer_count.fetch_add(1, std::memory_order_acq_rel);
+    if (index >= MAX_THREAD_BUFFERS) {
+      buffer_count.fetch_sub(1, std::memory_order_acq_rel);
+      no_buffer = true;
+      return nullptr;
+    }
+    // mmap() doesn't go through the hooks, zeroed atomics are valid
+    void *memory = mmap(nullptr, sizeof(Thread_buffer), PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+      buffers[index].store(nullptr, std::memory_order_release);
+      no_buffer = true;
+      return nullptr;
+    }
+    thread_buffer = static_cast<Thread_buffer *>(memory);
+    thread_buffer->owned.store(true, std::memory_order_relaxed);
+    buffers[index].store(thread_buffer, std::memory_order_release);
+  }
+  // Can allocate for the keys above PTHREAD_KEY_2NDLEVEL_SIZE, in_hook
+  // keeps the hooks out
+  pthread_setspecific(buffer_key, thread_buffer);
+  return thread_buffer;
+}
+
+// Announce a hook about to use the buffers. Returns false when the sampling
+// was stopped meanwhile, remove_hooks() may be waiting for the buffers.
+// Dekker with remove_hooks(): only a compiler barrier when membarrier()
+// provides the other half.
+inline bool enter_hook(Thread_buffer *buffer) {
+  buffer->active.store(true, std::memory_order_relaxed);
+  if (expedited_barrier)
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+  else
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sample_one_in.load(std::memory_order_relaxed) != 0) return true;
+  buffer->active.store(false, std::memory_order_release);
+  return false;
+}
+
+inline void leave_hook(Thread_buffer *buffer) {
+  buffer->active.store(false, std::memory_order_release);
+}
+
+void push_event(Thread_buffer *buffer, const Event& event) {
+  uint32_t head = buffer->head.load(std::memory_order_relaxed);
+  // Full until the next merge, the event is lost
+  if (head - buffer->tail.load(std::memory_order_acquire) >= BUFFER_EVENTS)
+    return;
+  buffer->events[head % BUFFER_EVENTS] = event;
+  buffer->head.store(head + 1, std::memory_order_release);
+}
+
+uint64_t hash_stack(void **frames, int depth) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (int i = 0; i < depth; i++) {
+    hash ^= (uint64_t)(uintptr_t)frames[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash == 0 ? 1 : hash;
+}
+
+// Index of the site of a stack, registered on first use. Returns
+// SITE_COUNT when the table is too full.
+size_t find_site(void **frames, int depth) {
+  uint64_t hash = hash_stack(frames, depth);
+  size_t start = hash % SITE_COUNT;
+  for (size_t i = 0; i < MAX_SITE_PROBES; i++) {
+    Site& site = sites[(start + i) % SITE_COUNT];
+    uint64_t current = site.hash.load(std::memory_order_acquire);
+    if (current == hash) return (start + i) % SITE_COUNT;
+    if (current == 0 &&
+        site.hash.compare_exchange_strong(current, hash,
+                                          std::memory_order_acq_rel)) {
+      site.depth = depth;
+      memcpy(site.frames, frames, depth * sizeof(void *));
+      site.ready.store(true, std::memory_order_release);
+      return (start + i) % SITE_COUNT;
+    }
+    if (current == hash) return (start + i) % SITE_COUNT;
+  }
+  return SITE_COUNT;
+}
+
+void new_hook(const void *ptr, size_t size) {
+  unsigned int one_in = sample_one_in.load(std::memory_order_relaxed);
+  if (one_in == 0 || ptr == nullptr) return;
+  if (countdown == 0) countdown = first_countdown(one_in);
+  if (countdown > 1) {
+    countdown--;
+    return;
+  }
+  countdown = one_in;
+  if (in_hook) return;
+  in_hook = true;
+  Thread_buffer *buffer = get_thread_buffer();
+  if (buffer == nullptr || !enter_hook(buffer)) {
+    in_hook = false;
+    return;
+  }
+
+  void *frames[MAX_FRAMES];
+  int depth = MallocHook::GetCallerStackTrace(frames, MAX_FRAMES, 0);
+  size_t site = find_site(frames, depth);
+  if (site < SITE_COUNT) {
+    uintptr_t address = (uintptr_t)ptr;
+    size_t start = slot_index(address);
+    for (size_t i = 0; i < MAX_PROBES; i++) {
+      Slot& slot = buffer->slots[(start + i) % BUFFER_SLOTS];
+      uintptr_t current = slot.address.load(std::memory_order_relaxed);
+      if ((current == EMPTY || current == DELETED) &&
+          slot.address.compare_exchange_strong(current, BUSY,
+                                               std::memory_order_acquire)) {
+        slot.site = site;
+        slot.size = size > UINT32_MAX ? UINT32_MAX : size;
+        slot.allocated_ns = now_ns();
+        // Nobody can free ptr before malloc returned, publishing it last
+        // is enough
+        filter_add(address);
+        slot.address.store(address, std::memory_order_release);
+        push_event(buffer, {(uint32_t)site, slot.size,
+                            (uint8_t)log2_bucket(size), false});
+        break;
+      }
+    }
+  }
+  leave_hook(buffer);
+  in_hook = false;
+}
+
+// Take the slot of a sampled address back, the allocation is most often
+// freed by the thread that made it
+bool take_slot(Thread_buffer *buffer, uintptr_t address, uint32_t *site,
+               uint64_t *allocated_ns) {
+  size_t start = slot_index(address);
+  for (size_t i = 0; i < MAX_PROBES; i++) {
+    Slot& slot = buffer->slots[(start + i) % BUFFER_SLOTS];
+    uintptr_t current = slot.address.load(std::memory_order_acquire);
+    // A slot is never emptied, the allocation can't be further
+    if (current == EMPTY) return false;
+    if (current != address) continue;
+    *site = slot.site;
+    *allocated_ns = slot.allocated_ns;
+    return slot.address.compare_exchange_strong(current, DELETED,
+                                                std::memory_order_acq_rel);
+  }
+  return false;
+}
+
+void delete_hook(const void *ptr) {
+  if (sample_one_in.load(std::memory_order_relaxed) == 0 || ptr == nullptr)
+    return;
+  uintptr_t address = (uintptr_t)ptr;
+  if (live_filter[filter_index(address)].load(std::memory_order_relaxed) == 0)
+    return;
+  if (in_hook) return;
+  in_hook = true;
+  Thread_buffer *own = get_thread_buffer();
+  if (own == nullptr || !enter_hook(own)) {
+    in_hook = false;
+    return;
+  }
+
+  uint32_t site;
+  uint64_t allocated_ns;
+  bool found = take_slot(own, address, &site, &allocated_ns);
+  size_t count = std::min(buffer_count.load(std::memory_order_acquire),
+                          MAX_THREAD_BUFFERS);
+  for (size_t i = 0; i < count && !found; i++) {
+    Thread_buffer *buffer = buffers[i].load(std::memory_order_acquire);
+    if (buffer != nullptr && buffer != own)
+      found = take_slot(buffer, address, &site, &allocated_ns);
+  }
+  if (found) {
+    filter_remove(address);
+    uint64_t now = now_ns();
+    push_event(own, {site, 0,
+                     (uint8_t)log2_bucket(now > allocated_ns
+                                              ? now - allocated_ns : 0),
+                     true});
+  }
+  leave_hook(own);
+  in_hook = false;
+}
+
+// Fold the events of every buffer in stats, tables_mutex must be held
+void merge_buffers() {
+  size_t count = std::min(buffer_count.load(std::memory_order_acquire),
+                          MAX_THREAD_BUFFERS);
+  for (size_t i = 0; i < count; i++) {
+    Thread_buffer *buffer = buffers[i].load(std::memory_order_acquire);
+    if (buffer == nullptr) continue;
+    uint32_t tail = buffer->tail.load(std::memory_order_relaxed);
+    uint32_t head = buffer->head.load(std::memory_order_acquire);
+    for (; tail != head; tail++) {
+      const Event& event = buffer->events[tail % BUFFER_EVENTS];
+      Site_stats& site = stats[event.site];
+      if (event.freed) {
+        site.freed++;
+        site.lifetimes[event.bucket]++;
+      } else {
+        site.sampled++;
+        site.bytes += event.size;
+        site.sizes[event.bucket]++;
+      }
+    }
+    buffer->tail.store(tail, std::memory_order_release);
+  }
+}
+
+// Empties the buffers before they drop events. A reader of the table or
+// remove_hooks() holding tables_mutex merges them itself.
+void merge_loop() {
+  std::unique_lock<std::mutex> lock(merge_mutex);
+  while (!merge_stopping) {
+    merge_cond.wait_for(lock, MERGE_INTERVAL);
+    if (!tables_mutex.try_lock()) continue;
+    merge_buffers();
+    tables_mutex.unlock();
+  }
+}
+
+// sample_one_in must be 0 and tables_mutex held. Returns once no hook uses
+// the buffers anymore: the ones entering now see sample_one_in and leave.
+void remove_hooks() {
+  if (!hooks_installed) return;
+  MallocHook::RemoveNewHook(new_hook);
+  MallocHook::RemoveDeleteHook(delete_hook);
+  hooks_installed = false;
+  if (expedited_barrier)
+    syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0);
+  else
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  size_t count = std::min(buffer_count.load(std::memory_order_acquire),
+                          MAX_THREAD_BUFFERS);
+  for (size_t i = 0; i < count; i++) {
+    Thread_buffer *buffer = buffers[i].load(std::memory_order_acquire);
+    while (buffer != nullptr && buffer->active.load(std::memory_order_acquire))
+      std::this_thread::yield();
+  }
+  merge_buffers();
+
+  {
+    std::lock_guard<std::mutex> guard(merge_mutex);
+    merge_stopping = true;
+  }
+  merge_cond.notify_all();
+  if (merge_thread.joinable()) merge_thread.join();
+}
+
+// Forget the previous collection, no hook can run
+void reset_tables() {
+  memset(static_cast<void *>(sites), 0, SITE_COUNT * sizeof(Site));
+  memset(static_cast<void *>(stats), 0, SITE_COUNT * sizeof(Site_stats));
+  for (auto& counter : live_filter) counter.store(0, std::memory_order_relaxed);
+  size_t count = std::min(buffer_count.load(std::memory_order_acquire),
+                          MAX_THREAD_BUFFERS);
+  for (size_t i = 0; i < count; i++) {
+    Thread_buffer *buffer = buffers[i].load(std::memory_order_acquire);
+    if (buffer == nullptr) continue;
+    for (Slot& slot : buffer->slots)
+      slot.address.store(EMPTY, std::memory_order_relaxed);
+    buffer->head.store(0, std::memory_order_relaxed);
+    buffer->tail.store(0, std::memory_order_relaxed);
+  }
+}
+
+// Smallest value of the bucket where half of the samples are reached
+uint64_t median_bucket(const uint64_t *buckets) {
+  uint64_t total = 0;
+  for (int i = 0; i < BUCKET_COUNT; i++) total += buckets[i];
+  uint64_t seen = 0;
+  for (int i = 0; i < BUCKET_COUNT; i++) {
+    seen += buckets[i];
+    if (total > 0 && seen * 2 >= total) return 1ULL << i;
+  }
+  return 0;
+}
+
+// "lower bound:count" of the buckets not empty
+std::string histogram(const uint64_t *buckets) {
+  std::string text;
+  for (int i = 0; i < BUCKET_COUNT; i++) {
+    if (buckets[i] == 0) continue;
+    if (!text.empty()) text += " ";
+    text += std::to_string(1ULL << i) + ":" + std::to_string(buckets[i]);
+  }
+  if (text.size() > 1024) text.resize(1024);
+  return text;
+}
+
+void fill_alloc_lifetimes(std::vector<Snapshot_row> *rows) {
+  // The tables can't be reset or freed while they are read
+  std::lock_guard<std::mutex> guard(tables_mutex);
+  if (sites == nullptr) return;
+  merge_buffers();
+  std::vector<Mapped_region> regions;
+  read_self_mappings(&regions);
+
+  std::vector<size_t> used;
+  for (size_t i = 0; i < SITE_COUNT; i++)
+    if (sites[i].ready.load(std::memory_order_acquire)) used.push_back(i);
+  // The sites with the most short lived allocations are the interesting
+  // ones, the freed count comes first
+  std::sort(used.begin(), used.end(), [](size_t a, size_t b) {
+    return stats[a].freed > stats[b].freed;
+  });
+
+  for (size_t index : used) {
+    const Site& site = sites[index];
+    const Site_stats& site_stats = stats[index];
+    std::string top_frame, stack;
+    bool in_allocator = true;
+    for (int i = 0; i < site.depth; i++) {
+      uint64_t pc = (uint64_t)(uintptr_t)site.frames[i];
+      std::string function, filename;
+      if (!symbolize_address(regions, pc > 0 ? pc - 1 : 0, &function,
+                             &filename))
+        function = symbolize(regions, pc);
+      if (in_allocator && is_allocator_frame(filename, function)) continue;
+      if (in_allocator) top_frame = function;
+      in_allocator = false;
+      if (!stack.empty()) stack += "; ";
+      stack += function;
+    }
+    if (stack.size() > 1024) stack.resize(1024);
+    uint64_t sampled = site_stats.sampled;
+    uint64_t freed = site_stats.freed;
+    rows->push_back(
+        {Snapshot_value::unsigned_number(site.hash.load()),
+         Snapshot_value::string(top_frame), Snapshot_value::string(stack),
+         Snapshot_value::unsigned_number(sampled),
+         Snapshot_value::unsigned_number(freed),
+         Snapshot_value::unsigned_number(sampled > freed ? sampled - freed
+                                                         : 0),
+         Snapshot_value::unsigned_number(site_stats.bytes),
+         Snapshot_value::unsigned_number(median_bucket(site_stats.sizes)),
+         freed > 0 ? Snapshot_value::unsigned_number(
+                         median_bucket(site_stats.lifetimes))
+                   : Snapshot_value::null(),
+         Snapshot_value::string(histogram(site_stats.sizes)),
+         Snapshot_value::string(histogram(site_stats.lifetimes))});
+  }
+}
+
+}  // namespace
+
+void set_lifetime_sampling(unsigned long long one_in) {
+  if (one_in > UINT32_MAX) one_in = UINT32_MAX;
+  std::lock_guard<std::mutex> guard(tables_mutex);
+  if (one_in == 0) {
+    sample_one_in.store(0);
+    remove_hooks();
+    return;
+  }
+  if (!hooks_installed) {
+    if (sites == nullptr)
+      sites = static_cast<Site *>(calloc(SITE_COUNT, sizeof(Site)));
+    if (stats == nullptr)
+      stats = static_cast<Site_stats *>(calloc(SITE_COUNT, sizeof(Site_stats)));
+    if (sites == nullptr || stats == nullptr) return;
+    if (!buffer_key_created)
+      buffer_key_created = pthread_key_create(&buffer_key, release_buffer) == 0;
+    if (!buffer_key_created) return;
+    // Lets the hooks skip the full fence
+    expedited_barrier =
+        syscall(__NR_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED,
+                0) == 0;
+    reset_tables();
+    merge_stopping = false;
+    merge_thread = std::thread(merge_loop);
+    sample_one_in.store(one_in);
+    MallocHook::AddNewHook(new_hook);
+    MallocHook::AddDeleteHook(delete_hook);
+    hooks_installed = true;
+    return;
+  }
+  sample_one_in.store(one_in);
+}
+
+void deinit_lifetime_sampling() {
+  std::lock_guard<std::mutex> guard(tables_mutex);
+  sample_one_in.store(0);
+  remove_hooks();
+  if (buffer_key_created) pthread_key_delete(buffer_key);
+  buffer_key_created = false;
+  size_t count = std::min(buffer_count.load(), MAX_THREAD_BUFFERS);
+  for (size_t i = 0; i < count; i++) {
+    Thread_buffer *buffer = buffers[i].exchange(nullptr);
+    if (buffer != nullptr) munmap(buffer, sizeof(Thread_buffer));
+  }
+  buffer_count.store(0);
+  free(sites);
+  free(stats);
+  sites = nullptr;
+  stats = nullptr;
+}
+
+Snapshot_table alloc_lifetimes_table = {
+    "profiler_alloc_lifetimes",
+    "`SITE_ID` BIGINT unsigned, `TOP_FRAME` VARCHAR(255), "
+    "`STACK` VARCHAR(1024), `SAMPLED` BIGINT unsigned, "
+    "`FREED` BIGINT unsigned, `LIVE` BIGINT unsigned, "
+    "`SAMPLED_BYTES` BIGINT unsigned, `MEDIAN_SIZE` BIGINT unsigned, "
+    "`MEDIAN_LIFETIME` BIGINT unsigned, `SIZE_HISTOGRAM` VARCHAR(1024), "
+    "`LIFETIME_HISTOGRAM` VARCHAR(1024)",
+    fill_alloc_lifetimes, 100, {}};
@@ -0,0 +1,39 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#ifndef PROFILER_TCMALLOC_LIFETIMES_H
+#define PROFILER_TCMALLOC_LIFETIMES_H
+
+#include "snapshot_table.h"
+
+// 1 in N allocations are followed until they are freed, 0 removes the
+// MallocHook hooks. The results of the previous run are cleared when the
+// hooks are installed again.
+extern void set_lifetime_sampling(unsigned long long one_in);
+// Remove the hooks and free the tables, at uninstall
+extern void deinit_lifetime_sampling();
+
+// performance_schema.profiler_alloc_lifetimes: one row per call site of
+// the sampled allocations with its size and lifetime histograms
+extern Snapshot_table alloc_lifetimes_table;
+
+#endif /* PROFILER_TCMALLOC_LIFETIMES_H */
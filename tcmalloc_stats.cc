@@ -0,0 +1,131 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#include "tcmalloc_stats.h"
+
+#include <gperftools/malloc_extension.h>
+
+namespace {
+
+struct Tcmalloc_property {
+  const char *name;
+  const char *description;
+};
+
+// Properties not known by the tcmalloc in use are skipped
+const Tcmalloc_property tcmalloc_properties[] = {
+    {"generic.current_allocated_bytes", "Bytes used by the application"},
+    {"generic.heap_size", "Bytes reserved from the system"},
+    {"generic.total_physical_bytes", "Bytes backed by physical memory"},
+    {"tcmalloc.pageheap_free_bytes", "Free bytes mapped in the page heap"},
+    {"tcmalloc.pageheap_unmapped_bytes", "Free bytes released to the system"},
+    {"tcmalloc.central_cache_free_bytes", "Free bytes in the central cache"},
+    {"tcmalloc.transfer_cache_free_bytes", "Free bytes in the transfer cache"},
+    {"tcmalloc.thread_cache_free_bytes", "Free bytes in the thread caches"},
+    {"tcmalloc.current_total_thread_cache_bytes", "Bytes used by the thread caches"},
+    {"tcmalloc.max_total_thread_cache_bytes", "Limit of the thread caches"},
+    {"tcmalloc.slack_bytes", "Free bytes in the page heap, mapped or not"},
+    {"tcmalloc.aggressive_memory_decommit", "Free pages released immediately"},
+};
+
+void fill_tcmalloc_stats(std::vector<Snapshot_row> *rows) {
+  MallocExtension *extension = MallocExtension::instance();
+  for (const Tcmalloc_property& property : tcmalloc_properties) {
+    size_t value = 0;
+    if (!extension->GetNumericProperty(property.name, &value)) continue;
+    rows->push_back({Snapshot_value::string(property.name),
+                     Snapshot_value::null(), Snapshot_value::null(),
+                     Snapshot_value::unsigned_number(value),
+                     Snapshot_value::string(property.description)});
+  }
+
+  std::vector<MallocExtension::FreeListInfo> free_lists;
+  extension->GetFreeListSizes(&free_lists);
+  for (const MallocExtension::FreeListInfo& info : free_lists) {
+    rows->push_back({Snapshot_value::string(info.type),
+                     Snapshot_value::unsigned_number(info.min_object_size),
+                     Snapshot_value::unsigned_number(info.max_object_size),
+                     Snapshot_value::unsigned_number(info.total_bytes_free),
+                     Snapshot_value::string("Free bytes of the size class")});
+  }
+}
+
+int show_tcmalloc_property(SHOW_VAR *var, char *buff, const char *property) {
+  size_t value = 0;
+  MallocExtension::instance()->GetNumericProperty(property, &value);
+  var->type = SHOW_LONGLONG;
+  var->value = buff;
+  *reinterpret_cast<unsigned long long *>(buff) = value;
+  return 0;
+}
+
+#define TCMALLOC_STATUS_FUNCTION(name, property)                  \
+  int show_##name(MYSQL_THD, SHOW_VAR *var, char *buff) {        \
+    return show_tcmalloc_property(var, buff, property);          \
+  }
+
+TCMALLOC_STATUS_FUNCTION(current_allocated_bytes, "generic.current_allocated_bytes")
+TCMALLOC_STATUS_FUNCTION(heap_size, "generic.heap_size")
+TCMALLOC_STATUS_FUNCTION(pageheap_free_bytes, "tcmalloc.pageheap_free_bytes")
+TCMALLOC_STATUS_FUNCTION(pageheap_unmapped_bytes, "tcmalloc.pageheap_unmapped_bytes")
+TCMALLOC_STATUS_FUNCTION(central_cache_free_bytes, "tcmalloc.central_cache_free_bytes")
+TCMALLOC_STATUS_FUNCTION(transfer_cache_free_bytes, "tcmalloc.transfer_cache_free_bytes")
+TCMALLOC_STATUS_FUNCTION(thread_cache_free_bytes, "tcmalloc.thread_cache_free_bytes")
+
+}  // namespace
+
+bool tcmalloc_totals(uint64_t *allocated, uint64_t *heap_size) {
+  size_t current = 0, heap = 0;
+  MallocExtension *extension = MallocExtension::instance();
+  if (!extension->GetNumericProperty("generic.current_allocated_bytes", &current) ||
+      !extension->GetNumericProperty("generic.heap_size", &heap))
+    return false;
+  *allocated = current;
+  *heap_size = heap;
+  return true;
+}
+
+Snapshot_table tcmalloc_stats_table = {
+    "profiler_tcmalloc_stats",
+    "`NAME` VARCHAR(64), `MIN_OBJECT_SIZE` BIGINT unsigned, "
+    "`MAX_OBJECT_SIZE` BIGINT unsigned, `VALUE` BIGINT unsigned, "
+    "`DESCRIPTION` VARCHAR(64)",
+    fill_tcmalloc_stats, 400, {}};
+
+SHOW_VAR tcmalloc_stats_status_variables[] = {
+  {"profiler.tcmalloc_current_allocated_bytes", (char *)&show_current_allocated_bytes,
+    SHOW_FUNC, SHOW_SCOPE_GLOBAL},
+  {"profiler.tcmalloc_heap_size", (char *)&show_heap_size, SHOW_FUNC,
+    SHOW_SCOPE_GLOBAL},
+  {"profiler.tcmalloc_pageheap_free_bytes", (char *)&show_pageheap_free_bytes,
+    SHOW_FUNC, SHOW_SCOPE_GLOBAL},
+  {"profiler.tcmalloc_pageheap_unmapped_bytes", (char *)&show_pageheap_unmapped_bytes,
+    SHOW_FUNC, SHOW_SCOPE_GLOBAL},
+  {"profiler.tcmalloc_central_cache_free_bytes", (char *)&show_central_cache_free_bytes,
+    SHOW_FUNC, SHOW_SCOPE_GLOBAL},
+  {"profiler.tcmalloc_transfer_cache_free_bytes", (char *)&show_transfer_cache_free_bytes,
+    SHOW_FUNC, SHOW_SCOPE_GLOBAL},
+  {"profiler.tcmalloc_thread_cache_free_bytes", (char *)&show_thread_cache_free_bytes,
+    SHOW_FUNC, SHOW_SCOPE_GLOBAL},
+  {nullptr, nullptr, SHOW_UNDEF,
+    SHOW_SCOPE_UNDEF}  // null terminator required
+};
@@ -0,0 +1,41 @@
+/* Copyright (c) 2017, 2024, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License, version 2.0, for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA */
+
+#ifndef PROFILER_TCMALLOC_STATS_H
+#define PROFILER_TCMALLOC_STATS_H
+
+#include "common.h"
+#include "snapshot_table.h"
+
+#include <cstdint>
+
+// performance_schema.profiler_tcmalloc_stats: the numeric properties of
+// MallocExtension and the free lists of each size class
+extern Snapshot_table tcmalloc_stats_table;
+
+// Bytes allocated by mysqld and reserved by tcmalloc
+extern bool tcmalloc_totals(uint64_t *allocated, uint64_t *heap_size);
+
+// profiler.tcmalloc_* status variables, read from tcmalloc when shown
+extern SHOW_VAR tcmalloc_stats_status_variables[];
+
+#endif /* PROFILER_TCMALLOC_STATS_H */